@@ -0,0 +1,431 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif /* _WIN32 */
+
+#include <SOARE/SOARE.h>
+
+#include "fork.h"
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Fork.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#ifndef _WIN32
+
+/* Maximum request header length */
+#define FORK_HEADER 256
+/* Maximum request payload length */
+#define FORK_PAYLOAD (64UL * 1024 * 1024)
+/* Descriptors sent with a request (stdin, stdout, stderr, directory) */
+#define FORK_DESCRIPTORS 4
+
+/* Modules run before forking */
+static int preload_count = 0;
+static soare_module_t **preload = NULL;
+
+/* Listening socket path */
+static const char *socket_path = NULL;
+
+/* Client of the child process */
+static int connection = -1;
+
+////////////////////////////////////////////////////////////
+static char *fork_read(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+
+    if (!file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char *content = size < 0 ? NULL : (char *)malloc((size_t)size + 1);
+
+    if (!content)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t read_size = fread(content, sizeof(char), (size_t)size, file);
+    content[read_size] = 0;
+    fclose(file);
+
+    return content;
+}
+
+////////////////////////////////////////////////////////////
+static void fork_done(int status)
+{
+    // Nothing to free: the process ends with the script
+    fflush(stdout);
+    fflush(stderr);
+
+    char response[32];
+    int length = snprintf(response, sizeof(response), "%d\n", status);
+
+    while (write(connection, response, (size_t)length) < 0 && errno == EINTR)
+        ;
+
+    _exit(status);
+}
+
+////////////////////////////////////////////////////////////
+static char *fork_exit(soare_arguments_list_t args)
+{
+    // exit() answers the client before leaving
+    char *code = soare_get_argument(args, 0);
+    int status = !code ? 0 : atoi(code);
+    free(code);
+
+    fork_done(status);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t fork_descriptors(struct msghdr *message, int descriptors[FORK_DESCRIPTORS])
+{
+    struct cmsghdr *control = CMSG_FIRSTHDR(message);
+
+    if (!control || control->cmsg_level != SOL_SOCKET || control->cmsg_type != SCM_RIGHTS)
+    {
+        return bFalse;
+    }
+
+    size_t count = (control->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(descriptors, CMSG_DATA(control), (count < FORK_DESCRIPTORS ? count : FORK_DESCRIPTORS) * sizeof(int));
+
+    for (size_t i = FORK_DESCRIPTORS; i < count; i++)
+    {
+        int extra;
+        memcpy(&extra, CMSG_DATA(control) + i * sizeof(int), sizeof(int));
+        close(extra);
+    }
+
+    return (boolean_t)(count >= FORK_DESCRIPTORS);
+}
+
+////////////////////////////////////////////////////////////
+static char *fork_request(char kind[8])
+{
+    char header[FORK_HEADER + 1];
+    char control[CMSG_SPACE(FORK_DESCRIPTORS * sizeof(int))];
+
+    struct iovec data = {header, FORK_HEADER};
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received = 0;
+
+    while ((received = recvmsg(connection, &message, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+        ;
+
+    int descriptors[FORK_DESCRIPTORS];
+
+    if (received <= 0 || !fork_descriptors(&message, descriptors))
+    {
+        return NULL;
+    }
+
+    // The script runs with the streams and the directory of the client
+    for (int i = 0; i < 3; i++)
+    {
+        dup2(descriptors[i], i);
+        close(descriptors[i]);
+    }
+
+    if (fchdir(descriptors[3]) < 0)
+    {
+        perror("fchdir");
+    }
+
+    close(descriptors[3]);
+
+    // The header may arrive in several parts
+    size_t size = (size_t)received;
+    char *newline = NULL;
+
+    while (!(newline = memchr(header, '\n', size)) && size < FORK_HEADER)
+    {
+        ssize_t part = read(connection, header + size, FORK_HEADER - size);
+
+        if (part < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (part <= 0)
+        {
+            return NULL;
+        }
+
+        size += (size_t)part;
+    }
+
+    unsigned long length = 0;
+    header[size] = 0;
+
+    if (!newline || sscanf(header, "%7s %lu", kind, &length) != 2 || length > FORK_PAYLOAD || (strcmp(kind, "code") && strcmp(kind, "file")))
+    {
+        fprintf(stderr, "Invalid request\n");
+        return NULL;
+    }
+
+    char *payload = (char *)malloc(length + 1);
+
+    if (!payload)
+    {
+        return NULL;
+    }
+
+    // Start of the payload, received with the header
+    size_t copied = size - (size_t)(newline + 1 - header);
+    copied = copied < length ? copied : length;
+    memcpy(payload, newline + 1, copied);
+
+    while (copied < length)
+    {
+        ssize_t part = read(connection, payload + copied, length - copied);
+
+        if (part < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (part <= 0)
+        {
+            free(payload);
+            return NULL;
+        }
+
+        copied += (size_t)part;
+    }
+
+    payload[length] = 0;
+    return payload;
+}
+
+////////////////////////////////////////////////////////////
+static void fork_child(int client)
+{
+    // Killed like a script started from a shell, reaped by system()
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+
+    connection = client;
+
+    char kind[8] = {0};
+    char *payload = fork_request(kind);
+
+    if (!payload)
+    {
+        _exit(EXIT_FAILURE);
+    }
+
+    boolean_t file = (boolean_t)!strcmp(kind, "file");
+    char *code = file ? fork_read(payload) : payload;
+
+    if (!code)
+    {
+        fprintf(stderr, "Cannot read file: %s\n", payload);
+        fork_done(EXIT_FAILURE);
+    }
+
+    soare_state_t *state = soare_state_current();
+
+    // Steps of the preloaded files are not charged to the script
+    soare_state_budget(state, state->steps_slice, state->steps_limit);
+
+    // The process is private: the predefined exit() is replaced in place
+    soare_functions_t *exit_function = soare_get_function("exit");
+
+    if (exit_function)
+    {
+        exit_function->exec = fork_exit;
+    }
+
+    free(soare_execute(file ? payload : "<launch>", code));
+    fork_done(soare_errorlevel());
+}
+
+////////////////////////////////////////////////////////////
+static void fork_stop(int sig)
+{
+    // Children are not stopped: they end with their script
+    unlink(socket_path);
+    _exit(sig);
+}
+
+////////////////////////////////////////////////////////////
+static int fork_socket(const char *path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    strcpy(address.sun_path, path);
+
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (server < 0)
+    {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+
+    unlink(path);
+
+    if (bind(server, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(server, 64) < 0)
+    {
+        perror(path);
+        close(server);
+        return EXIT_FAILURE;
+    }
+
+    socket_path = path;
+    signal(SIGINT, fork_stop);
+    signal(SIGTERM, fork_stop);
+
+    // Children are reaped by the system
+    signal(SIGCHLD, SIG_IGN);
+
+    // Nothing buffered may be written again by the children
+    fflush(stdout);
+    fflush(stderr);
+
+    while (1)
+    {
+        int client = accept(server, NULL, NULL);
+
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+
+            perror("accept");
+            break;
+        }
+
+        pid_t child = fork();
+
+        if (!child)
+        {
+            close(server);
+            fork_child(client);
+        }
+
+        if (child < 0)
+        {
+            perror("fork");
+        }
+
+        close(client);
+    }
+
+    close(server);
+    unlink(path);
+    return EXIT_FAILURE;
+}
+
+////////////////////////////////////////////////////////////
+static void fork_unload(void)
+{
+    while (preload_count)
+    {
+        soare_module_release(preload[--preload_count]);
+    }
+
+    free(preload);
+    preload = NULL;
+}
+
+////////////////////////////////////////////////////////////
+int ForkServer(const char *socket, int argc, char *argv[])
+{
+    if (!socket)
+    {
+        soare_write(__soare_stderr, "--fork-server needs --socket=<path>\n");
+        return EXIT_FAILURE;
+    }
+
+    preload = (soare_module_t **)calloc((size_t)argc + 1, sizeof(soare_module_t *));
+
+    if (!preload)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return EXIT_FAILURE;
+    }
+
+    for (; preload_count < argc; preload_count++)
+    {
+        if (!(preload[preload_count] = soare_module_load(argv[preload_count])))
+        {
+            fork_unload();
+            return EXIT_FAILURE;
+        }
+
+        // Run once: functions and globals are inherited by the children
+        free(soare_module_attach(preload[preload_count]));
+
+        if (soare_errorlevel())
+        {
+            preload_count++;
+            fork_unload();
+            return EXIT_FAILURE;
+        }
+    }
+
+    int status = fork_socket(socket);
+    fork_unload();
+
+    return status;
+}
+
+#else
+
+////////////////////////////////////////////////////////////
+int ForkServer(const char *socket, int argc, char *argv[])
+{
+    (void)socket;
+    (void)argc;
+    (void)argv;
+
+    soare_write(__soare_stderr, "--fork-server is not available on this platform\n");
+    return EXIT_FAILURE;
+}
+
+#endif /* _WIN32 */
@@ -7,6 +7,9 @@
 
 #include "../modules/module.h"
 
+#include "fork.h"
+#include "serve.h"
+
 /**
  *  _____  _____  ___  ______ _____
  * /  ___||  _  |/ _ \ | ___ \  ___|
@@ -22,6 +25,33 @@
 
 static char *buffer = NULL;
 
+/* Script execution service (--serve) */
+static boolean_t serve = bFalse;
+static char *serve_socket = NULL;
+static unsigned int serve_workers = 0;
+
+/* Warm interpreter forked per launch (--fork-server) */
+static boolean_t fork_server = bFalse;
+
+/* Step budget (--slice, --max-steps) */
+static unsigned long long steps_slice = 0;
+static unsigned long long steps_limit = 0;
+
+/* Memory quota (--max-memory) */
+static size_t memory_limit = 0;
+
+/* Function profile (--profile), written at exit */
+static const char *profile_output = NULL;
+
+/* Sampling profiler (--sample), written at exit */
+static const char *sample_output = NULL;
+
+/* Line statistics (--line-stats), written at exit */
+static const char *lines_output = NULL;
+
+/* Trace-event JSON (--trace), written at exit */
+static const char *trace_output = NULL;
+
 ////////////////////////////////////////////////////////////
 static char *append(const char *str1, const char *str2)
 {
@@ -47,9 +77,178 @@ static void interpreter_kill(int sig)
     exit(sig);
 }
 
+////////////////////////////////////////////////////////////
+static void profile_write(void)
+{
+    // <name>.txt: report, <name>.folded: flamegraph.pl input
+    size_t size = strlen(profile_output) + 8;
+    char *report_name = (char *)malloc(size);
+    char *collapsed_name = (char *)malloc(size);
+
+    FILE *report = NULL;
+    FILE *collapsed = NULL;
+
+    if (report_name && collapsed_name)
+    {
+        snprintf(report_name, size, "%s.txt", profile_output);
+        snprintf(collapsed_name, size, "%s.folded", profile_output);
+
+        report = fopen(report_name, "w");
+        collapsed = fopen(collapsed_name, "w");
+    }
+
+    if (report && collapsed)
+    {
+        soare_profile_write(NULL, report, collapsed);
+    }
+    else
+    {
+        soare_write(__soare_stderr, "Cannot write the profile: %s\n", profile_output);
+    }
+
+    if (report)
+    {
+        fclose(report);
+    }
+
+    if (collapsed)
+    {
+        fclose(collapsed);
+    }
+
+    free(report_name);
+    free(collapsed_name);
+
+    // Once, even if the interpreter exits twice
+    profile_output = NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void sample_write(void)
+{
+    // <name>.folded: flamegraph.pl input
+    size_t size = strlen(sample_output) + 8;
+    char *collapsed_name = (char *)malloc(size);
+    FILE *collapsed = NULL;
+
+    if (collapsed_name)
+    {
+        snprintf(collapsed_name, size, "%s.folded", sample_output);
+        collapsed = fopen(collapsed_name, "w");
+    }
+
+    if (collapsed)
+    {
+        soare_sampler_write(NULL, collapsed);
+        fclose(collapsed);
+    }
+    else
+    {
+        soare_write(__soare_stderr, "Cannot write the samples: %s\n", sample_output);
+    }
+
+    free(collapsed_name);
+
+    // Once, even if the interpreter exits twice
+    sample_output = NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void lines_write(void)
+{
+    // <name>.txt: annotated listings
+    size_t size = strlen(lines_output) + 8;
+    char *report_name = (char *)malloc(size);
+    FILE *report = NULL;
+
+    if (report_name)
+    {
+        snprintf(report_name, size, "%s.txt", lines_output);
+        report = fopen(report_name, "w");
+    }
+
+    if (report)
+    {
+        soare_lines_write(NULL, report);
+        fclose(report);
+    }
+    else
+    {
+        soare_write(__soare_stderr, "Cannot write the line statistics: %s\n", lines_output);
+    }
+
+    free(report_name);
+
+    // Once, even if the interpreter exits twice
+    lines_output = NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void trace_write(void)
+{
+    FILE *file = fopen(trace_output, "w");
+
+    if (file)
+    {
+        soare_trace_write(file);
+        fclose(file);
+    }
+    else
+    {
+        soare_write(__soare_stderr, "Cannot write the trace: %s\n", trace_output);
+    }
+
+    // Once, even if the interpreter exits twice
+    trace_output = NULL;
+}
+
+#ifdef __SOARE_TRACK_ALLOCATIONS
+
+////////////////////////////////////////////////////////////
+static void track_write(void)
+{
+    // Allocations of the whole run, in the working directory
+    FILE *report = fopen("allocations.txt", "w");
+
+    if (!report)
+    {
+        soare_write(__soare_stderr, "Cannot write the allocations: allocations.txt\n");
+        return;
+    }
+
+    soare_track_write(report);
+    fclose(report);
+}
+
+#endif /* __SOARE_TRACK_ALLOCATIONS */
+
 ////////////////////////////////////////////////////////////
 static void interpreter_at_exit(void)
 {
+    if (profile_output)
+    {
+        profile_write();
+    }
+
+    if (sample_output)
+    {
+        sample_write();
+    }
+
+    if (lines_output)
+    {
+        lines_write();
+    }
+
+    if (trace_output)
+    {
+        trace_write();
+    }
+
+#ifdef __SOARE_TRACK_ALLOCATIONS
+    track_write();
+#endif /* __SOARE_TRACK_ALLOCATIONS */
+
     soare_kill();
     free(buffer);
 
@@ -189,15 +388,180 @@ int Console()
     return EXIT_SUCCESS;
 }
 
+////////////////////////////////////////////////////////////
+static int options(int argc, char *argv[])
+{
+    // Returns the index of the first file, or -1 on error
+    int i = 1;
+
+    for (; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if (!strcmp(argv[i], "--closure"))
+        {
+            soare_closure_mode(bTrue);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--jit"))
+        {
+            soare_jit_mode(bTrue);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--serve"))
+        {
+            serve = bTrue;
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--fork-server"))
+        {
+            fork_server = bTrue;
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--socket=", 9))
+        {
+            serve_socket = argv[i] + 9;
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--workers=", 10))
+        {
+            serve_workers = (unsigned int)atoi(argv[i] + 10);
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--slice=", 8))
+        {
+            steps_slice = strtoull(argv[i] + 8, NULL, 10);
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--max-steps=", 12))
+        {
+            steps_limit = strtoull(argv[i] + 12, NULL, 10);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--profile"))
+        {
+            profile_output = "profile";
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--profile=", 10))
+        {
+            profile_output = argv[i] + 10;
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--sample"))
+        {
+            sample_output = "sample";
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--sample=", 9))
+        {
+            sample_output = argv[i] + 9;
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--line-stats"))
+        {
+            lines_output = "lines";
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--line-stats=", 13))
+        {
+            lines_output = argv[i] + 13;
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+        {
+            trace_output = argv[++i];
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--trace=", 8))
+        {
+            trace_output = argv[i] + 8;
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--max-memory=", 13))
+        {
+            memory_limit = (size_t)strtoull(argv[i] + 13, NULL, 10);
+            continue;
+        }
+
+        soare_write(__soare_stderr, "Unknown option: %s\n", argv[i]);
+        return -1;
+    }
+
+    return i;
+}
+
 ////////////////////////////////////////////////////////////
 int main(int argc, char *argv[])
 {
     handle_signal();
     load_module();
 
-    if (argc > 1)
+    int first = options(argc, argv);
+
+    if (first < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Inherited by the workers, restarted for each job
+    soare_state_budget(NULL, steps_slice, steps_limit);
+    soare_state_quota(NULL, SOARE_MEMORY_TOTAL, memory_limit);
+
+    if (profile_output && !soare_profile_start(NULL))
+    {
+        profile_output = NULL;
+    }
+
+    if (sample_output && !soare_sampler_start(NULL, 0))
+    {
+        sample_output = NULL;
+    }
+
+    if (lines_output && !soare_lines_start(NULL))
+    {
+        lines_output = NULL;
+    }
+
+    if (trace_output && !soare_trace_start(NULL))
+    {
+        trace_output = NULL;
+    }
+
+    if (fork_server)
+    {
+        // Files are run once, before the first launch
+        int status = ForkServer(serve_socket, argc - first, argv + first);
+        interpreter_at_exit();
+        return status;
+    }
+
+    if (serve || serve_socket)
+    {
+        // Files are preloaded by each worker
+        int status = Serve(serve_socket, serve_workers, argc - first, argv + first);
+        interpreter_at_exit();
+        return status;
+    }
+
+    if (first < argc)
     {
-        return Files(argc, argv);
+        // Files() skips its first argument, like the program name
+        return Files(argc - first + 1, argv + first - 1);
     }
 
     return Console();
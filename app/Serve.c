@@ -0,0 +1,624 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif /* _WIN32 */
+
+#include <SOARE/SOARE.h>
+
+#include "serve.h"
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Serve.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#ifndef _WIN32
+
+/* Maximum number of queued jobs */
+#define SERVE_QUEUE 1024
+/* Maximum request header length */
+#define SERVE_HEADER 256
+/* Maximum request payload length */
+#define SERVE_PAYLOAD (64UL * 1024 * 1024)
+
+/**
+ * @brief Client sending jobs
+ */
+typedef struct serve_connection
+{
+
+    int input;               /**< Requests file descriptor          */
+    int output;              /**< Responses file descriptor         */
+    pthread_mutex_t lock;    /**< Lock on responses and references  */
+    unsigned int references; /**< Reader and unanswered jobs        */
+
+} serve_connection_t;
+
+/**
+ * @brief Script to run
+ */
+typedef struct serve_job
+{
+
+    serve_connection_t *connection; /**< Client waiting for the response */
+    char id[64];                    /**< Client job identifier           */
+    boolean_t file;                 /**< Payload is a filename           */
+    char *payload;                  /**< Source code or filename         */
+    struct serve_job *next;         /**< Next queued job                 */
+
+} serve_job_t;
+
+/**
+ * @brief Jobs waiting for a worker
+ */
+typedef struct serve_queue
+{
+
+    pthread_mutex_t lock; /**< Lock on the queue         */
+    pthread_cond_t ready; /**< A job was queued          */
+    pthread_cond_t space; /**< A job was taken           */
+    serve_job_t *head;    /**< Oldest job                */
+    serve_job_t *tail;    /**< Newest job                */
+    unsigned int count;   /**< Number of jobs            */
+    boolean_t closed;     /**< No more jobs will come    */
+
+} serve_queue_t;
+
+/* Jobs waiting for a worker */
+static serve_queue_t queue = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL, 0, bFalse};
+
+/* Modules attached to each worker */
+static int preload_count = 0;
+static soare_module_t **preload = NULL;
+
+/* Listening socket path */
+static const char *socket_path = NULL;
+
+/* exit() status of the current job, or -1 */
+static _Thread_local int exit_status = -1;
+
+////////////////////////////////////////////////////////////
+static char *serve_read(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+
+    if (!file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char *content = size < 0 ? NULL : (char *)malloc((size_t)size + 1);
+
+    if (!content)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t read_size = fread(content, sizeof(char), (size_t)size, file);
+    content[read_size] = 0;
+    fclose(file);
+
+    return content;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t serve_write(int fd, const char *data, size_t size)
+{
+    while (size)
+    {
+        ssize_t written = write(fd, data, size);
+
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (written <= 0)
+        {
+            return bFalse;
+        }
+
+        data += written;
+        size -= (size_t)written;
+    }
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void serve_release(serve_connection_t *connection)
+{
+    pthread_mutex_lock(&connection->lock);
+    unsigned int references = --connection->references;
+    pthread_mutex_unlock(&connection->lock);
+
+    if (references)
+    {
+        return;
+    }
+
+    close(connection->input);
+
+    if (connection->output != connection->input)
+    {
+        close(connection->output);
+    }
+
+    pthread_mutex_destroy(&connection->lock);
+    free(connection);
+}
+
+////////////////////////////////////////////////////////////
+static void queue_push(serve_job_t *job)
+{
+    pthread_mutex_lock(&queue.lock);
+
+    while (queue.count >= SERVE_QUEUE)
+    {
+        pthread_cond_wait(&queue.space, &queue.lock);
+    }
+
+    job->next = NULL;
+
+    if (queue.tail)
+    {
+        queue.tail->next = job;
+    }
+    else
+    {
+        queue.head = job;
+    }
+
+    queue.tail = job;
+    queue.count++;
+
+    pthread_cond_signal(&queue.ready);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+////////////////////////////////////////////////////////////
+static serve_job_t *queue_pop(void)
+{
+    pthread_mutex_lock(&queue.lock);
+
+    while (!queue.head && !queue.closed)
+    {
+        pthread_cond_wait(&queue.ready, &queue.lock);
+    }
+
+    serve_job_t *job = queue.head;
+
+    if (job)
+    {
+        queue.head = job->next;
+        queue.tail = queue.head ? queue.tail : NULL;
+        queue.count--;
+        pthread_cond_signal(&queue.space);
+    }
+
+    pthread_mutex_unlock(&queue.lock);
+    return job;
+}
+
+////////////////////////////////////////////////////////////
+static void queue_close(void)
+{
+    pthread_mutex_lock(&queue.lock);
+    queue.closed = bTrue;
+    pthread_cond_broadcast(&queue.ready);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+////////////////////////////////////////////////////////////
+static char *serve_exit(soare_arguments_list_t args)
+{
+    // exit() must not stop the server: the job is stopped instead
+    char *code = soare_get_argument(args, 0);
+    exit_status = !code ? 0 : atoi(code);
+    free(code);
+
+    boolean_t ignored = soare_as_ignored_exception();
+    soare_ignore_exception(bTrue);
+    soare_leave_exception(InterpreterError, "exit", soare_empty_document());
+    soare_ignore_exception(ignored);
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void serve_job(soare_state_t *state, FILE *input, serve_job_t *job)
+{
+    char *output = NULL;
+    char *error = NULL;
+    size_t output_size = 0;
+    size_t error_size = 0;
+
+    FILE *output_stream = open_memstream(&output, &output_size);
+    FILE *error_stream = open_memstream(&error, &error_size);
+
+    int errorlevel = EXIT_FAILURE;
+
+    if (output_stream && error_stream)
+    {
+        soare_state_streams(state, input, output_stream, error_stream);
+
+        char *code = job->file ? serve_read(job->payload) : job->payload;
+
+        if (code)
+        {
+            exit_status = -1;
+            free(soare_state_execute_isolated(state, job->file ? job->payload : "<job>", code));
+            errorlevel = exit_status >= 0 ? exit_status : soare_state_errorlevel(state);
+        }
+        else
+        {
+            fprintf(error_stream, "Cannot read file: %s\n", job->payload);
+        }
+
+        if (code != job->payload)
+        {
+            free(code);
+        }
+
+        soare_state_streams(state, input, NULL, NULL);
+    }
+
+    if (output_stream)
+    {
+        fclose(output_stream);
+    }
+
+    if (error_stream)
+    {
+        fclose(error_stream);
+    }
+
+    char header[SERVE_HEADER];
+    int length = snprintf(header, sizeof(header), "%s %d %zu %zu\n", job->id, errorlevel, output_size, error_size);
+
+    serve_connection_t *connection = job->connection;
+
+    pthread_mutex_lock(&connection->lock);
+
+    if (serve_write(connection->output, header, (size_t)length))
+    {
+        if (serve_write(connection->output, output ? output : "", output_size))
+        {
+            serve_write(connection->output, error ? error : "", error_size);
+        }
+    }
+
+    pthread_mutex_unlock(&connection->lock);
+
+    free(output);
+    free(error);
+}
+
+////////////////////////////////////////////////////////////
+static void *serve_worker(void *shared)
+{
+    // Shared functions are inherited, everything else is private
+    soare_state_t *state = soare_state_inherit((const soare_state_t *)shared);
+
+    if (!state)
+    {
+        return NULL;
+    }
+
+    soare_state_select(state);
+    soare_add_function("exit", serve_exit);
+
+    for (int i = 0; i < preload_count; i++)
+    {
+        // Parsed once by Serve(), only the globals are private
+        free(soare_module_attach(preload[i]));
+    }
+
+    // Jobs cannot read the requests
+    FILE *input = fopen("/dev/null", "r");
+
+    serve_job_t *job = NULL;
+
+    while ((job = queue_pop()))
+    {
+        serve_job(state, input, job);
+        serve_release(job->connection);
+        free(job->payload);
+        free(job);
+    }
+
+    if (input)
+    {
+        fclose(input);
+    }
+
+    soare_state_free(state);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void *serve_reader(void *data)
+{
+    serve_connection_t *connection = (serve_connection_t *)data;
+    FILE *requests = fdopen(dup(connection->input), "rb");
+
+    char header[SERVE_HEADER];
+
+    while (requests && fgets(header, sizeof(header), requests))
+    {
+        char kind[8] = {0};
+        unsigned long length = 0;
+
+        serve_job_t *job = (serve_job_t *)calloc(1, sizeof(serve_job_t));
+
+        if (!job)
+        {
+            break;
+        }
+
+        if (sscanf(header, "%7s %63s %lu", kind, job->id, &length) != 3 || length > SERVE_PAYLOAD || (strcmp(kind, "code") && strcmp(kind, "file")))
+        {
+            fprintf(stderr, "Invalid request: %s", header);
+            free(job);
+            break;
+        }
+
+        if (!(job->payload = (char *)malloc(length + 1)) || fread(job->payload, 1, length, requests) != length)
+        {
+            free(job->payload);
+            free(job);
+            break;
+        }
+
+        job->payload[length] = 0;
+        job->file = (boolean_t)!strcmp(kind, "file");
+        job->connection = connection;
+
+        pthread_mutex_lock(&connection->lock);
+        connection->references++;
+        pthread_mutex_unlock(&connection->lock);
+
+        queue_push(job);
+    }
+
+    if (requests)
+    {
+        fclose(requests);
+    }
+
+    serve_release(connection);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static serve_connection_t *serve_connection(int input, int output)
+{
+    serve_connection_t *connection = (serve_connection_t *)malloc(sizeof(serve_connection_t));
+
+    if (!connection)
+    {
+        return NULL;
+    }
+
+    connection->input = input;
+    connection->output = output;
+    connection->references = 1;
+    pthread_mutex_init(&connection->lock, NULL);
+
+    return connection;
+}
+
+////////////////////////////////////////////////////////////
+static void serve_stop(int sig)
+{
+    // Workers are still running: the shared state is not freed
+    unlink(socket_path);
+    _exit(sig);
+}
+
+////////////////////////////////////////////////////////////
+static int serve_socket(const char *path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    strcpy(address.sun_path, path);
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (server < 0)
+    {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+
+    unlink(path);
+
+    if (bind(server, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(server, 64) < 0)
+    {
+        perror(path);
+        close(server);
+        return EXIT_FAILURE;
+    }
+
+    socket_path = path;
+    signal(SIGINT, serve_stop);
+    signal(SIGTERM, serve_stop);
+
+    while (1)
+    {
+        int client = accept(server, NULL, NULL);
+
+        if (client < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            perror("accept");
+            break;
+        }
+
+        pthread_t reader;
+        serve_connection_t *connection = serve_connection(client, client);
+
+        if (!connection || pthread_create(&reader, NULL, serve_reader, connection))
+        {
+            free(connection);
+            close(client);
+            continue;
+        }
+
+        pthread_detach(reader);
+    }
+
+    close(server);
+    unlink(path);
+    return EXIT_FAILURE;
+}
+
+////////////////////////////////////////////////////////////
+static void serve_unload(void)
+{
+    while (preload_count)
+    {
+        soare_module_release(preload[--preload_count]);
+    }
+
+    free(preload);
+    preload = NULL;
+}
+
+////////////////////////////////////////////////////////////
+int Serve(const char *socket, unsigned int workers, int argc, char *argv[])
+{
+    if (!workers)
+    {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = processors > 0 ? (unsigned int)processors : 1;
+    }
+
+    preload = (soare_module_t **)calloc((size_t)argc + 1, sizeof(soare_module_t *));
+
+    if (!preload)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return EXIT_FAILURE;
+    }
+
+    for (; preload_count < argc; preload_count++)
+    {
+        if (!(preload[preload_count] = soare_module_load(argv[preload_count])))
+        {
+            serve_unload();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Responses are the only output: anything else written on
+    // stdout (system(), ...) goes to stderr
+    int responses = socket ? -1 : dup(STDOUT_FILENO);
+
+    if (!socket)
+    {
+        fflush(stdout);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+
+    pthread_t *threads = (pthread_t *)malloc(workers * sizeof(pthread_t));
+
+    if (!threads)
+    {
+        serve_unload();
+        SOARE_OUT_OF_MEMORY();
+        return EXIT_FAILURE;
+    }
+
+    unsigned int started = 0;
+
+    for (; started < workers; started++)
+    {
+        if (pthread_create(&threads[started], NULL, serve_worker, soare_state_current()))
+        {
+            break;
+        }
+    }
+
+    int status = EXIT_SUCCESS;
+
+    if (!started)
+    {
+        status = EXIT_FAILURE;
+    }
+    else if (socket)
+    {
+        status = serve_socket(socket);
+    }
+    else
+    {
+        serve_connection_t *connection = serve_connection(STDIN_FILENO, responses);
+
+        if (connection)
+        {
+            serve_reader(connection);
+        }
+    }
+
+    // Answer the remaining jobs
+    queue_close();
+
+    for (unsigned int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    serve_unload();
+
+    return status;
+}
+
+#else
+
+////////////////////////////////////////////////////////////
+int Serve(const char *socket, unsigned int workers, int argc, char *argv[])
+{
+    (void)socket;
+    (void)workers;
+    (void)argc;
+    (void)argv;
+
+    soare_write(__soare_stderr, "--serve is not available on this platform\n");
+    return EXIT_FAILURE;
+}
+
+#endif /* _WIN32 */
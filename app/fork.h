@@ -0,0 +1,56 @@
+#ifndef __SOARE_FORK_H__
+#define __SOARE_FORK_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <fork.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Fork server
+ *
+ * The files given to `ForkServer()` are run once in the interpreter,
+ * then each client of the UNIX socket launches a script in a child
+ * process forked from this warm interpreter: the predefined functions,
+ * the modules and their globals are inherited copy-on-write, so that
+ * nothing is loaded or parsed again
+ *
+ * Request (one per connection):
+ *
+ *  <code|file> <length>\n<payload>
+ *
+ *  - code: the payload is SOARE source code
+ *  - file: the payload is the path of a SOARE file
+ *
+ * The first message carries (SCM_RIGHTS) the standard input, output
+ * and error of the script, followed by a descriptor of its working
+ * directory
+ *
+ * Response, once the script ends:
+ *
+ *  <errorlevel>\n
+ *
+ */
+
+/**
+ * @brief Run the fork server
+ *
+ * @param socket Path of the UNIX socket to listen on
+ * @param argc Number of files to preload
+ * @param argv Files to run before forking
+ * @return int Exit status
+ */
+int ForkServer(const char *socket, int argc, char *argv[]);
+
+#endif /* __SOARE_FORK_H__ */
\ No newline at end of file
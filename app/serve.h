@@ -0,0 +1,54 @@
+#ifndef __SOARE_SERVE_H__
+#define __SOARE_SERVE_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <serve.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Script execution service
+ *
+ * Jobs are read from stdin, or from the clients of a UNIX socket,
+ * and run by a pool of worker threads, each with its own interpreter
+ * state. Functions registered before `Serve()` are shared by all
+ * workers, files given to `Serve()` are parsed once and attached to
+ * each worker as shared modules
+ *
+ * Request:
+ *
+ *  <code|file> <id> <length>\n<payload>
+ *
+ *  - code: the payload is SOARE source code
+ *  - file: the payload is the path of a SOARE file
+ *  - id: any word, sent back with the response
+ *
+ * Response (in completion order):
+ *
+ *  <id> <errorlevel> <output length> <error length>\n<output><error>
+ *
+ */
+
+/**
+ * @brief Run the script execution service
+ *
+ * @param socket Path of the UNIX socket to listen on, or NULL for stdin/stdout
+ * @param workers Number of worker threads, or 0 for one per processor
+ * @param argc Number of files to preload
+ * @param argv Files to attach to each worker
+ * @return int Exit status
+ */
+int Serve(const char *socket, unsigned int workers, int argc, char *argv[]);
+
+#endif /* __SOARE_SERVE_H__ */
\ No newline at end of file
@@ -0,0 +1,629 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <SOARE/SOARE.h>
+
+#include "../modules/module.h"
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Bench.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Benchmark suite (`make bench`)
+ *
+ * Each workload runs several times, each time in a new process, and
+ * the median times are kept. The tokenizer, the parser and the runtime
+ * are timed apart, with the allocations counted by the interpreter
+ * state and the peak RSS of the process. Results are written as JSON,
+ * and compared to a baseline written by the same program
+ *
+ * The runtime also reports the operations counted by the state
+ * (statements, expression nodes, operators, variable lookups and
+ * calls). They do not depend on the machine nor on its load, so they
+ * are compared with their own threshold, zero by default. With
+ * `--count`, the given scripts run once each and only their counts are
+ * reported, so that two builds can be compared exactly
+ *
+ * Usage: soare-bench [--runs=n] [--closure] [--jit] [--output=file]
+ *                    [--baseline=file] [--threshold=percent]
+ *                    [--count-threshold=percent] [--count file...]
+ *
+ */
+
+/* Functions of the generated source */
+#define BENCH_FUNCTIONS 2000
+/* Timings below this are never regressions (ms) */
+#define BENCH_NOISE 2.0
+/* Resident sets growing by less than this are never regressions (KiB) */
+#define BENCH_NOISE_RSS 1024
+
+/**
+ * @brief Workload
+ */
+typedef struct workload
+{
+
+    const char *name; /**< Name in the results                 */
+    const char *file; /**< SOARE file, or NULL (generated)     */
+
+} workload_t;
+
+/**
+ * @brief Results of a run
+ */
+typedef struct result
+{
+
+    double tokenize;                /**< Tokenizer time (ms)             */
+    double parse;                   /**< Parser time (ms)                */
+    double run;                     /**< Runtime time (ms)               */
+    unsigned long long allocations; /**< Allocations of the state        */
+    unsigned long long peak;        /**< Peak bytes counted by the state */
+    long rss;                       /**< Peak resident set size (KiB)    */
+    unsigned long long statements;  /**< Statements executed             */
+    unsigned long long nodes;       /**< Expression nodes evaluated      */
+    unsigned long long operations;  /**< Operators evaluated             */
+    unsigned long long lookups;     /**< Variables searched by name      */
+    unsigned long long calls;       /**< SOARE and native calls          */
+    int failed;                     /**< The script raised an error      */
+
+} result_t;
+
+/* Workloads, in order */
+static const workload_t suite[] = {
+    {"parser", NULL},
+    {"fib", "bench/fib.soare"},
+    {"strings", "bench/strings.soare"},
+    {"stdmath", "bench/stdmath.soare"},
+    {"counter", "bench/counter.soare"},
+};
+
+/* Workloads measured: the suite, or the scripts of `--count` */
+static const workload_t *workloads = NULL;
+static size_t workloads_count = 0;
+
+/* Counted operations, in the order of the results */
+static const char *counted[] = {"allocations", "statements", "nodes", "operations", "lookups", "calls"};
+
+/* Number of counted operations */
+#define COUNTED (sizeof(counted) / sizeof(*counted))
+
+/* Options */
+static unsigned long runs = 7;
+static boolean_t closure = bFalse;
+static boolean_t jit = bFalse;
+static const char *output = NULL;
+static const char *baseline = NULL;
+static double threshold = 25.0;
+static double count_threshold = 0.0;
+static boolean_t counting = bFalse;
+
+////////////////////////////////////////////////////////////
+static double elapsed(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - start->tv_sec) * 1e3 + (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+////////////////////////////////////////////////////////////
+static char *read_file(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+
+    if (!file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char *content = size < 0 ? NULL : (char *)malloc((size_t)size + 1);
+
+    if (content)
+    {
+        content[fread(content, 1, (size_t)size, file)] = 0;
+    }
+
+    fclose(file);
+    return content;
+}
+
+////////////////////////////////////////////////////////////
+static char *generate(unsigned int functions)
+{
+    // Functions with declarations, conditions and loops, then a call
+    static const char *body =
+        //
+        "fn f%u(a; b)\n"
+        "  ? Generated function %u\n"
+        "  let x = a + b * 2 - (a / 4);\n"
+        "  if (x > 10 && b != \"text\")\n"
+        "    x = x - 1;\n"
+        "  else\n"
+        "    x = x + 1;\n"
+        "  end\n"
+        "  while (x < 100)\n"
+        "    x = x * 2;\n"
+        "  end\n"
+        "  return x, \"-%u\";\n"
+        "end\n\n";
+    //
+
+    size_t size = (size_t)functions * (strlen(body) + 32) + 64;
+    char *source = (char *)malloc(size);
+
+    if (!source)
+    {
+        return NULL;
+    }
+
+    size_t length = 0;
+
+    for (unsigned int i = 0; i < functions; i++)
+    {
+        length += (size_t)snprintf(source + length, size - length, body, i, i, i);
+    }
+
+    snprintf(source + length, size - length, "write(f0(1; 2); '\\n');\n");
+    return source;
+}
+
+////////////////////////////////////////////////////////////
+static void measure(const workload_t *workload, result_t *result)
+{
+    soare_state_t *state = soare_state_current();
+    const soare_memory_usage_t *total = &state->memory[SOARE_MEMORY_TOTAL];
+
+    char *name = (char *)(workload->file ? workload->file : "<generated>");
+    char *source = workload->file ? read_file(workload->file) : generate(BENCH_FUNCTIONS);
+
+    if (!source)
+    {
+        result->failed = 1;
+        return;
+    }
+
+    struct timespec start;
+    unsigned long long allocations = total->count;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    tokens_t *tokens = soare_tokenizer(name, source);
+    result->tokenize = elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ast_t tree = soare_parser(tokens);
+    result->parse = elapsed(&start);
+
+    soare_tree_free(tree);
+    soare_tokens_free(tokens);
+
+    // The runtime runs the same tree, parsed again outside of the state
+    soare_module_t *module = soare_module_compile(name, source);
+
+    soare_stats_t before = soare_get_stats();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    free(soare_module_attach(module));
+    result->run = elapsed(&start);
+
+    soare_stats_t after = soare_get_stats();
+
+    result->statements = after.statements - before.statements;
+    result->nodes = after.nodes - before.nodes;
+    result->operations = after.operations - before.operations;
+    result->lookups = after.lookups - before.lookups;
+    result->calls = after.calls + after.native_calls - before.calls - before.native_calls;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    result->allocations = total->count - allocations;
+    result->peak = total->peak;
+    result->rss = usage.ru_maxrss;
+    result->failed = !module || soare_errorlevel();
+
+    soare_module_release(module);
+    free(source);
+}
+
+////////////////////////////////////////////////////////////
+static int run(const workload_t *workload, result_t *result)
+{
+    // A new process for each run: nothing is cached, RSS is its own
+    int channel[2];
+
+    if (pipe(channel) < 0)
+    {
+        return 0;
+    }
+
+    fflush(stdout);
+    pid_t child = fork();
+
+    if (!child)
+    {
+        close(channel[0]);
+
+        // Only the results are written
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+
+        load_module();
+        soare_closure_mode(closure);
+        soare_jit_mode(jit);
+
+        result_t measured = {0};
+        measure(workload, &measured);
+
+        _exit(write(channel[1], &measured, sizeof(measured)) == sizeof(measured) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(channel[1]);
+
+    ssize_t size = child < 0 ? -1 : read(channel[0], result, sizeof(*result));
+    close(channel[0]);
+
+    int status = 0;
+    while (child > 0 && waitpid(child, &status, 0) < 0 && errno == EINTR)
+        ;
+
+    return size == sizeof(*result);
+}
+
+////////////////////////////////////////////////////////////
+static int by_time(const void *a, const void *b)
+{
+    double difference = *(const double *)a - *(const double *)b;
+    return (difference > 0) - (difference < 0);
+}
+
+////////////////////////////////////////////////////////////
+static double median(double *times)
+{
+    qsort(times, runs, sizeof(double), by_time);
+    return runs % 2 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2.0;
+}
+
+////////////////////////////////////////////////////////////
+static int measure_runs(const workload_t *workload, result_t *result)
+{
+    // Median times: a few slow or fast runs do not move the results
+    double *times = (double *)calloc(3 * runs, sizeof(double));
+
+    if (!times)
+    {
+        return 0;
+    }
+
+    for (unsigned long i = 0; i < runs; i++)
+    {
+        result_t current;
+
+        // Scripts counted may end with an error, their counts are kept
+        if (!run(workload, &current) || (current.failed && !counting))
+        {
+            result->failed = 1;
+            free(times);
+            return 0;
+        }
+
+        times[i] = current.tokenize;
+        times[runs + i] = current.parse;
+        times[2 * runs + i] = current.run;
+
+        // Allocations do not change between runs, memory may
+        long rss = i ? result->rss : 0;
+        *result = current;
+        result->rss = current.rss > rss ? current.rss : rss;
+    }
+
+    result->tokenize = median(times);
+    result->parse = median(times + runs);
+    result->run = median(times + 2 * runs);
+
+    free(times);
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static void counts(const result_t *result, double *values)
+{
+    // In the order of `counted`
+    values[0] = (double)result->allocations;
+    values[1] = (double)result->statements;
+    values[2] = (double)result->nodes;
+    values[3] = (double)result->operations;
+    values[4] = (double)result->lookups;
+    values[5] = (double)result->calls;
+}
+
+////////////////////////////////////////////////////////////
+static void report(FILE *file, const result_t *results)
+{
+    fprintf(file, "{\n  \"version\": \"%s\",\n  \"mode\": \"%s\",\n  \"runs\": %lu,\n  \"workloads\": [\n", SOARE_VERSION, jit ? "jit" : closure ? "closure" : "tree", runs);
+
+    for (size_t i = 0; i < workloads_count; i++)
+    {
+        const result_t *result = &results[i];
+        double values[COUNTED];
+
+        fprintf(file, "    {\"name\": \"%s\", ", workloads[i].name);
+
+        // Only stable values when counting
+        if (!counting)
+        {
+            fprintf(file, "\"tokenize_ms\": %.3f, \"parse_ms\": %.3f, \"run_ms\": %.3f, ", result->tokenize, result->parse, result->run);
+            fprintf(file, "\"peak_bytes\": %llu, \"peak_rss_kb\": %ld, ", result->peak, result->rss);
+        }
+
+        counts(result, values);
+
+        for (size_t k = 0; k < COUNTED; k++)
+        {
+            fprintf(file, "\"%s\": %.0f, ", counted[k], values[k]);
+        }
+
+        fprintf(file, "\"failed\": %d}%s\n", result->failed, i + 1 < workloads_count ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+}
+
+////////////////////////////////////////////////////////////
+static int baseline_value(const char *json, const char *name, const char *key, double *value)
+{
+    // Only reads the results written by report()
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"name\": \"%s\"", name);
+
+    const char *object = strstr(json, pattern);
+    const char *end = object ? strchr(object, '}') : NULL;
+
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *field = object ? strstr(object, pattern) : NULL;
+
+    if (!field || field > end)
+    {
+        return 0;
+    }
+
+    *value = strtod(field + strlen(pattern), NULL);
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static int regression(const char *name, const char *key, double value, double expected, double percent)
+{
+    if (value <= expected * (1.0 + percent / 100.0))
+    {
+        return 0;
+    }
+
+    fprintf(stderr, "Regression: %s %s %.3f (baseline %.3f, +%.1f%%)\n", name, key, value, expected, expected > 0 ? (value / expected - 1.0) * 100.0 : 100.0);
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static int compare(const char *json, const result_t *results)
+{
+    static const char *keys[] = {"tokenize_ms", "parse_ms", "run_ms", "peak_rss_kb"};
+    int regressions = 0;
+
+    for (size_t i = 0; i < workloads_count; i++)
+    {
+        const result_t *result = &results[i];
+        double values[] = {result->tokenize, result->parse, result->run, (double)result->rss};
+        double operations[COUNTED];
+
+        counts(result, operations);
+
+        // Counts are exact: no noise to leave out
+        for (size_t k = 0; k < COUNTED; k++)
+        {
+            double expected = 0;
+
+            if (baseline_value(json, workloads[i].name, counted[k], &expected))
+            {
+                regressions += regression(workloads[i].name, counted[k], operations[k], expected, count_threshold);
+            }
+        }
+
+        for (size_t k = 0; !counting && k < sizeof(keys) / sizeof(*keys); k++)
+        {
+            double expected = 0;
+
+            if (!baseline_value(json, workloads[i].name, keys[k], &expected))
+            {
+                continue;
+            }
+
+            // Short timings are mostly noise
+            if (k < 3 && values[k] < BENCH_NOISE)
+            {
+                continue;
+            }
+
+            // Small processes vary by a few pages between runs
+            if (k == 3 && values[k] - expected < BENCH_NOISE_RSS)
+            {
+                continue;
+            }
+
+            regressions += regression(workloads[i].name, keys[k], values[k], expected, threshold);
+        }
+    }
+
+    return regressions;
+}
+
+////////////////////////////////////////////////////////////
+static int options(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strncmp(argv[i], "--runs=", 7))
+        {
+            runs = strtoul(argv[i] + 7, NULL, 10);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--closure"))
+        {
+            closure = bTrue;
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--jit"))
+        {
+            jit = bTrue;
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--output=", 9))
+        {
+            output = argv[i] + 9;
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--baseline=", 11))
+        {
+            baseline = argv[i] + 11;
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--threshold=", 12))
+        {
+            threshold = strtod(argv[i] + 12, NULL);
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--count-threshold=", 18))
+        {
+            count_threshold = strtod(argv[i] + 18, NULL);
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--count") && i + 1 < argc)
+        {
+            // The remaining arguments are the scripts
+            workload_t *scripts = (workload_t *)calloc((size_t)(argc - i - 1), sizeof(workload_t));
+
+            if (!scripts)
+            {
+                return 0;
+            }
+
+            while (++i < argc)
+            {
+                scripts[workloads_count++] = (workload_t){argv[i], argv[i]};
+            }
+
+            workloads = scripts;
+
+            // Counts do not change between runs
+            counting = bTrue;
+            runs = 1;
+            break;
+        }
+
+        fprintf(stderr, "Usage: %s [--runs=n] [--closure] [--jit] [--output=file] [--baseline=file] [--threshold=percent] [--count-threshold=percent] [--count file...]\n", argv[0]);
+        return 0;
+    }
+
+    if (!counting)
+    {
+        workloads = suite;
+        workloads_count = sizeof(suite) / sizeof(*suite);
+    }
+
+    return runs > 0;
+}
+
+////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    if (!options(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    result_t *results = (result_t *)calloc(workloads_count, sizeof(result_t));
+
+    if (!results)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+
+    for (size_t i = 0; i < workloads_count; i++)
+    {
+        if (!measure_runs(&workloads[i], &results[i]))
+        {
+            fprintf(stderr, "Failed: %s\n", workloads[i].name);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    report(stdout, results);
+
+    if (output)
+    {
+        FILE *file = fopen(output, "w");
+
+        if (!file)
+        {
+            perror(output);
+            return EXIT_FAILURE;
+        }
+
+        report(file, results);
+        fclose(file);
+    }
+
+    if (baseline)
+    {
+        char *json = read_file(baseline);
+
+        if (!json)
+        {
+            perror(baseline);
+            return EXIT_FAILURE;
+        }
+
+        int regressions = compare(json, results);
+        free(json);
+
+        if (regressions)
+        {
+            fprintf(stderr, "%d regression(s) against %s\n", regressions, baseline);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    free(results);
+    return status;
+}
@@ -0,0 +1,484 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/resource.h>
+
+#include <SOARE/SOARE.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Frontend.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Tokenizer and parser benchmark (`make frontend`)
+ *
+ * Generates a large program of rules, as written by programs: nested
+ * functions, conditions and loops, long strings with escape sequences
+ * and deep expressions, the same for a given seed. `soare_tokenizer()`
+ * and `soare_parser()` are timed apart, several times, and the median
+ * throughputs are printed as JSON with the peak memory of the tokens,
+ * of the tree and of the process. Files given as arguments are
+ * measured instead of the generated program
+ *
+ * Usage: soare-frontend [--lines=n] [--seed=n] [--runs=n]
+ *                       [--emit=file] [file.soare...]
+ *
+ */
+
+/* Deepest generated expression */
+#define FRONTEND_DEPTH 12
+/* Characters of a generated string, escape sequences included */
+#define FRONTEND_STRING 240
+
+/**
+ * @brief Growing source
+ */
+typedef struct source
+{
+
+    char *text;    /**< Characters, null-terminated */
+    size_t length; /**< Number of characters        */
+    size_t size;   /**< Capacity of the text        */
+
+} source_t;
+
+/**
+ * @brief Results of a source
+ */
+typedef struct result
+{
+
+    size_t bytes;                   /**< Size of the source              */
+    unsigned long long lines;       /**< Lines of the source             */
+    unsigned long long tokens;      /**< Tokens                          */
+    unsigned long long nodes;       /**< Nodes of the tree               */
+    double tokenize;                /**< Median tokenizer time (ms)      */
+    double parse;                   /**< Median parser time (ms)         */
+    unsigned long long tokens_peak; /**< Peak bytes of the tokens        */
+    unsigned long long ast_peak;    /**< Peak bytes of the tree          */
+    int failed;                     /**< Tokenizer or parser error       */
+
+} result_t;
+
+/* Options */
+static unsigned long lines = 100000;
+static unsigned long seed = 1;
+static unsigned long runs = 5;
+static const char *emit = NULL;
+
+////////////////////////////////////////////////////////////
+static double elapsed(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - start->tv_sec) * 1e3 + (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long random_below(unsigned long bound)
+{
+    // Same program for the same seed, on every platform
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned long)((seed >> 33) % bound);
+}
+
+////////////////////////////////////////////////////////////
+static int append(source_t *source, const char *format, ...)
+{
+    va_list args;
+
+    while (1)
+    {
+        va_start(args, format);
+        int length = vsnprintf(source->text + source->length, source->size - source->length, format, args);
+        va_end(args);
+
+        if (length < 0)
+        {
+            return 0;
+        }
+
+        if ((size_t)length < source->size - source->length)
+        {
+            source->length += (size_t)length;
+            return 1;
+        }
+
+        size_t size = source->size * 2 + (size_t)length + 1;
+        char *text = (char *)realloc(source->text, size);
+
+        if (!text)
+        {
+            return 0;
+        }
+
+        source->text = text;
+        source->size = size;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void generate_string(source_t *source)
+{
+    static const char *escapes[] = {"\\n", "\\t", "\\\"", "\\\\", "\\x41", "\\101", "\\e", "\\'"};
+    static const char *words[] = {"rule", "match", "path", "value", "threshold", "customer", "region", "priority"};
+
+    append(source, "\"");
+
+    for (size_t length = 0; length < FRONTEND_STRING;)
+    {
+        const char *part = random_below(4) ? words[random_below(8)] : escapes[random_below(8)];
+        append(source, "%s ", part);
+        length += strlen(part) + 1;
+    }
+
+    append(source, "\"");
+}
+
+////////////////////////////////////////////////////////////
+static void generate_expression(source_t *source, unsigned int depth)
+{
+    static const char *operators[] = {"+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||"};
+
+    if (!depth || !random_below(depth + 1))
+    {
+        switch (random_below(4))
+        {
+        case 0:
+            append(source, "a");
+            break;
+
+        case 1:
+            append(source, "b");
+            break;
+
+        case 2:
+            append(source, "%lu.%lu", random_below(1000), random_below(100));
+            break;
+
+        default:
+            append(source, "%lu", random_below(100000));
+            break;
+        }
+
+        return;
+    }
+
+    append(source, "(");
+    generate_expression(source, depth - 1);
+    append(source, " %s ", operators[random_below(sizeof(operators) / sizeof(*operators))]);
+    generate_expression(source, depth - 1);
+    append(source, ")");
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long generate_rule(source_t *source, unsigned long rule)
+{
+    size_t start = source->length;
+
+    append(source, "? Rule %lu, generated\n", rule);
+    append(source, "let weight%lu = %lu;\n", rule, random_below(100));
+    append(source, "fn rule%lu(a; b)\n\n", rule);
+
+    append(source, "  let label = ");
+    generate_string(source);
+    append(source, ";\n  let score = ");
+    generate_expression(source, FRONTEND_DEPTH);
+
+    append(source, ";\n\n  if ");
+    generate_expression(source, 3);
+    append(source, "\n    while (score < %lu)\n      score = ", random_below(1000));
+    generate_expression(source, 4);
+    append(source, ";\n      if (score == %lu)\n        break;\n      end\n    end\n", random_below(100));
+
+    append(source, "  or (b == \"skip\")\n    score = 0;\n  else\n");
+    append(source, "    fn helper%lu(x)\n      return x * %lu + ", rule, random_below(10));
+    generate_expression(source, 2);
+    append(source, ";\n    end\n    score = helper%lu(score);\n  end\n\n", rule);
+
+    append(source, "  try\n    score = score / (b - %lu);\n", random_below(10));
+    append(source, "  iferror as error\n    label = label, error;\n  end\n\n");
+    append(source, "  return score, label;\n\nend\n\n");
+
+    // Lines written
+    unsigned long written = 0;
+
+    for (size_t i = start; i < source->length; i++)
+    {
+        written += source->text[i] == '\n';
+    }
+
+    return written;
+}
+
+////////////////////////////////////////////////////////////
+static char *generate(void)
+{
+    source_t source = {NULL, 0, 0};
+
+    for (unsigned long rule = 0, written = 0; written < lines; rule++)
+    {
+        written += generate_rule(&source, rule);
+    }
+
+    // Rules are declared, called by the host
+    return source.text;
+}
+
+////////////////////////////////////////////////////////////
+static char *read_file(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+
+    if (!file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char *content = size < 0 ? NULL : (char *)malloc((size_t)size + 1);
+
+    if (content)
+    {
+        content[fread(content, 1, (size_t)size, file)] = 0;
+    }
+
+    fclose(file);
+    return content;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long long count_nodes(ast_t tree)
+{
+    unsigned long long nodes = 0;
+
+    // Siblings in a loop: statements of a body may be many
+    for (; tree; tree = tree->sibling)
+    {
+        nodes += 1 + count_nodes(tree->child);
+    }
+
+    return nodes;
+}
+
+////////////////////////////////////////////////////////////
+static int by_time(const void *a, const void *b)
+{
+    double difference = *(const double *)a - *(const double *)b;
+    return (difference > 0) - (difference < 0);
+}
+
+////////////////////////////////////////////////////////////
+static double median(double *times)
+{
+    qsort(times, runs, sizeof(double), by_time);
+    return runs % 2 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2.0;
+}
+
+////////////////////////////////////////////////////////////
+static int measure(char *name, const char *text, result_t *result)
+{
+    soare_state_t *state = soare_state_current();
+    double *times = (double *)calloc(2 * runs, sizeof(double));
+    char *source = (char *)malloc(strlen(text) + 1);
+
+    if (!times || !source)
+    {
+        free(times);
+        free(source);
+        return 0;
+    }
+
+    result->bytes = strlen(text);
+    result->lines = 1;
+
+    for (const char *character = text; *character; character++)
+    {
+        result->lines += *character == '\n';
+    }
+
+    for (unsigned long i = 0; i < runs && !result->failed; i++)
+    {
+        struct timespec start;
+
+        // The tokenizer may write into the text (escape sequences)
+        strcpy(source, text);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        tokens_t *tokens = soare_tokenizer(name, source);
+        times[i] = elapsed(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ast_t tree = tokens ? soare_parser(tokens) : NULL;
+        times[runs + i] = elapsed(&start);
+
+        result->failed = !tree || soare_errorlevel();
+        result->tokens = 0;
+
+        for (tokens_t *token = tokens; token; token = token->next)
+        {
+            result->tokens++;
+        }
+
+        result->nodes = count_nodes(tree);
+
+        soare_tree_free(tree);
+        soare_tokens_free(tokens);
+    }
+
+    result->tokenize = median(times);
+    result->parse = median(times + runs);
+    result->tokens_peak = state->memory[SOARE_MEMORY_TOKENS].peak;
+    result->ast_peak = state->memory[SOARE_MEMORY_AST].peak;
+
+    free(times);
+    free(source);
+    return !result->failed;
+}
+
+////////////////////////////////////////////////////////////
+static void report(const char *name, const result_t *result, int last)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    double megabytes = (double)result->bytes / (1024.0 * 1024.0);
+
+    printf(
+        //
+        "    {\"name\": \"%s\", \"bytes\": %zu, \"lines\": %llu, \"tokens\": %llu, \"nodes\": %llu, "
+        "\"tokenize_ms\": %.3f, \"tokenize_mb_s\": %.2f, \"tokens_s\": %.0f, "
+        "\"parse_ms\": %.3f, \"parse_mb_s\": %.2f, \"nodes_s\": %.0f, "
+        "\"tokens_peak_bytes\": %llu, \"ast_peak_bytes\": %llu, \"peak_rss_kb\": %ld, \"failed\": %d}%s\n",
+        name, result->bytes, result->lines, result->tokens, result->nodes,
+        result->tokenize, megabytes / (result->tokenize / 1e3), (double)result->tokens / (result->tokenize / 1e3),
+        result->parse, megabytes / (result->parse / 1e3), (double)result->nodes / (result->parse / 1e3),
+        result->tokens_peak, result->ast_peak, usage.ru_maxrss, result->failed, last ? "" : ","
+        //
+    );
+}
+
+////////////////////////////////////////////////////////////
+static int options(int argc, char *argv[], int *files)
+{
+    int i = 1;
+
+    for (; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if (!strncmp(argv[i], "--lines=", 8))
+        {
+            lines = strtoul(argv[i] + 8, NULL, 10);
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--seed=", 7))
+        {
+            seed = strtoul(argv[i] + 7, NULL, 10);
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--runs=", 7))
+        {
+            runs = strtoul(argv[i] + 7, NULL, 10);
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--emit=", 7))
+        {
+            emit = argv[i] + 7;
+            continue;
+        }
+
+        fprintf(stderr, "Usage: %s [--lines=n] [--seed=n] [--runs=n] [--emit=file] [file.soare...]\n", argv[0]);
+        return 0;
+    }
+
+    *files = i;
+    return runs > 0;
+}
+
+////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    int files = argc;
+
+    if (!options(argc, argv, &files))
+    {
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    printf("{\n  \"version\": \"%s\",\n  \"runs\": %lu,\n  \"sources\": [\n", SOARE_VERSION, runs);
+
+    if (files == argc)
+    {
+        char *text = generate();
+
+        if (!text)
+        {
+            fprintf(stderr, "Out of memory\n");
+            return EXIT_FAILURE;
+        }
+
+        FILE *file = emit ? fopen(emit, "w") : NULL;
+
+        if (file)
+        {
+            fputs(text, file);
+            fclose(file);
+        }
+        else if (emit)
+        {
+            perror(emit);
+        }
+
+        result_t result = {0};
+        status = measure("<generated>", text, &result) ? status : EXIT_FAILURE;
+        report("<generated>", &result, 1);
+
+        free(text);
+    }
+
+    for (int i = files; i < argc; i++)
+    {
+        char *text = read_file(argv[i]);
+        result_t result = {0};
+
+        if (!text)
+        {
+            perror(argv[i]);
+            result.failed = 1;
+        }
+        else if (!measure(argv[i], text, &result))
+        {
+            // Keep measuring the next files
+            soare_clear_exception();
+            result.failed = 1;
+        }
+
+        status = result.failed ? EXIT_FAILURE : status;
+        report(argv[i], &result, i + 1 == argc);
+
+        free(text);
+    }
+
+    printf("  ]\n}\n");
+    return status;
+}
@@ -0,0 +1,437 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SOARE/SOARE.h>
+
+#include "../modules/module.h"
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Fuzz.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Differential fuzzer (`make differential`)
+ *
+ * Generates programs made of what the JIT compiler accepts (`let`,
+ * assignments, `if`, `while`, `break` and `return` over integer
+ * arithmetic and comparisons), with operands chosen to reach its bail
+ * outs: overflows, divisions by zero or with a remainder, negative
+ * zero, values outside of 32 bits for `%` and `^`. Functions are
+ * called enough to be compiled, and a loop at the top level too
+ *
+ * Each program runs in a new state in tree mode, then in closure mode
+ * and with the JIT compiler: everything written, errors included, must
+ * be the same. The first program giving a different output is written
+ * to the `--emit` file, the same for a given seed
+ *
+ * Usage: soare-fuzz [--programs=n] [--seed=n] [--emit=file]
+ *
+ */
+
+/* Functions of a generated program */
+#define FUZZ_FUNCTIONS 4
+/* Deepest generated expression */
+#define FUZZ_DEPTH 4
+/* Calls of each function (compiled after SOARE_JIT_HOT_CALLS) */
+#define FUZZ_CALLS 12
+/* Maximum output of a program, in bytes */
+#define FUZZ_OUTPUT 65536
+
+/**
+ * @brief Growing source
+ */
+typedef struct source
+{
+
+    char *text;    /**< Characters, null-terminated */
+    size_t length; /**< Number of characters        */
+    size_t size;   /**< Capacity of the text        */
+
+} source_t;
+
+/* Modes compared with the interpreter */
+static const char *modes[] = {"tree", "closure", "jit"};
+
+/* Options */
+static unsigned long programs = 300;
+static unsigned long seed = 1;
+static const char *emit = NULL;
+
+////////////////////////////////////////////////////////////
+static unsigned long random_below(unsigned long bound)
+{
+    // Same programs for the same seed, on every platform
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned long)((seed >> 33) % bound);
+}
+
+////////////////////////////////////////////////////////////
+static int append(source_t *source, const char *format, ...)
+{
+    va_list args;
+
+    while (1)
+    {
+        va_start(args, format);
+        int length = vsnprintf(source->text + source->length, source->size - source->length, format, args);
+        va_end(args);
+
+        if (length < 0)
+        {
+            return 0;
+        }
+
+        if ((size_t)length < source->size - source->length)
+        {
+            source->length += (size_t)length;
+            return 1;
+        }
+
+        size_t size = source->size * 2 + (size_t)length + 1;
+        char *text = (char *)realloc(source->text, size);
+
+        if (!text)
+        {
+            return 0;
+        }
+
+        source->text = text;
+        source->size = size;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void generate_literal(source_t *source, int nonzero)
+{
+    // Small values, then the limits of 32 and 64 bits
+    static const char *literals[] = {
+        "0", "1", "2", "3", "7", "10", "1000000007",
+        "2147483647", "2147483648", "4611686018427387904", "9223372036854775807" //
+    };
+
+    size_t count = sizeof(literals) / sizeof(*literals);
+    const char *literal = nonzero ? literals[1 + random_below(count - 1)] : literals[random_below(count)];
+
+    if (random_below(4))
+    {
+        append(source, "%s", literal);
+        return;
+    }
+
+    append(source, "(0 - %s)", literal);
+}
+
+////////////////////////////////////////////////////////////
+static void generate_expression(source_t *source, unsigned int depth, const char **names, size_t count)
+{
+    // Mostly arithmetic: comparisons give 0 and 1, which end as divisors
+    static const char *operators[] = {
+        "+", "+", "-", "-", "*", "*", "/", "/", "%", "^",
+        "<", ">", "<=", ">=", "==", "!=", "&&", "||" //
+    };
+
+    if (!depth || !random_below(depth + 1))
+    {
+        if (random_below(3))
+        {
+            append(source, "%s", names[random_below(count)]);
+            return;
+        }
+
+        generate_literal(source, 0);
+        return;
+    }
+
+    const char *operator = operators[random_below(sizeof(operators) / sizeof(*operators))];
+
+    append(source, "(");
+    generate_expression(source, depth - 1, names, count);
+    append(source, " %s ", operator);
+
+    // Divisions by zero only bail out sometimes
+    if ((*operator == '/' || *operator == '%') && random_below(4))
+    {
+        generate_literal(source, 1);
+    }
+    else
+    {
+        generate_expression(source, depth - 1, names, count);
+    }
+
+    append(source, ")");
+}
+
+////////////////////////////////////////////////////////////
+static void generate_assignment(source_t *source, const char *indent, const char **names, size_t count)
+{
+    // The loop counter is never assigned: every loop ends
+    append(source, "%s%s = ", indent, random_below(2) ? "x" : "y");
+    generate_expression(source, FUZZ_DEPTH, names, count);
+    append(source, ";\n");
+}
+
+////////////////////////////////////////////////////////////
+static void generate_function(source_t *source, unsigned long function)
+{
+    static const char *parameters[] = {"a", "b"};
+    static const char *locals[] = {"a", "b", "x", "y"};
+    static const char *looping[] = {"a", "b", "x", "y", "i"};
+
+    append(source, "fn f%lu(a; b)\n", function);
+
+    append(source, "  let x = ");
+    generate_expression(source, FUZZ_DEPTH, parameters, 2);
+    append(source, ";\n  let y = ");
+    generate_expression(source, FUZZ_DEPTH, parameters, 2);
+    append(source, ";\n  let i = 0;\n");
+
+    append(source, "  while (i < %lu)\n", 1 + random_below(20));
+
+    for (unsigned long statement = 1 + random_below(3); statement; statement--)
+    {
+        if (random_below(2))
+        {
+            generate_assignment(source, "    ", looping, 5);
+            continue;
+        }
+
+        append(source, "    if (");
+        generate_expression(source, 2, looping, 5);
+        append(source, ")\n");
+        generate_assignment(source, "      ", looping, 5);
+
+        if (!random_below(3))
+        {
+            append(source, "      break;\n");
+        }
+
+        if (random_below(2))
+        {
+            append(source, "    or (");
+            generate_expression(source, 2, looping, 5);
+            append(source, ")\n");
+            generate_assignment(source, "      ", looping, 5);
+        }
+
+        if (random_below(2))
+        {
+            append(source, "    else\n");
+            generate_assignment(source, "      ", looping, 5);
+        }
+
+        append(source, "    end\n");
+    }
+
+    append(source, "    i = i + 1;\n  end\n");
+
+    if (random_below(2))
+    {
+        append(source, "  if (");
+        generate_expression(source, 2, locals, 4);
+        append(source, ")\n    return;\n  end\n");
+    }
+
+    append(source, "  return ");
+    generate_expression(source, FUZZ_DEPTH, locals, 4);
+    append(source, ";\nend\n\n");
+}
+
+////////////////////////////////////////////////////////////
+static char *generate(void)
+{
+    static const char *counters[] = {"s", "j"};
+
+    source_t source = {NULL, 0, 0};
+
+    for (unsigned long function = 0; function < FUZZ_FUNCTIONS; function++)
+    {
+        generate_function(&source, function);
+    }
+
+    append(&source, "let k = 0;\nwhile (k < %d)\n", FUZZ_CALLS);
+
+    for (unsigned long function = 0; function < FUZZ_FUNCTIONS; function++)
+    {
+        // Arguments grow with k, some of them past 32 or 64 bits
+        append(&source, "  try\n    write(f%lu((k * ", function);
+        generate_literal(&source, 0);
+        append(&source, "); (");
+        generate_literal(&source, 0);
+        append(&source, " - k)); ' ');\n  iferror as error\n    write(error; ' ');\n  end\n");
+    }
+
+    append(&source, "  write('\\n');\n  k = k + 1;\nend\n\n");
+
+    // A loop compiled on its own
+    append(&source, "let s = ");
+    generate_literal(&source, 0);
+    append(&source, ";\nlet j = 0;\ntry\n  while (j < %lu)\n    s = ", 8 + random_below(24));
+    generate_expression(&source, FUZZ_DEPTH, counters, 2);
+    append(&source, ";\n    j = j + 1;\n  end\niferror as error\n  write(error; ' ');\nend\nwrite(s; '\\n');\n");
+
+    return source.text;
+}
+
+////////////////////////////////////////////////////////////
+static size_t run(const char *text, size_t mode, char *output)
+{
+    FILE *stream = tmpfile();
+    char *code = (char *)malloc(strlen(text) + 1);
+
+    if (!stream || !code)
+    {
+        if (stream)
+        {
+            fclose(stream);
+        }
+
+        free(code);
+        return 0;
+    }
+
+    // The tokenizer may write into the text (escape sequences)
+    strcpy(code, text);
+
+    soare_state_t *state = soare_state_new();
+    soare_state_t *previous = soare_state_select(state);
+
+    load_module();
+    soare_closure_mode(mode == 1);
+    soare_jit_mode(mode == 2);
+
+    // Errors are part of the output
+    soare_state_streams(state, NULL, stream, stream);
+    free(soare_state_execute(state, "<fuzz>", code));
+
+    soare_state_free(state);
+    soare_state_select(previous);
+
+    rewind(stream);
+    size_t size = fread(output, 1, FUZZ_OUTPUT - 1, stream);
+    output[size] = 0;
+
+    fclose(stream);
+    free(code);
+    return size;
+}
+
+////////////////////////////////////////////////////////////
+static int compare(unsigned long program, const char *text, char **outputs)
+{
+    size_t sizes[3];
+
+    for (size_t mode = 0; mode < 3; mode++)
+    {
+        sizes[mode] = run(text, mode, outputs[mode]);
+    }
+
+    for (size_t mode = 1; mode < 3; mode++)
+    {
+        if (sizes[mode] == sizes[0] && !memcmp(outputs[mode], outputs[0], sizes[0]))
+        {
+            continue;
+        }
+
+        fprintf(stderr, "Program %lu: %s mode differs from tree mode\n", program, modes[mode]);
+        fprintf(stderr, "--- tree\n%s--- %s\n%s---\n", outputs[0], modes[mode], outputs[mode]);
+        return 0;
+    }
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static int options(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strncmp(argv[i], "--programs=", 11))
+        {
+            programs = strtoul(argv[i] + 11, NULL, 10);
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--seed=", 7))
+        {
+            seed = strtoul(argv[i] + 7, NULL, 10);
+            continue;
+        }
+
+        if (!strncmp(argv[i], "--emit=", 7))
+        {
+            emit = argv[i] + 7;
+            continue;
+        }
+
+        fprintf(stderr, "Usage: %s [--programs=n] [--seed=n] [--emit=file]\n", argv[0]);
+        return 0;
+    }
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    if (!options(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    char *outputs[3] = {NULL, NULL, NULL};
+    unsigned long differences = 0;
+
+    for (size_t mode = 0; mode < 3; mode++)
+    {
+        outputs[mode] = (char *)malloc(FUZZ_OUTPUT);
+    }
+
+    for (unsigned long program = 0; program < programs; program++)
+    {
+        char *text = outputs[0] && outputs[1] && outputs[2] ? generate() : NULL;
+
+        if (!text)
+        {
+            fprintf(stderr, "Out of memory\n");
+            differences++;
+            break;
+        }
+
+        if (!compare(program, text, outputs) && !differences++ && emit)
+        {
+            FILE *file = fopen(emit, "w");
+
+            if (file)
+            {
+                fputs(text, file);
+                fclose(file);
+            }
+            else
+            {
+                perror(emit);
+            }
+        }
+
+        free(text);
+    }
+
+    for (size_t mode = 0; mode < 3; mode++)
+    {
+        free(outputs[mode]);
+    }
+
+    printf("%lu programs, %lu differences\n", programs, differences);
+    return differences ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Launch.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Launch benchmark for `soare --fork-server`
+ *
+ * Launches the same file many times through the fork server, then
+ * (when an interpreter is given) as many times as a new process, and
+ * prints the average time to the first byte written by the script and
+ * to its end. With 0 runs, the file is launched once with the streams
+ * of this program, which exits with the errorlevel of the script
+ *
+ * Usage: soare-launch <socket> <file.soare> [runs] [interpreter]
+ *
+ */
+
+/**
+ * @brief Launch timings, in seconds
+ */
+typedef struct timing
+{
+
+    double first;   /**< Until the first byte of output */
+    double total;   /**< Until the end of the script    */
+    int errorlevel; /**< Errorlevel of the script       */
+
+} timing_t;
+
+////////////////////////////////////////////////////////////
+static double elapsed(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+////////////////////////////////////////////////////////////
+static int send_all(int fd, const char *data, size_t size)
+{
+    while (size)
+    {
+        ssize_t written = write(fd, data, size);
+
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (written <= 0)
+        {
+            return 0;
+        }
+
+        data += written;
+        size -= (size_t)written;
+    }
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static int launch(const char *path, const char *file, const int streams[3])
+{
+    // Returns the connection, the errorlevel follows on it
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        perror(path);
+        return -1;
+    }
+
+    int descriptors[4] = {streams[0], streams[1], streams[2], open(".", O_RDONLY | O_DIRECTORY)};
+
+    char header[64];
+    int length = snprintf(header, sizeof(header), "file %zu\n", strlen(file));
+
+    char control[CMSG_SPACE(sizeof(descriptors))];
+    memset(control, 0, sizeof(control));
+
+    // Request: "file <length>\n<filename>", with the descriptors
+    struct iovec data = {header, (size_t)length};
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr *rights = CMSG_FIRSTHDR(&message);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(descriptors));
+    memcpy(CMSG_DATA(rights), descriptors, sizeof(descriptors));
+
+    int sent = descriptors[3] >= 0 && sendmsg(fd, &message, 0) == length && send_all(fd, file, strlen(file));
+    close(descriptors[3]);
+
+    if (!sent)
+    {
+        perror("sendmsg");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+////////////////////////////////////////////////////////////
+static int launch_status(int fd)
+{
+    char response[32] = {0};
+    size_t size = 0;
+
+    while (size < sizeof(response) - 1)
+    {
+        ssize_t part = read(fd, response + size, sizeof(response) - 1 - size);
+
+        if (part < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (part <= 0)
+        {
+            break;
+        }
+
+        size += (size_t)part;
+    }
+
+    close(fd);
+
+    // No response: the script was killed
+    return size ? atoi(response) : -1;
+}
+
+////////////////////////////////////////////////////////////
+static double first_byte(int output, const struct timespec *start)
+{
+    // Time of the first byte, then the rest is skipped
+    char buffer[4096];
+    double first = -1;
+    ssize_t size = 0;
+
+    while ((size = read(output, buffer, sizeof(buffer))) != 0)
+    {
+        if (size < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (size < 0)
+        {
+            break;
+        }
+
+        if (first < 0)
+        {
+            first = elapsed(start);
+        }
+    }
+
+    close(output);
+    return first;
+}
+
+////////////////////////////////////////////////////////////
+static int run_server(const char *path, const char *file, int null, timing_t *timing)
+{
+    int output[2];
+
+    if (pipe(output) < 0)
+    {
+        return 0;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int streams[3] = {null, output[1], STDERR_FILENO};
+    int fd = launch(path, file, streams);
+    close(output[1]);
+
+    if (fd < 0)
+    {
+        close(output[0]);
+        return 0;
+    }
+
+    timing->first = first_byte(output[0], &start);
+    timing->errorlevel = launch_status(fd);
+    timing->total = elapsed(&start);
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static int run_cold(const char *interpreter, const char *file, int null, timing_t *timing)
+{
+    int output[2];
+
+    if (pipe(output) < 0)
+    {
+        return 0;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pid_t child = fork();
+
+    if (!child)
+    {
+        dup2(null, STDIN_FILENO);
+        dup2(output[1], STDOUT_FILENO);
+        close(output[0]);
+        close(output[1]);
+
+        execl(interpreter, interpreter, file, (char *)NULL);
+        perror(interpreter);
+        _exit(127);
+    }
+
+    close(output[1]);
+
+    if (child < 0)
+    {
+        close(output[0]);
+        return 0;
+    }
+
+    timing->first = first_byte(output[0], &start);
+
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR)
+        ;
+
+    timing->total = elapsed(&start);
+    timing->errorlevel = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static void report(const char *name, const timing_t *timings, unsigned long runs)
+{
+    double first = 0;
+    double total = 0;
+    unsigned long failed = 0;
+
+    for (unsigned long i = 0; i < runs; i++)
+    {
+        first += timings[i].first > 0 ? timings[i].first : timings[i].total;
+        total += timings[i].total;
+        failed += timings[i].errorlevel != 0;
+    }
+
+    double count = runs ? (double)runs : 1.0;
+    printf("%s: %lu runs, %lu failed, first output %.3f ms, total %.3f ms\n", name, runs, failed, first * 1e3 / count, total * 1e3 / count);
+}
+
+////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <socket> <file.soare> [runs] [interpreter]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    unsigned long runs = argc > 3 ? strtoul(argv[3], NULL, 10) : 100;
+
+    if (!runs)
+    {
+        int streams[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+        int fd = launch(argv[1], argv[2], streams);
+
+        return fd < 0 ? EXIT_FAILURE : launch_status(fd);
+    }
+
+    int null = open("/dev/null", O_RDWR);
+    timing_t *timings = (timing_t *)calloc(runs, sizeof(timing_t));
+
+    if (null < 0 || !timings)
+    {
+        fprintf(stderr, "Cannot start the benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    unsigned long done = 0;
+
+    for (; done < runs && run_server(argv[1], argv[2], null, &timings[done]); done++)
+        ;
+
+    report("fork-server", timings, done);
+    int status = done == runs ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (argc > 4)
+    {
+        for (done = 0; done < runs && run_cold(argv[4], argv[2], null, &timings[done]); done++)
+            ;
+
+        report("cold", timings, done);
+        status = done == runs ? status : EXIT_FAILURE;
+    }
+
+    free(timings);
+    close(null);
+
+    return status;
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Loadgen.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Load generator for `soare --serve`
+ *
+ * Sends the same script as many jobs over several connections,
+ * each keeping a number of jobs in flight, and prints the number
+ * of jobs per second
+ *
+ * Usage: soare-loadgen <socket> <file.soare> [jobs] [connections] [depth]
+ *
+ */
+
+/**
+ * @brief Connection settings and results
+ */
+typedef struct client
+{
+
+    const char *socket;   /**< Server socket path            */
+    const char *request;  /**< Framed request (one job)      */
+    size_t length;        /**< Request length                */
+    unsigned long jobs;   /**< Jobs to send                  */
+    unsigned long depth;  /**< Jobs in flight                */
+    unsigned long done;   /**< Responses received            */
+    unsigned long failed; /**< Responses with an errorlevel  */
+
+} client_t;
+
+////////////////////////////////////////////////////////////
+static int send_all(int fd, const char *data, size_t size)
+{
+    while (size)
+    {
+        ssize_t written = write(fd, data, size);
+
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (written <= 0)
+        {
+            return 0;
+        }
+
+        data += written;
+        size -= (size_t)written;
+    }
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static void *run_client(void *data)
+{
+    client_t *client = (client_t *)data;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, client->socket, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        perror(client->socket);
+        return NULL;
+    }
+
+    FILE *responses = fdopen(dup(fd), "rb");
+    unsigned long sent = 0;
+    char header[256];
+
+    while (client->done < client->jobs && responses)
+    {
+        // Keep the pipeline full
+        while (sent < client->jobs && sent - client->done < client->depth)
+        {
+            if (!send_all(fd, client->request, client->length))
+            {
+                client->jobs = sent;
+                break;
+            }
+
+            sent++;
+        }
+
+        if (client->done >= sent || !fgets(header, sizeof(header), responses))
+        {
+            break;
+        }
+
+        int errorlevel = 0;
+        unsigned long output = 0;
+        unsigned long error = 0;
+
+        if (sscanf(header, "%*s %d %lu %lu", &errorlevel, &output, &error) != 3)
+        {
+            fprintf(stderr, "Invalid response: %s", header);
+            break;
+        }
+
+        // Skip the output
+        for (unsigned long i = 0; i < output + error && fgetc(responses) != EOF; i++)
+            ;
+
+        client->done++;
+        client->failed += errorlevel != 0;
+    }
+
+    if (responses)
+    {
+        fclose(responses);
+    }
+
+    close(fd);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <socket> <file.soare> [jobs] [connections] [depth]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    unsigned long jobs = argc > 3 ? strtoul(argv[3], NULL, 10) : 10000;
+    unsigned long connections = argc > 4 ? strtoul(argv[4], NULL, 10) : 4;
+    unsigned long depth = argc > 5 ? strtoul(argv[5], NULL, 10) : 16;
+
+    if (!jobs || !connections || !depth)
+    {
+        fprintf(stderr, "jobs, connections and depth must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = fopen(argv[2], "rb");
+
+    if (!file)
+    {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    // Request: "code <id> <length>\n<source>"
+    char *request = (char *)malloc((size_t)size + 64);
+    client_t *clients = (client_t *)calloc(connections, sizeof(client_t));
+    pthread_t *threads = (pthread_t *)calloc(connections, sizeof(pthread_t));
+
+    if (size < 0 || !request || !clients || !threads)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    int header = sprintf(request, "code job %ld\n", size);
+    size_t length = (size_t)header + fread(request + header, 1, (size_t)size, file);
+    fclose(file);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (unsigned long i = 0; i < connections; i++)
+    {
+        clients[i].socket = argv[1];
+        clients[i].request = request;
+        clients[i].length = length;
+        clients[i].jobs = jobs / connections + (i < jobs % connections);
+        clients[i].depth = depth;
+
+        pthread_create(&threads[i], NULL, run_client, &clients[i]);
+    }
+
+    unsigned long done = 0;
+    unsigned long failed = 0;
+
+    for (unsigned long i = 0; i < connections; i++)
+    {
+        pthread_join(threads[i], NULL);
+        done += clients[i].done;
+        failed += clients[i].failed;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("jobs: %lu\nfailed: %lu\nseconds: %.3f\njobs/s: %.1f\n", done, failed, seconds, seconds > 0 ? (double)done / seconds : 0.0);
+
+    free(request);
+    free(clients);
+    free(threads);
+
+    return done == jobs ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Allocator.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+// Blocks are tracked where soare_alloc() is called
+#define __SOARE_TRACK_INTERNAL
+#include <SOARE/SOARE.h>
+
+/**
+ *
+ * Each block starts with a header naming its state, so that it goes
+ * back to the right allocator and counters when another state (or
+ * none) is selected. Blocks of shared trees have no state
+ *
+ */
+
+/**
+ * @brief Header of a block
+ */
+typedef struct allocation
+{
+
+    soare_state_t *owner;              /**< Counting state, or NULL (malloc) */
+    unsigned long long size : 56;      /**< Requested size                   */
+    unsigned long long category : 8;   /**< Category of the block            */
+
+} allocation_t;
+
+/* Nested soare_memory_shared() calls of the thread */
+static _Thread_local unsigned int shared_depth = 0;
+
+////////////////////////////////////////////////////////////
+static boolean_t over_quota(const soare_state_t *state, soare_memory_t category, size_t size)
+{
+    const soare_memory_usage_t *usage = &state->memory[category];
+    const soare_memory_usage_t *total = &state->memory[SOARE_MEMORY_TOTAL];
+
+    return (usage->quota && usage->live + size > usage->quota) || (total->quota && total->live + size > total->quota);
+}
+
+////////////////////////////////////////////////////////////
+static void count(soare_state_t *state, soare_memory_t category, size_t size)
+{
+    soare_memory_t counted[2] = {category, SOARE_MEMORY_TOTAL};
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        soare_memory_usage_t *usage = &state->memory[counted[i]];
+
+        // Read by soare_state_stats() from other threads
+        size_t live = __atomic_add_fetch(&usage->live, size, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&usage->count, 1, __ATOMIC_RELAXED);
+
+        if (live > usage->peak)
+        {
+            usage->peak = live;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void uncount(soare_state_t *state, soare_memory_t category, size_t size)
+{
+    soare_memory_t counted[2] = {category, SOARE_MEMORY_TOTAL};
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        soare_memory_usage_t *usage = &state->memory[counted[i]];
+        size_t live = __atomic_load_n(&usage->live, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&usage->live, size < live ? size : live, __ATOMIC_RELAXED);
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void quota_exceeded(void)
+{
+    // Once: the code stops at its next check
+    if (!soare_errorlevel())
+    {
+        soare_leave_exception(MemoryError, "QUOTA EXCEEDED", soare_empty_document());
+    }
+}
+
+////////////////////////////////////////////////////////////
+void *soare_alloc(soare_memory_t category, size_t size)
+{
+    soare_state_t *state = shared_depth ? NULL : soare_state_current();
+    allocation_t *block = NULL;
+
+    if (state && state->allocator.alloc)
+    {
+        block = (allocation_t *)state->allocator.alloc(state->allocator.data, sizeof(allocation_t) + size);
+    }
+    else
+    {
+        block = (allocation_t *)malloc(sizeof(allocation_t) + size);
+    }
+
+    if (!block)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    block->owner = state;
+    block->size = size;
+    block->category = category;
+
+    if (state)
+    {
+        if (over_quota(state, category, size))
+        {
+            quota_exceeded();
+        }
+
+        count(state, category, size);
+    }
+
+    return block + 1;
+}
+
+////////////////////////////////////////////////////////////
+char *soare_strdup(soare_memory_t category, const char *string)
+{
+    size_t size = strlen(string) + 1;
+    char *copy = (char *)soare_alloc(category, size);
+
+    if (copy)
+    {
+        memcpy(copy, string, size);
+    }
+
+    return copy;
+}
+
+////////////////////////////////////////////////////////////
+void soare_free(void *pointer)
+{
+    if (!pointer)
+    {
+        return;
+    }
+
+    allocation_t *block = (allocation_t *)pointer - 1;
+    soare_state_t *state = block->owner;
+
+    if (!state)
+    {
+        free(block);
+        return;
+    }
+
+    size_t size = block->size;
+    uncount(state, (soare_memory_t)block->category, size);
+
+    if (state->allocator.free)
+    {
+        state->allocator.free(state->allocator.data, block, sizeof(allocation_t) + size);
+        return;
+    }
+
+    free(block);
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_memory_account(soare_memory_t category, size_t counted, size_t size)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (size <= counted)
+    {
+        uncount(state, category, counted - size);
+        return bTrue;
+    }
+
+    if (over_quota(state, category, size - counted))
+    {
+        quota_exceeded();
+        return bFalse;
+    }
+
+    count(state, category, size - counted);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+void soare_memory_shared(boolean_t shared)
+{
+    if (shared)
+    {
+        shared_depth++;
+        return;
+    }
+
+    shared_depth -= shared_depth ? 1 : 0;
+}
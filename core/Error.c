@@ -16,15 +16,6 @@
 
 #include <SOARE/SOARE.h>
 
-/* Enable/Disable error display */
-static boolean_t enable_error_display = bTrue;
-
-/* Contains the current SOARE error level */
-static int error_level = EXIT_SUCCESS;
-
-/* Contains the latest SOARE error */
-static char *last_error = NULL;
-
 /* List of SOARE Exceptions */
 static char *exceptions_list[] = {
 
@@ -44,50 +35,70 @@ static char *exceptions_list[] = {
     "InvalidEscapeSequence",
     "IndexOutOfRange",
     "DivideByZero",
-    "RaiseException"
+    "RaiseException",
+    "TimeoutError"
 
 };
 
 ////////////////////////////////////////////////////////////
 char *soare_get_exception(void)
 {
-    return last_error;
+    return soare_state_current()->last_error;
+}
+
+////////////////////////////////////////////////////////////
+soare_exceptions_t soare_get_exception_type(void)
+{
+    const char *name = soare_state_current()->last_error;
+
+    for (unsigned int i = 0; i < sizeof(exceptions_list) / sizeof(*exceptions_list); i++)
+    {
+        if (exceptions_list[i] == name)
+        {
+            return (soare_exceptions_t)i;
+        }
+    }
+
+    return InterpreterError;
 }
 
 ////////////////////////////////////////////////////////////
 void soare_clear_exception(void)
 {
-    error_level = EXIT_SUCCESS;
+    soare_state_current()->error_level = EXIT_SUCCESS;
 }
 
 ////////////////////////////////////////////////////////////
 void soare_ignore_exception(boolean_t ignore)
 {
-    enable_error_display = !ignore;
+    soare_state_current()->error_display = !ignore;
 }
 
 ////////////////////////////////////////////////////////////
 boolean_t soare_as_ignored_exception(void)
 {
-    return !enable_error_display;
+    return !soare_state_current()->error_display;
 }
 
 ////////////////////////////////////////////////////////////
 int soare_errorlevel(void)
 {
-    return error_level;
+    return soare_state_current()->error_level;
 }
 
 ////////////////////////////////////////////////////////////
 void soare_leave_exception(soare_exceptions_t error, const char *string, document_t file)
 {
+    soare_state_t *state = soare_state_current();
+    SOARE_STATS_ADD(state, raised, 1);
+
     // Set lasterror
-    last_error = exceptions_list[error];
+    state->last_error = exceptions_list[error];
     // Set error at level EXIT_FAILURE (1)
-    error_level = EXIT_FAILURE;
+    state->error_level = EXIT_FAILURE;
 
     // If the errors are disabled, nothing is displayed
-    if (enable_error_display)
+    if (state->error_display)
     {
         soare_write(
             //
@@ -102,7 +113,7 @@ void soare_leave_exception(soare_exceptions_t error, const char *string, documen
             "\033[0m"
 #endif /* __SOARE_COLORED_OUTPUT */
             ,
-            last_error,
+            state->last_error,
             string,
             file.filename,
             file.ln,
@@ -0,0 +1,734 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#define __SOARE_GENERATORS
+#endif
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define __SOARE_GENERATOR_X86_64
+#endif
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Generator.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#include <SOARE/SOARE.h>
+
+/* Generator handle prefix */
+#define GENERATOR_PREFIX "generator:"
+/* Initial number of buckets of the generators table */
+#define GENERATOR_BUCKETS 64
+/* Number of stacks carved from each region */
+#define GENERATOR_REGION 64
+/* Number of free stacks keeping their pages */
+#define GENERATOR_WARM 8
+
+#ifdef __SOARE_GENERATORS
+
+/**
+ *
+ * Generators
+ *
+ * The body of a generator runs on its own stack, so `runtime()`
+ * suspends it at a `yield` by switching back to the stack of the
+ * caller, with every frame of the body left as it was
+ *
+ * Variables are the other half of the frame: while it runs, the body
+ * registers its variables on top of the ones of the caller, like any
+ * function. At each `yield`, they are unlinked and kept with the
+ * generator, then registered again on top of the variables of the
+ * next caller, moved to its scope level. A first hidden variable (no
+ * name) is kept below them, so that the marks taken by the body never
+ * point to a variable of a caller
+ *
+ * On x86-64, stacks are switched by saving the callee-saved registers
+ * and the stack pointer. Elsewhere `swapcontext()` is used, which also
+ * saves the signal mask (a system call at each switch)
+ *
+ * Stacks are carved from large regions instead of being mapped one by
+ * one: the number of mappings of a process is limited, and tasks of
+ * the event loop may leave tens of thousands of generators suspended.
+ * Only the first stack of a region has a guard page below it, the
+ * depth of the others is checked by `soare_generator_overflow()`
+ *
+ */
+
+#ifdef __SOARE_GENERATOR_X86_64
+
+/* Saved stack pointer */
+typedef void *generator_context_t;
+
+////////////////////////////////////////////////////////////
+__attribute__((naked, noinline)) static void generator_switch(__attribute__((unused)) generator_context_t *from, __attribute__((unused)) generator_context_t to)
+{
+    // System V: rbx, rbp and r12 to r15 belong to the caller
+    __asm__ volatile(
+        "pushq %rbp\n\t"
+        "pushq %rbx\n\t"
+        "pushq %r12\n\t"
+        "pushq %r13\n\t"
+        "pushq %r14\n\t"
+        "pushq %r15\n\t"
+        "movq %rsp, (%rdi)\n\t"
+        "movq %rsi, %rsp\n\t"
+        "popq %r15\n\t"
+        "popq %r14\n\t"
+        "popq %r13\n\t"
+        "popq %r12\n\t"
+        "popq %rbx\n\t"
+        "popq %rbp\n\t"
+        "ret\n\t");
+}
+
+////////////////////////////////////////////////////////////
+static void context_make(generator_context_t *context, void *stack, size_t size, void (*entry)(void))
+{
+    // Saved registers, then `entry` as return address, then a fake
+    // return address for `entry` (aligned as after a call)
+    void **top = (void **)(((unsigned long)stack + size) & ~15UL);
+
+    top -= 2;
+    top[0] = (void *)entry;
+    top[1] = NULL;
+
+    top -= 6;
+    memset(top, 0, 6 * sizeof(void *));
+
+    *context = (generator_context_t)top;
+}
+
+////////////////////////////////////////////////////////////
+static void context_switch(generator_context_t *from, generator_context_t *to)
+{
+    generator_switch(from, *to);
+}
+
+#else
+
+/* Saved registers and signal mask */
+typedef ucontext_t generator_context_t;
+
+////////////////////////////////////////////////////////////
+static void context_make(generator_context_t *context, void *stack, size_t size, void (*entry)(void))
+{
+    getcontext(context);
+    context->uc_stack.ss_sp = stack;
+    context->uc_stack.ss_size = size;
+    context->uc_link = NULL;
+    makecontext(context, entry, 0);
+}
+
+////////////////////////////////////////////////////////////
+static void context_switch(generator_context_t *from, generator_context_t *to)
+{
+    swapcontext(from, to);
+}
+
+#endif /* __SOARE_GENERATOR_X86_64 */
+
+/* Generator life cycle */
+typedef enum generator_status
+{
+
+    GENERATOR_NEW,       /**< Not started       */
+    GENERATOR_SUSPENDED, /**< Waiting at a yield */
+    GENERATOR_RUNNING,   /**< Running           */
+    GENERATOR_DONE       /**< Body returned     */
+
+} generator_status_t;
+
+/* Suspended function */
+typedef struct soare_generator
+{
+
+    unsigned long id;                 /**< Handle number                         */
+    ast_t body;                       /**< NODE_GENERATOR node                   */
+    generator_status_t status;        /**< Life cycle                            */
+    boolean_t closing;                /**< Return from the current yield         */
+    char *value;                      /**< Yielded value                         */
+
+    soare_variables_t *frame;         /**< Unlinked variables while suspended    */
+    soare_variables_t *mark;          /**< Last variable of the caller           */
+    unsigned long long base;          /**< Scope level of the caller             */
+    unsigned long long scope;         /**< Scope level of the body               */
+    boolean_t display;                /**< Error display of the body             */
+
+    void *stack;                      /**< Stack, carved from a region           */
+    generator_context_t context;      /**< Suspended body                        */
+    generator_context_t caller;       /**< Suspended caller                      */
+    struct soare_generator *resumer;  /**< Generator running before this one     */
+    struct soare_generator *next;     /**< Next generator of the state           */
+    struct soare_generator *prev;     /**< Previous generator of the state       */
+    struct soare_generator *bucket;   /**< Next generator of the same bucket     */
+
+} soare_generator_t;
+
+/* Header of a region, after its last stack */
+typedef struct generator_region
+{
+
+    struct generator_region *next; /**< Previous region of the state */
+    unsigned long used;            /**< Number of carved stacks      */
+
+} generator_region_t;
+
+/* Generator running on the calling thread */
+static _Thread_local soare_generator_t *running = NULL;
+
+////////////////////////////////////////////////////////////
+static size_t generator_page(void)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096;
+}
+
+////////////////////////////////////////////////////////////
+static size_t generator_region_size(void)
+{
+    // A guard page, the stacks, then the header
+    return generator_page() + GENERATOR_REGION * (size_t)SOARE_GENERATOR_STACK + generator_page();
+}
+
+////////////////////////////////////////////////////////////
+static void *generator_stack(soare_state_t *state)
+{
+    // Reuse the stack of a finished generator
+    if (state->generators_stacks_count)
+    {
+        return state->generators_stacks[--state->generators_stacks_count];
+    }
+
+    generator_region_t *region = (generator_region_t *)state->generators_regions;
+
+    if (!region || region->used == GENERATOR_REGION)
+    {
+        // Room to give back every stack of the new region
+        unsigned long size = state->generators_stacks_size + GENERATOR_REGION;
+        void **stacks = (void **)realloc(state->generators_stacks, size * sizeof(void *));
+
+        if (!stacks)
+        {
+            return NULL;
+        }
+
+        state->generators_stacks = stacks;
+        state->generators_stacks_size = size;
+
+        size_t guard = generator_page();
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_NORESERVE
+        // Only the touched pages are used: do not reserve the stacks
+        flags |= MAP_NORESERVE;
+#endif
+
+        char *base = (char *)mmap(NULL, generator_region_size(), PROT_READ | PROT_WRITE, flags, -1, 0);
+
+        if (base == MAP_FAILED)
+        {
+            return NULL;
+        }
+
+        // An overflow of the first stack faults instead of writing below the region
+        if (mprotect(base, guard, PROT_NONE))
+        {
+            munmap(base, generator_region_size());
+            return NULL;
+        }
+
+        region = (generator_region_t *)(base + guard + GENERATOR_REGION * (size_t)SOARE_GENERATOR_STACK);
+        region->next = (generator_region_t *)state->generators_regions;
+        region->used = 0;
+
+        state->generators_regions = region;
+    }
+
+    return (char *)region - (GENERATOR_REGION - region->used++) * (size_t)SOARE_GENERATOR_STACK;
+}
+
+////////////////////////////////////////////////////////////
+static void generator_release(soare_state_t *state, void *stack)
+{
+#ifdef MADV_DONTNEED
+    // A few stacks keep their pages for the next generators
+    if (state->generators_stacks_count >= GENERATOR_WARM)
+    {
+        madvise(stack, SOARE_GENERATOR_STACK, MADV_DONTNEED);
+    }
+#endif
+
+    // Never full: there is room for every carved stack
+    state->generators_stacks[state->generators_stacks_count++] = stack;
+}
+
+////////////////////////////////////////////////////////////
+static void generator_unmap(soare_state_t *state)
+{
+    generator_region_t *region = (generator_region_t *)state->generators_regions;
+
+    while (region)
+    {
+        generator_region_t *next = region->next;
+        munmap((char *)region - GENERATOR_REGION * (size_t)SOARE_GENERATOR_STACK - generator_page(), generator_region_size());
+        region = next;
+    }
+
+    free(state->generators_stacks);
+
+    state->generators_regions = NULL;
+    state->generators_stacks = NULL;
+    state->generators_stacks_count = 0;
+    state->generators_stacks_size = 0;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t generator_register(soare_state_t *state, soare_generator_t *generator)
+{
+    // Keep about one generator per bucket: tasks of the event loop
+    // may leave tens of thousands of them suspended
+    if (state->generators_count >= state->generators_ids_size)
+    {
+        unsigned long size = state->generators_ids_size ? state->generators_ids_size * 2 : GENERATOR_BUCKETS;
+        soare_generator_t **table = (soare_generator_t **)calloc(size, sizeof(soare_generator_t *));
+
+        if (!table && !state->generators_ids)
+        {
+            return bFalse;
+        }
+
+        if (table)
+        {
+            for (soare_generator_t *old = state->generators; old; old = old->next)
+            {
+                old->bucket = table[old->id & (size - 1)];
+                table[old->id & (size - 1)] = old;
+            }
+
+            free(state->generators_ids);
+            state->generators_ids = table;
+            state->generators_ids_size = size;
+        }
+    }
+
+    soare_generator_t **bucket = &state->generators_ids[generator->id & (state->generators_ids_size - 1)];
+    generator->bucket = *bucket;
+    *bucket = generator;
+
+    generator->prev = NULL;
+    generator->next = state->generators;
+
+    if (state->generators)
+    {
+        state->generators->prev = generator;
+    }
+
+    state->generators = generator;
+    state->generators_count++;
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static soare_generator_t *generator_find(soare_state_t *state, unsigned long id)
+{
+    if (!state->generators_ids)
+    {
+        return NULL;
+    }
+
+    soare_generator_t *generator = state->generators_ids[id & (state->generators_ids_size - 1)];
+
+    while (generator && generator->id != id)
+    {
+        generator = generator->bucket;
+    }
+
+    return generator;
+}
+
+////////////////////////////////////////////////////////////
+static void generator_free(soare_generator_t *generator)
+{
+    soare_state_t *state = soare_state_current();
+
+    for (soare_generator_t **link = &state->generators_ids[generator->id & (state->generators_ids_size - 1)]; *link; link = &(*link)->bucket)
+    {
+        if (*link == generator)
+        {
+            *link = generator->bucket;
+            break;
+        }
+    }
+
+    if (generator->prev)
+    {
+        generator->prev->next = generator->next;
+    }
+    else
+    {
+        state->generators = generator->next;
+    }
+
+    if (generator->next)
+    {
+        generator->next->prev = generator->prev;
+    }
+
+    state->generators_count--;
+
+    if (generator->frame)
+    {
+        // Registered again only to be freed
+        soare_variables_t *mark = soare_last_variable();
+        soare_attach_variables(generator->frame, 0);
+        soare_reset_scope(mark);
+    }
+
+    generator_release(state, generator->stack);
+
+    free(generator->value);
+    free(generator);
+}
+
+////////////////////////////////////////////////////////////
+static void generator_main(void)
+{
+    soare_state_t *state = soare_state_current();
+    soare_generator_t *generator = running;
+
+    // Kept until the generator is freed
+    generator->value = soare_run_body(generator->body);
+
+    soare_reset_scope(generator->mark);
+    __atomic_store_n(&state->scope, generator->base, __ATOMIC_RELAXED);
+
+    generator->status = GENERATOR_DONE;
+    context_switch(&generator->context, &generator->caller);
+}
+
+////////////////////////////////////////////////////////////
+static void generator_resume(soare_generator_t *generator)
+{
+    soare_state_t *state = soare_state_current();
+
+    // The frame follows the scope of the caller
+    long long shift = (long long)(state->scope - generator->base);
+
+    generator->mark = soare_last_variable();
+    soare_attach_variables(generator->frame, shift);
+
+    generator->frame = NULL;
+    generator->base = state->scope;
+
+    boolean_t broken = state->broken;
+    boolean_t returned = state->returned;
+    boolean_t display = state->error_display;
+
+    __atomic_store_n(&state->scope, generator->scope + (unsigned long long)shift, __ATOMIC_RELAXED);
+
+    if (generator->status == GENERATOR_SUSPENDED)
+    {
+        state->error_display = generator->display;
+    }
+
+    generator->status = GENERATOR_RUNNING;
+    generator->resumer = running;
+    running = generator;
+
+    context_switch(&generator->caller, &generator->context);
+
+    running = generator->resumer;
+
+    state->broken = broken;
+    state->returned = returned;
+    state->error_display = display;
+}
+
+////////////////////////////////////////////////////////////
+static soare_generator_t *generator_get(char *handle, document_t file)
+{
+    soare_state_t *state = soare_state_current();
+
+    size_t length = strlen(GENERATOR_PREFIX);
+    char *end = NULL;
+    unsigned long id = 0;
+
+    if (handle && !strncmp(handle, GENERATOR_PREFIX, length))
+    {
+        id = strtoul(handle + length, &end, 10);
+    }
+
+    if (!id || *end || id > state->generators_id)
+    {
+        soare_leave_exception(ValueError, handle ? handle : "", file);
+        return NULL;
+    }
+
+    // Finished if not found
+    return generator_find(state, id);
+}
+
+////////////////////////////////////////////////////////////
+char *soare_generator_new(ast_t body, soare_variables_t *mark, document_t file)
+{
+    soare_state_t *state = soare_state_current();
+
+    soare_generator_t *generator = (soare_generator_t *)calloc(1, sizeof(soare_generator_t));
+    soare_variables_t *first = (soare_variables_t *)soare_alloc(SOARE_MEMORY_VARIABLES, sizeof(soare_variables_t));
+    char *handle = (char *)malloc(sizeof(GENERATOR_PREFIX) + 20);
+
+    if (generator)
+    {
+        generator->id = state->generators_id + 1;
+    }
+
+    if (!generator || !first || !handle || !(generator->stack = generator_stack(state)) || !generator_register(state, generator))
+    {
+        if (generator && generator->stack)
+        {
+            generator_release(state, generator->stack);
+        }
+
+        free(generator);
+        soare_free(first);
+        free(handle);
+        soare_reset_scope(mark);
+        soare_leave_exception(MemoryError, "OUT OF MEMORY", file);
+        return NULL;
+    }
+
+    // Arguments are registered one level above the caller
+    memset(first, 0, sizeof(soare_variables_t));
+    first->scope = state->scope + 1;
+    first->mutable = bTrue;
+
+    generator->frame = first;
+    first->next = soare_detach_variables(mark);
+
+    if (first->next)
+    {
+        first->next->prev = first;
+    }
+
+    context_make(&generator->context, generator->stack, SOARE_GENERATOR_STACK, generator_main);
+
+    state->generators_id = generator->id;
+    generator->body = body;
+    generator->base = state->scope;
+    generator->scope = state->scope + 1;
+    generator->status = GENERATOR_NEW;
+
+    sprintf(handle, GENERATOR_PREFIX "%lu", generator->id);
+    return handle;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_generator_next(char *handle, char **value, document_t file)
+{
+    *value = NULL;
+
+    soare_generator_t *generator = generator_get(handle, file);
+
+    if (!generator)
+    {
+        return bFalse;
+    }
+
+    if (generator->status == GENERATOR_RUNNING)
+    {
+        soare_leave_exception(ValueError, handle, file);
+        return bFalse;
+    }
+
+    generator_resume(generator);
+
+    *value = generator->value;
+    generator->value = NULL;
+
+    if (generator->status == GENERATOR_DONE)
+    {
+        generator_free(generator);
+        return bFalse;
+    }
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+unsigned long soare_generator_running(void)
+{
+    return running ? running->id : 0;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_generator_overflow(void)
+{
+    if (!running)
+    {
+        return bFalse;
+    }
+
+    // The stack grows down to the one below it
+    char here = 0;
+    return (char *)&here < (char *)running->stack + SOARE_GENERATOR_RESERVE;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_generator_yield(char *value)
+{
+    soare_state_t *state = soare_state_current();
+    soare_generator_t *generator = running;
+
+    if (!generator)
+    {
+        free(value);
+        return bFalse;
+    }
+
+    generator->value = value;
+    generator->display = state->error_display;
+    generator->scope = state->scope;
+    generator->frame = soare_detach_variables(generator->mark);
+    generator->status = GENERATOR_SUSPENDED;
+
+    __atomic_store_n(&state->scope, generator->base, __ATOMIC_RELAXED);
+
+    context_switch(&generator->context, &generator->caller);
+
+    // Resumed: flags belong to the caller until now
+    state->broken = bFalse;
+    state->returned = generator->closing;
+
+    return !generator->closing;
+}
+
+////////////////////////////////////////////////////////////
+static void generator_close(soare_generator_t *generator)
+{
+    if (generator->status == GENERATOR_RUNNING)
+    {
+        return;
+    }
+
+    // The body returns from its yield and leaves its scopes
+    generator->closing = bTrue;
+
+    while (generator->status == GENERATOR_SUSPENDED)
+    {
+        generator_resume(generator);
+        free(generator->value);
+        generator->value = NULL;
+    }
+
+    generator_free(generator);
+}
+
+////////////////////////////////////////////////////////////
+void soare_generator_close(char *handle)
+{
+    soare_generator_t *generator = generator_get(handle, soare_empty_document());
+
+    if (generator)
+    {
+        generator_close(generator);
+    }
+}
+
+////////////////////////////////////////////////////////////
+void soare_generator_clear(unsigned long last)
+{
+    soare_state_t *state = soare_state_current();
+
+    soare_generator_t **link = &state->generators;
+
+    while (*link)
+    {
+        soare_generator_t *generator = *link;
+
+        if (generator->id <= last || generator->status == GENERATOR_RUNNING)
+        {
+            link = &generator->next;
+            continue;
+        }
+
+        generator_close(generator);
+    }
+
+    if (!state->generators)
+    {
+        if (!last)
+        {
+            generator_unmap(state);
+        }
+
+        free(state->generators_ids);
+        state->generators_ids = NULL;
+        state->generators_ids_size = 0;
+    }
+}
+
+#else
+
+////////////////////////////////////////////////////////////
+char *soare_generator_new(ast_t body, soare_variables_t *mark, document_t file)
+{
+    (void)body;
+    soare_reset_scope(mark);
+    soare_leave_exception(InterpreterError, "not available on this platform", file);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_generator_next(char *handle, char **value, document_t file)
+{
+    *value = NULL;
+    soare_leave_exception(ValueError, handle ? handle : "", file);
+    return bFalse;
+}
+
+////////////////////////////////////////////////////////////
+unsigned long soare_generator_running(void)
+{
+    return 0;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_generator_overflow(void)
+{
+    return bFalse;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_generator_yield(char *value)
+{
+    free(value);
+    return bFalse;
+}
+
+////////////////////////////////////////////////////////////
+void soare_generator_close(char *handle)
+{
+    (void)handle;
+}
+
+////////////////////////////////////////////////////////////
+void soare_generator_clear(unsigned long last)
+{
+    (void)last;
+}
+
+#endif /* __SOARE_GENERATORS */
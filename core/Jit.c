@@ -0,0 +1,1188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#include <sys/mman.h>
+#define __SOARE_JIT_X86_64
+#endif
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Jit.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#include <SOARE/SOARE.h>
+
+////////////////////////////////////////////////////////////
+void soare_jit_mode(boolean_t enabled)
+{
+    soare_state_current()->jit_mode = enabled;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_jit_enabled(void)
+{
+    return soare_state_current()->jit_mode;
+}
+
+#ifdef __SOARE_JIT_X86_64
+
+/**
+ *
+ * Template JIT
+ *
+ * Hot functions and loops made only of integer arithmetic,
+ * comparisons, `let`, assignments, `if`, `while`, `break` and
+ * `return` on local variables are compiled into x86-64 code
+ *
+ * Values are kept as 64-bit integers: the generated code gives up
+ * (bail) on everything the interpreter would not print as an
+ * integer (overflow, fractional division, negative zero...), the
+ * interpreter then runs the code again. Compiled code never calls
+ * back the interpreter, so functions have no side effect and can
+ * be run again from the start
+ *
+ * Each iteration consumes one unit of fuel, the steps left before
+ * the next check of the state budget. A loop runs out of fuel
+ * between two iterations and continues once the slice is over; any
+ * other loop gives up as a bail
+ *
+ * Slots (rbx):
+ *
+ * [0]                  returned value
+ * [1 .. MAX]           variables (parameters and free variables are loaded)
+ * [1 + MAX .. 2 * MAX] copy of the loaded variables at the start of an iteration
+ * [1 + 2 * MAX]        fuel
+ *
+ */
+
+#define JIT_BUCKETS 256
+#define JIT_MAX_SLOTS 64
+#define JIT_MAX_BAILS 16
+
+/* Generated code status */
+#define JIT_BAIL 0
+#define JIT_END 1
+#define JIT_RETURN 2
+#define JIT_RETURN_NULL 3
+#define JIT_YIELD 4
+#define JIT_SLICE 5
+
+/* Slots displacement */
+#define JIT_SLOT(index) (8 * (1 + (index)))
+#define JIT_SHADOW(index) (8 * (1 + JIT_MAX_SLOTS + (index)))
+#define JIT_FUEL (8 * (1 + 2 * JIT_MAX_SLOTS))
+
+/* Number of slots */
+#define JIT_SLOTS (2 + 2 * JIT_MAX_SLOTS)
+
+/**
+ * @brief Compilation state of a function or a loop
+ */
+typedef enum jit_state
+{
+
+    JIT_COLD,     /**< Not compiled yet    */
+    JIT_COMPILED, /**< Compiled            */
+    JIT_REJECTED  /**< Cannot be compiled  */
+
+} jit_state_t;
+
+/**
+ * @brief Compiled function or loop
+ */
+typedef struct jit_unit
+{
+
+    ast_t node;                         /**< NODE_FUNCTION or NODE_REPETITION   */
+    jit_state_t state;                  /**< Compilation state                  */
+    unsigned long long calls;           /**< Calls before compilation           */
+    unsigned int bails;                 /**< Runs given up                      */
+    int (*code)(long long *);           /**< Generated code                     */
+    void *memory;                       /**< Executable mapping                 */
+    size_t length;                      /**< Mapping length                     */
+    unsigned int count;                 /**< Number of slots                    */
+    char *names[JIT_MAX_SLOTS];         /**< Slot names (owned by the tree)     */
+    boolean_t inputs[JIT_MAX_SLOTS];    /**< Slot loaded from a variable        */
+    boolean_t assigned[JIT_MAX_SLOTS];  /**< Slot written by the code           */
+    struct jit_unit *next;              /**< Next unit in the same bucket       */
+
+} jit_unit_t;
+
+/**
+ * @brief Positions of rel32 jumps to resolve
+ */
+typedef struct jit_patches
+{
+
+    size_t *at;      /**< Offsets of the rel32 fields */
+    size_t count;    /**< Number of offsets           */
+    size_t capacity; /**< Allocated offsets           */
+
+} jit_patches_t;
+
+/**
+ * @brief Code generation state
+ */
+typedef struct jit_compiler
+{
+
+    jit_unit_t *unit;                 /**< Compiled unit                   */
+    unsigned char *code;              /**< Code buffer                     */
+    size_t size;                      /**< Code size                       */
+    size_t capacity;                  /**< Code buffer capacity            */
+    jit_patches_t bails;              /**< Jumps to the bail exit          */
+    jit_patches_t exits;              /**< Jumps to the epilogue           */
+    jit_patches_t yields;             /**< Jumps to the out of fuel exit   */
+    jit_patches_t slices;             /**< Jumps to the end of slice exit  */
+    jit_patches_t *breaks;            /**< Jumps out of the innermost loop */
+    boolean_t visible[JIT_MAX_SLOTS]; /**< Slot visible in the scope       */
+    boolean_t loop;                   /**< Compiling a loop (no return)    */
+    boolean_t failed;                 /**< Unsupported node or no memory   */
+
+} jit_compiler_t;
+
+////////////////////////////////////////////////////////////
+static jit_unit_t *jit_unit(ast_t node)
+{
+    // Each state has its own units
+    soare_state_t *state = soare_state_current();
+
+    if (!state->jit_units && !(state->jit_units = (jit_unit_t **)calloc(JIT_BUCKETS, sizeof(jit_unit_t *))))
+    {
+        return NULL;
+    }
+
+    jit_unit_t **units = state->jit_units;
+    unsigned int bucket = (unsigned int)(((size_t)node >> 4) % JIT_BUCKETS);
+
+    for (jit_unit_t *unit = units[bucket]; unit; unit = unit->next)
+    {
+        if (unit->node == node)
+        {
+            return unit;
+        }
+    }
+
+    jit_unit_t *unit = (jit_unit_t *)calloc(1, sizeof(jit_unit_t));
+
+    if (!unit)
+    {
+        return NULL;
+    }
+
+    unit->node = node;
+    unit->state = JIT_COLD;
+    unit->next = units[bucket];
+    units[bucket] = unit;
+
+    return unit;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t jit_integer(const char *string, long long *number)
+{
+    /**
+     *
+     * Only the exact output of the interpreter for an integer is
+     * accepted ("12", "-3", but not "012", "1.0", "+4" or "-0"):
+     * string comparisons then match integer comparisons
+     *
+     */
+
+    if (!string)
+    {
+        return bFalse;
+    }
+
+    const char *chr = string + (*string == '-');
+    long long value = 0;
+    int digits = 0;
+
+    if (*chr == '0')
+    {
+        *number = 0;
+        return !chr[1] && chr == string;
+    }
+
+    // 18 digits always fit: a 19th one may overflow
+    for (; *chr >= '0' && *chr <= '9' && digits < 18; chr++, digits++)
+    {
+        value = value * 10 + (*chr - '0');
+    }
+
+    // More digits, or not a number
+    if (*chr || !digits)
+    {
+        return bFalse;
+    }
+
+    *number = *string == '-' ? -value : value;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static char *jit_string(long long number)
+{
+    char str[24] = {0};
+    sprintf(str, "%lld", number);
+    return strdup(str);
+}
+
+////////////////////////////////////////////////////////////
+static void jit_emit(jit_compiler_t *jit, const unsigned char *bytes, size_t size)
+{
+    if (jit->failed)
+    {
+        return;
+    }
+
+    if (jit->size + size > jit->capacity)
+    {
+        size_t capacity = jit->capacity ? jit->capacity * 2 : 1024;
+        unsigned char *code = (unsigned char *)realloc(jit->code, capacity);
+
+        if (!code)
+        {
+            jit->failed = bTrue;
+            return;
+        }
+
+        jit->code = code;
+        jit->capacity = capacity;
+    }
+
+    memcpy(jit->code + jit->size, bytes, size);
+    jit->size += size;
+}
+
+////////////////////////////////////////////////////////////
+static void jit_emit_u32(jit_compiler_t *jit, unsigned int value)
+{
+    unsigned char bytes[4] = {value, value >> 8, value >> 16, value >> 24};
+    jit_emit(jit, bytes, 4);
+}
+
+////////////////////////////////////////////////////////////
+static void jit_patch_add(jit_compiler_t *jit, jit_patches_t *patches, size_t at)
+{
+    if (patches->count == patches->capacity)
+    {
+        size_t capacity = patches->capacity ? patches->capacity * 2 : 16;
+        size_t *array = (size_t *)realloc(patches->at, capacity * sizeof(size_t));
+
+        if (!array)
+        {
+            jit->failed = bTrue;
+            return;
+        }
+
+        patches->at = array;
+        patches->capacity = capacity;
+    }
+
+    patches->at[patches->count++] = at;
+}
+
+////////////////////////////////////////////////////////////
+static void jit_patch(jit_compiler_t *jit, size_t at, size_t target)
+{
+    if (jit->failed)
+    {
+        return;
+    }
+
+    unsigned int rel = (unsigned int)(target - (at + 4));
+
+    jit->code[at + 0] = rel;
+    jit->code[at + 1] = rel >> 8;
+    jit->code[at + 2] = rel >> 16;
+    jit->code[at + 3] = rel >> 24;
+}
+
+////////////////////////////////////////////////////////////
+static void jit_resolve(jit_compiler_t *jit, jit_patches_t *patches)
+{
+    // All the jumps of the list land here
+    for (size_t i = 0; i < patches->count; i++)
+    {
+        jit_patch(jit, patches->at[i], jit->size);
+    }
+
+    free(patches->at);
+    memset(patches, 0, sizeof(jit_patches_t));
+}
+
+////////////////////////////////////////////////////////////
+static size_t jit_jump(jit_compiler_t *jit, unsigned char condition)
+{
+    /**
+     *
+     * Emit a rel32 jump and return the position of its offset
+     *
+     * condition: 0 for jmp, otherwise the second byte of the
+     * 0F 8x conditional jump (0x84 jz, 0x85 jnz, 0x80 jo, 0x88 js)
+     *
+     */
+
+    if (condition)
+    {
+        unsigned char opcode[2] = {0x0F, condition};
+        jit_emit(jit, opcode, 2);
+    }
+    else
+    {
+        unsigned char opcode[1] = {0xE9};
+        jit_emit(jit, opcode, 1);
+    }
+
+    size_t at = jit->size;
+    jit_emit_u32(jit, 0);
+    return at;
+}
+
+////////////////////////////////////////////////////////////
+static void jit_bail(jit_compiler_t *jit, unsigned char condition)
+{
+    jit_patch_add(jit, &jit->bails, jit_jump(jit, condition));
+}
+
+////////////////////////////////////////////////////////////
+static void jit_fuel(jit_compiler_t *jit, jit_patches_t *patches)
+{
+    // sub qword [rbx + disp32], 1; jb <exit>
+    jit_emit(jit, (unsigned char[]){0x48, 0x83, 0xAB}, 3);
+    jit_emit_u32(jit, JIT_FUEL);
+    jit_emit(jit, (unsigned char[]){0x01}, 1);
+    jit_patch_add(jit, patches, jit_jump(jit, 0x82));
+}
+
+////////////////////////////////////////////////////////////
+static void jit_rbx(jit_compiler_t *jit, unsigned char opcode, int displacement)
+{
+    // mov rax, [rbx + disp32] (8B) / mov [rbx + disp32], rax (89)
+    unsigned char bytes[3] = {0x48, opcode, 0x83};
+    jit_emit(jit, bytes, 3);
+    jit_emit_u32(jit, (unsigned int)displacement);
+}
+
+////////////////////////////////////////////////////////////
+static void jit_status(jit_compiler_t *jit, unsigned int status)
+{
+    // mov eax, imm32
+    unsigned char opcode[1] = {0xB8};
+    jit_emit(jit, opcode, 1);
+    jit_emit_u32(jit, status);
+}
+
+////////////////////////////////////////////////////////////
+static void jit_epilogue(jit_compiler_t *jit)
+{
+    // Bails may leave operands on the stack: rsp comes from rbp
+    // mov rbx, [rbp - 8]; leave; ret
+    jit_emit(jit, (unsigned char[]){0x48, 0x8B, 0x5D, 0xF8, 0xC9, 0xC3}, 6);
+}
+
+////////////////////////////////////////////////////////////
+static int jit_find(jit_compiler_t *jit, const char *name)
+{
+    for (unsigned int i = 0; i < jit->unit->count; i++)
+    {
+        if (!strcmp(jit->unit->names[i], name))
+        {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+////////////////////////////////////////////////////////////
+static int jit_declare(jit_compiler_t *jit, char *name, boolean_t input)
+{
+    // Each name has a single slot in the unit: redeclarations
+    // and shadowing are left to the interpreter
+    if (!name || jit_find(jit, name) >= 0 || jit->unit->count >= JIT_MAX_SLOTS)
+    {
+        jit->failed = bTrue;
+        return -1;
+    }
+
+    unsigned int slot = jit->unit->count++;
+
+    jit->unit->names[slot] = name;
+    jit->unit->inputs[slot] = input;
+    jit->unit->assigned[slot] = bFalse;
+    jit->visible[slot] = bTrue;
+
+    return (int)slot;
+}
+
+////////////////////////////////////////////////////////////
+static int jit_resolve_name(jit_compiler_t *jit, char *name)
+{
+    int slot = jit_find(jit, name);
+
+    if (slot >= 0 && jit->visible[slot])
+    {
+        return slot;
+    }
+
+    if (slot < 0 && jit->loop)
+    {
+        // Free variable of the loop, loaded before the first iteration
+        return jit_declare(jit, name, bTrue);
+    }
+
+    jit->failed = bTrue;
+    return -1;
+}
+
+////////////////////////////////////////////////////////////
+static void jit_expression(jit_compiler_t *jit, ast_t tree);
+
+////////////////////////////////////////////////////////////
+static void jit_operator(jit_compiler_t *jit, ast_t tree)
+{
+    // rax: x, rcx: y
+    jit_expression(jit, tree->child);
+    jit_emit(jit, (unsigned char[]){0x50}, 1);
+    jit_expression(jit, tree->child->sibling);
+    jit_emit(jit, (unsigned char[]){0x48, 0x89, 0xC1, 0x58}, 4);
+
+    switch (*(tree->value))
+    {
+    case '+':
+        // add rax, rcx
+        jit_emit(jit, (unsigned char[]){0x48, 0x01, 0xC8}, 3);
+        jit_bail(jit, 0x80);
+        return;
+
+    case '-':
+        // sub rax, rcx
+        jit_emit(jit, (unsigned char[]){0x48, 0x29, 0xC8}, 3);
+        jit_bail(jit, 0x80);
+        return;
+
+    case '*':
+    {
+        // mov rdx, rax; xor rdx, rcx; imul rax, rcx
+        jit_emit(jit, (unsigned char[]){0x48, 0x89, 0xC2, 0x48, 0x31, 0xCA, 0x48, 0x0F, 0xAF, 0xC1}, 10);
+        jit_bail(jit, 0x80);
+
+        // A null product of operands of different signs is -0
+        jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xC0}, 3);
+        size_t nonzero = jit_jump(jit, 0x85);
+        jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xD2}, 3);
+        jit_bail(jit, 0x88);
+        jit_patch(jit, nonzero, jit->size);
+        return;
+    }
+
+    case '/':
+    {
+        // Division by zero: the interpreter raises the exception
+        jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xC9}, 3);
+        jit_bail(jit, 0x84);
+
+        // 0 / negative is -0
+        jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xC0}, 3);
+        size_t nonzero = jit_jump(jit, 0x85);
+        jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xC9}, 3);
+        jit_bail(jit, 0x88);
+        jit_patch(jit, nonzero, jit->size);
+
+        // x / -1: neg rax (idiv would overflow on INT64_MIN)
+        jit_emit(jit, (unsigned char[]){0x48, 0x83, 0xF9, 0xFF}, 4);
+        size_t divide = jit_jump(jit, 0x85);
+        jit_emit(jit, (unsigned char[]){0x48, 0xF7, 0xD8}, 3);
+        jit_bail(jit, 0x80);
+        size_t done = jit_jump(jit, 0);
+
+        // cqo; idiv rcx; fractional results are not integers
+        jit_patch(jit, divide, jit->size);
+        jit_emit(jit, (unsigned char[]){0x48, 0x99, 0x48, 0xF7, 0xF9, 0x48, 0x85, 0xD2}, 8);
+        jit_bail(jit, 0x85);
+        jit_patch(jit, done, jit->size);
+        return;
+    }
+
+    case '%':
+    case '^':
+    {
+        // The interpreter converts both operands to int
+        jit_emit(jit, (unsigned char[]){0x48, 0x63, 0xD0, 0x48, 0x39, 0xC2}, 6);
+        jit_bail(jit, 0x85);
+        jit_emit(jit, (unsigned char[]){0x48, 0x63, 0xD1, 0x48, 0x39, 0xCA}, 6);
+        jit_bail(jit, 0x85);
+
+        if (*(tree->value) == '^')
+        {
+            // xor eax, ecx; movsxd rax, eax
+            jit_emit(jit, (unsigned char[]){0x31, 0xC8, 0x48, 0x63, 0xC0}, 5);
+            return;
+        }
+
+        // Modulo by zero or by -1 (INT_MIN % -1)
+        jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xC9}, 3);
+        jit_bail(jit, 0x84);
+        jit_emit(jit, (unsigned char[]){0x48, 0x83, 0xF9, 0xFF}, 4);
+        jit_bail(jit, 0x84);
+
+        // cdq; idiv ecx; movsxd rax, edx
+        jit_emit(jit, (unsigned char[]){0x99, 0xF7, 0xF9, 0x48, 0x63, 0xC2}, 6);
+        return;
+    }
+
+    case '&':
+    case '|':
+    {
+        // test rax, rax; setne dl; test rcx, rcx; setne al
+        jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xC0, 0x0F, 0x95, 0xC2, 0x48, 0x85, 0xC9, 0x0F, 0x95, 0xC0}, 12);
+        // and al, dl / or al, dl; movzx eax, al
+        unsigned char logic = *(tree->value) == '&' ? 0x20 : 0x08;
+        jit_emit(jit, (unsigned char[]){logic, 0xD0, 0x0F, 0xB6, 0xC0}, 5);
+        return;
+    }
+
+    default:
+        break;
+    }
+
+    unsigned char set = 0;
+
+    switch (*(tree->value))
+    {
+    case '<':
+        set = tree->value[1] == '=' ? 0x9E : 0x9C;
+        break;
+
+    case '>':
+        set = tree->value[1] == '=' ? 0x9D : 0x9F;
+        break;
+
+    // Integers are printed the same way: string comparisons
+    // are integer comparisons
+    case '=':
+        set = 0x94;
+        break;
+
+    case '!':
+    case '~':
+        set = 0x95;
+        break;
+
+    default:
+        jit->failed = bTrue;
+        return;
+    }
+
+    // cmp rax, rcx; setcc al; movzx eax, al
+    jit_emit(jit, (unsigned char[]){0x48, 0x39, 0xC8, 0x0F, set, 0xC0, 0x0F, 0xB6, 0xC0}, 9);
+}
+
+////////////////////////////////////////////////////////////
+static void jit_expression(jit_compiler_t *jit, ast_t tree)
+{
+    if (!tree || jit->failed)
+    {
+        jit->failed = bTrue;
+        return;
+    }
+
+    switch (tree->type)
+    {
+    case NODE_BODY:
+        jit_expression(jit, tree->child);
+        return;
+
+    case NODE_VALUE:
+    {
+        long long number = 0;
+
+        if (!jit_integer(tree->value, &number))
+        {
+            jit->failed = bTrue;
+            return;
+        }
+
+        // mov rax, imm64
+        jit_emit(jit, (unsigned char[]){0x48, 0xB8}, 2);
+        jit_emit_u32(jit, (unsigned int)number);
+        jit_emit_u32(jit, (unsigned int)((unsigned long long)number >> 32));
+        return;
+    }
+
+    case NODE_MEMGET:
+    case NODE_MEMGET_SLOT:
+    {
+        int slot = jit_resolve_name(jit, tree->value);
+
+        if (slot >= 0)
+        {
+            jit_rbx(jit, 0x8B, JIT_SLOT(slot));
+        }
+
+        return;
+    }
+
+    case NODE_OPERATOR:
+    case NODE_OPERATOR_NUM:
+        jit_operator(jit, tree);
+        return;
+
+    default:
+        // Calls, strings...
+        jit->failed = bTrue;
+        return;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void jit_body(jit_compiler_t *jit, ast_t body);
+
+////////////////////////////////////////////////////////////
+static void jit_loop(jit_compiler_t *jit, ast_t loop, jit_patches_t *breaks)
+{
+    size_t top = jit->size;
+
+    jit_expression(jit, loop->child);
+    jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xC0}, 3);
+    jit_patch_add(jit, breaks, jit_jump(jit, 0x84));
+    jit_fuel(jit, &jit->yields);
+
+    jit_patches_t *outer = jit->breaks;
+    jit->breaks = breaks;
+    jit_body(jit, loop->child->sibling);
+    jit->breaks = outer;
+
+    jit_patch(jit, jit_jump(jit, 0), top);
+}
+
+////////////////////////////////////////////////////////////
+static void jit_statement(jit_compiler_t *jit, ast_t statement)
+{
+    switch (statement->type)
+    {
+    case NODE_MEMNEW:
+    {
+        // The value is evaluated before the variable exists
+        jit_expression(jit, statement->child);
+        int slot = jit_declare(jit, statement->value, bFalse);
+
+        if (slot >= 0)
+        {
+            jit_rbx(jit, 0x89, JIT_SLOT(slot));
+        }
+
+        return;
+    }
+
+    case NODE_MEMSET:
+    {
+        jit_expression(jit, statement->child);
+        int slot = jit_resolve_name(jit, statement->value);
+
+        if (slot >= 0)
+        {
+            jit->unit->assigned[slot] = bTrue;
+            jit_rbx(jit, 0x89, JIT_SLOT(slot));
+        }
+
+        return;
+    }
+
+    case NODE_CONDITION:
+    {
+        jit_patches_t ends = {0};
+
+        for (ast_t guard = statement->child; guard && guard->sibling; guard = guard->sibling->sibling)
+        {
+            jit_expression(jit, guard);
+            jit_emit(jit, (unsigned char[]){0x48, 0x85, 0xC0}, 3);
+            size_t next = jit_jump(jit, 0x84);
+
+            jit_body(jit, guard->sibling);
+            jit_patch_add(jit, &ends, jit_jump(jit, 0));
+            jit_patch(jit, next, jit->size);
+        }
+
+        jit_resolve(jit, &ends);
+        return;
+    }
+
+    case NODE_REPETITION:
+    {
+        if (statement->value)
+        {
+            // Pulls from a generator
+            jit->failed = bTrue;
+            return;
+        }
+
+        jit_patches_t breaks = {0};
+        jit_loop(jit, statement, &breaks);
+        jit_resolve(jit, &breaks);
+        return;
+    }
+
+    case NODE_BREAK:
+
+        if (!jit->breaks)
+        {
+            jit->failed = bTrue;
+            return;
+        }
+
+        jit_patch_add(jit, jit->breaks, jit_jump(jit, 0));
+        return;
+
+    case NODE_RETURN:
+
+        if (jit->loop)
+        {
+            jit->failed = bTrue;
+            return;
+        }
+
+        if (!statement->child)
+        {
+            jit_status(jit, JIT_RETURN_NULL);
+            jit_patch_add(jit, &jit->exits, jit_jump(jit, 0));
+            return;
+        }
+
+        // mov [rbx], rax
+        jit_expression(jit, statement->child);
+        jit_emit(jit, (unsigned char[]){0x48, 0x89, 0x03}, 3);
+        jit_status(jit, JIT_RETURN);
+        jit_patch_add(jit, &jit->exits, jit_jump(jit, 0));
+        return;
+
+    default:
+        // Calls, imports, exceptions...
+        jit->failed = bTrue;
+        return;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void jit_body(jit_compiler_t *jit, ast_t body)
+{
+    if (!body)
+    {
+        jit->failed = bTrue;
+        return;
+    }
+
+    unsigned int declared = jit->unit->count;
+
+    for (ast_t statement = body->child; statement && !jit->failed; statement = statement->sibling)
+    {
+        jit_statement(jit, statement);
+    }
+
+    // Variables declared in the body leave the scope with it
+    for (unsigned int slot = declared; slot < jit->unit->count; slot++)
+    {
+        jit->visible[slot] = jit->unit->inputs[slot];
+    }
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t jit_compile(jit_unit_t *unit)
+{
+    jit_compiler_t jit = {0};
+    jit.unit = unit;
+    jit.loop = unit->node->type == NODE_REPETITION;
+
+    // push rbp; mov rbp, rsp; push rbx; mov rbx, rdi
+    jit_emit(&jit, (unsigned char[]){0x55, 0x48, 0x89, 0xE5, 0x53, 0x48, 0x89, 0xFB}, 8);
+
+    if (jit.loop)
+    {
+        /**
+         *
+         * top:    jmp save
+         * resume: <loop> (fuel checked after the condition)
+         *         mov eax, JIT_END
+         *         <epilogue>
+         * save:   <copy assigned free variables>
+         *         jmp resume
+         *
+         */
+
+        jit_patches_t breaks = {0};
+        size_t save = jit_jump(&jit, 0);
+        size_t resume = jit.size;
+
+        jit_expression(&jit, unit->node->child);
+        jit_emit(&jit, (unsigned char[]){0x48, 0x85, 0xC0}, 3);
+        jit_patch_add(&jit, &breaks, jit_jump(&jit, 0x84));
+        jit_fuel(&jit, &jit.slices);
+
+        jit.breaks = &breaks;
+        jit_body(&jit, unit->node->child->sibling);
+        jit.breaks = NULL;
+
+        jit_patch(&jit, jit_jump(&jit, 0), save - 1);
+        jit_resolve(&jit, &breaks);
+        jit_status(&jit, JIT_END);
+        jit_epilogue(&jit);
+
+        jit_patch(&jit, save, jit.size);
+
+        for (unsigned int slot = 0; slot < unit->count; slot++)
+        {
+            if (unit->inputs[slot] && unit->assigned[slot])
+            {
+                jit_rbx(&jit, 0x8B, JIT_SLOT(slot));
+                jit_rbx(&jit, 0x89, JIT_SHADOW(slot));
+            }
+        }
+
+        jit_patch(&jit, jit_jump(&jit, 0), resume);
+    }
+    else
+    {
+        // Parameters
+        ast_t param = unit->node->child;
+
+        for (; param && param->type != NODE_BODY; param = param->sibling)
+        {
+            jit_declare(&jit, param->value, bTrue);
+        }
+
+        jit_body(&jit, param);
+        jit_status(&jit, JIT_END);
+        jit_resolve(&jit, &jit.exits);
+        jit_epilogue(&jit);
+    }
+
+    // Bail exit
+    jit_resolve(&jit, &jit.bails);
+    jit_status(&jit, JIT_BAIL);
+    jit_epilogue(&jit);
+
+    // Out of fuel exits
+    jit_resolve(&jit, &jit.yields);
+    jit_status(&jit, JIT_YIELD);
+    jit_epilogue(&jit);
+
+    jit_resolve(&jit, &jit.slices);
+    jit_status(&jit, JIT_SLICE);
+    jit_epilogue(&jit);
+
+    free(jit.bails.at);
+    free(jit.exits.at);
+
+    if (jit.failed)
+    {
+        free(jit.code);
+        return bFalse;
+    }
+
+    // W^X: written, then made executable
+    void *memory = mmap(NULL, jit.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory == MAP_FAILED)
+    {
+        free(jit.code);
+        return bFalse;
+    }
+
+    memcpy(memory, jit.code, jit.size);
+    free(jit.code);
+
+    if (mprotect(memory, jit.size, PROT_READ | PROT_EXEC))
+    {
+        munmap(memory, jit.size);
+        return bFalse;
+    }
+
+    unit->memory = memory;
+    unit->length = jit.size;
+    unit->code = (int (*)(long long *))memory;
+    unit->state = JIT_COMPILED;
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void jit_release(jit_unit_t *unit)
+{
+    if (unit->memory)
+    {
+        munmap(unit->memory, unit->length);
+    }
+
+    unit->memory = NULL;
+    unit->code = NULL;
+}
+
+////////////////////////////////////////////////////////////
+static jit_unit_t *jit_ready(ast_t node, unsigned long long threshold)
+{
+    // Returns the compiled unit of a node, once it is hot
+    jit_unit_t *unit = jit_unit(node);
+
+    if (!unit || unit->state == JIT_REJECTED)
+    {
+        return NULL;
+    }
+
+    if (unit->state == JIT_COLD)
+    {
+        if (++unit->calls < threshold)
+        {
+            return NULL;
+        }
+
+        if (!jit_compile(unit))
+        {
+            unit->state = JIT_REJECTED;
+            return NULL;
+        }
+    }
+
+    return unit;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t jit_load(jit_unit_t *unit, long long *slots, soare_variables_t **variables)
+{
+    // Variables must hold integers to enter the compiled code
+    for (unsigned int slot = 0; slot < unit->count; slot++)
+    {
+        variables[slot] = NULL;
+
+        if (!unit->inputs[slot])
+        {
+            continue;
+        }
+
+        soare_variables_t *get = soare_get_variable(unit->names[slot]);
+
+        if (!get || get->body || (unit->assigned[slot] && !get->mutable))
+        {
+            return bFalse;
+        }
+
+        if (!jit_integer(get->value, &slots[1 + slot]))
+        {
+            return bFalse;
+        }
+
+        slots[1 + JIT_MAX_SLOTS + slot] = slots[1 + slot];
+        variables[slot] = get;
+    }
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void jit_bailed(jit_unit_t *unit)
+{
+    // Code giving up too often is left to the interpreter
+    if (++unit->bails >= JIT_MAX_BAILS)
+    {
+        jit_release(unit);
+        unit->state = JIT_REJECTED;
+    }
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_jit_function(ast_t function, char **returned)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (!state->jit_mode)
+    {
+        return bFalse;
+    }
+
+    jit_unit_t *unit = jit_ready(function, SOARE_JIT_HOT_CALLS);
+
+    if (!unit)
+    {
+        return bFalse;
+    }
+
+    long long slots[JIT_SLOTS] = {0};
+    soare_variables_t *variables[JIT_MAX_SLOTS];
+
+    if (!jit_load(unit, slots, variables))
+    {
+        return bFalse;
+    }
+
+    // The call itself is already counted
+    unsigned long long fuel = state->steps_next - state->steps - 1;
+    slots[JIT_SLOTS - 1] = (long long)fuel;
+
+    int status = unit->code(slots);
+
+    switch (status)
+    {
+    case JIT_RETURN:
+    case JIT_END:
+    case JIT_RETURN_NULL:
+        state->steps += fuel - (unsigned long long)slots[JIT_SLOTS - 1];
+        *returned = status == JIT_RETURN ? jit_string(slots[0]) : NULL;
+        return bTrue;
+
+    case JIT_YIELD:
+        // The interpreter runs the function until the end of the slice
+        return bFalse;
+
+    default:
+        // The interpreter runs the function from the start
+        jit_bailed(unit);
+        return bFalse;
+    }
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_jit_loop(ast_t loop)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (!state->jit_mode)
+    {
+        return bFalse;
+    }
+
+    // The loop is already hot when called by the interpreter
+    jit_unit_t *unit = jit_ready(loop, 1);
+
+    if (!unit)
+    {
+        return bFalse;
+    }
+
+    long long slots[JIT_SLOTS] = {0};
+    soare_variables_t *variables[JIT_MAX_SLOTS];
+
+    if (!jit_load(unit, slots, variables))
+    {
+        return bFalse;
+    }
+
+    while (bTrue)
+    {
+        // The current iteration is already counted: checked again
+        unsigned long long fuel = state->steps_next - state->steps;
+        slots[JIT_SLOTS - 1] = (long long)fuel;
+
+        int status = unit->code(slots);
+        unsigned long long used = fuel - (unsigned long long)slots[JIT_SLOTS - 1];
+
+        // Store the variables, as they were at the start of the last
+        // iteration if the interpreter has to run it again
+        boolean_t again = status == JIT_BAIL || status == JIT_YIELD;
+        long long *values = again ? slots + 1 + JIT_MAX_SLOTS : slots + 1;
+
+        for (unsigned int slot = 0; slot < unit->count; slot++)
+        {
+            if (variables[slot] && unit->assigned[slot])
+            {
+                soare_set_value(variables[slot], jit_string(values[slot]));
+            }
+        }
+
+        if (status == JIT_YIELD)
+        {
+            // The next step of the interpreter ends the slice
+            state->steps = state->steps_next - 1;
+            return bFalse;
+        }
+
+        if (status != JIT_SLICE)
+        {
+            state->steps += used ? used - 1 : 0;
+
+            if (status == JIT_BAIL)
+            {
+                jit_bailed(unit);
+                return bFalse;
+            }
+
+            return bTrue;
+        }
+
+        // Out of fuel between two iterations: the next one ends the slice
+        state->steps = state->steps_next;
+
+        if (!soare_state_slice(state, loop->file))
+        {
+            return bTrue;
+        }
+
+        if (!jit_load(unit, slots, variables))
+        {
+            // Changed by the slice: the interpreter runs the next iteration
+            return !soare_math_truth(loop->child) || soare_errorlevel();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+void soare_jit_clear(void)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (!state->jit_units)
+    {
+        return;
+    }
+
+    for (unsigned int bucket = 0; bucket < JIT_BUCKETS; bucket++)
+    {
+        jit_unit_t *unit = state->jit_units[bucket];
+
+        while (unit)
+        {
+            jit_unit_t *next = unit->next;
+            jit_release(unit);
+            free(unit);
+            unit = next;
+        }
+    }
+
+    free(state->jit_units);
+    state->jit_units = NULL;
+}
+
+#else
+
+////////////////////////////////////////////////////////////
+boolean_t soare_jit_function(ast_t function, char **returned)
+{
+    // No code generator for this platform
+    (void)function;
+    (void)returned;
+    return bFalse;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_jit_loop(ast_t loop)
+{
+    (void)loop;
+    return bFalse;
+}
+
+////////////////////////////////////////////////////////////
+void soare_jit_clear(void)
+{
+}
+
+#endif /* __SOARE_JIT_X86_64 */
@@ -0,0 +1,444 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Lines.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#include <SOARE/SOARE.h>
+
+/**
+ *
+ * Each file has an array of counters indexed by line number. The
+ * running line is a file index and a line number, not a node: the
+ * tree of an `eval()` may be gone when the next line starts. Calls
+ * push the calling line, so that the time after a call goes back to
+ * the caller
+ *
+ */
+
+/* No file (nothing ran yet) */
+#define LINES_NONE ((unsigned long)-1)
+/* Lines listed first in the report */
+#define LINES_HOTTEST 10
+
+/**
+ * @brief Counters of a line
+ */
+typedef struct lines_line
+{
+
+    unsigned long long statements;  /**< Statements started     */
+    unsigned long long expressions; /**< Expressions evaluated  */
+    unsigned long long time;        /**< Time on the line (ns)  */
+
+} lines_line_t;
+
+/**
+ * @brief Counted file
+ */
+typedef struct lines_file
+{
+
+    char *filename;      /**< Copy of the filename         */
+    lines_line_t *lines; /**< Counters, by line number     */
+    unsigned long size;  /**< Capacity of the counters     */
+
+} lines_file_t;
+
+/**
+ * @brief Line, in a file
+ */
+typedef struct lines_running
+{
+
+    unsigned long file;    /**< File, or LINES_NONE  */
+    unsigned long long ln; /**< Line number          */
+
+} lines_running_t;
+
+/**
+ * @brief Line statistics of a state
+ */
+struct soare_lines
+{
+
+    lines_file_t *files;       /**< Counted files                  */
+    unsigned long files_count; /**< Number of files                */
+    unsigned long files_size;  /**< Capacity of the files          */
+    const char *key;           /**< Filename of the last lookup    */
+    unsigned long key_file;    /**< File of the last lookup        */
+    lines_running_t running;   /**< Running line                   */
+    unsigned long long since;  /**< Start of the running line (ns) */
+    unsigned long long start;  /**< Start of the statistics (ns)   */
+    lines_running_t *calls;    /**< Calling lines                  */
+    unsigned long calls_count; /**< Number of calling lines        */
+    unsigned long calls_size;  /**< Capacity of the calling lines  */
+
+};
+
+////////////////////////////////////////////////////////////
+static soare_state_t *lines_state(soare_state_t *state)
+{
+    if (state)
+    {
+        return state;
+    }
+
+    // NULL selects the default state
+    soare_state_t *previous = soare_state_select(NULL);
+    state = soare_state_current();
+    soare_state_select(previous);
+
+    return state;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long long lines_now(void)
+{
+    struct timespec now;
+
+#ifdef _WIN32
+    timespec_get(&now, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t lines_reserve(void **array, unsigned long *size, unsigned long count, size_t item)
+{
+    if (count < *size)
+    {
+        return bTrue;
+    }
+
+    unsigned long grown = *size ? *size * 2 : 16;
+
+    while (grown <= count)
+    {
+        grown *= 2;
+    }
+
+    void *resized = realloc(*array, grown * item);
+
+    if (!resized)
+    {
+        return bFalse;
+    }
+
+    // New counters start at zero
+    memset((char *)resized + *size * item, 0, (grown - *size) * item);
+
+    *array = resized;
+    *size = grown;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long lines_file(soare_lines_t *lines, const char *filename)
+{
+    if (lines->key && lines->key == filename)
+    {
+        return lines->key_file;
+    }
+
+    const char *name = filename ? filename : "<code>";
+    unsigned long file = 0;
+
+    while (file < lines->files_count && strcmp(lines->files[file].filename, name))
+    {
+        file++;
+    }
+
+    if (file == lines->files_count)
+    {
+        if (!lines_reserve((void **)&lines->files, &lines->files_size, lines->files_count, sizeof(lines_file_t)))
+        {
+            return LINES_NONE;
+        }
+
+        if (!(lines->files[file].filename = strdup(name)))
+        {
+            return LINES_NONE;
+        }
+
+        lines->files_count++;
+    }
+
+    lines->key = filename;
+    lines->key_file = file;
+
+    return file;
+}
+
+////////////////////////////////////////////////////////////
+static void lines_charge(soare_lines_t *lines, unsigned long long now)
+{
+    // The elapsed time goes to the running line
+    if (lines->running.file != LINES_NONE)
+    {
+        lines->files[lines->running.file].lines[lines->running.ln].time += now - lines->since;
+    }
+
+    lines->since = now;
+}
+
+////////////////////////////////////////////////////////////
+static lines_line_t *lines_switch(soare_lines_t *lines, const document_t *line)
+{
+    unsigned long file = lines_file(lines, line->filename);
+
+    if (file == LINES_NONE)
+    {
+        return NULL;
+    }
+
+    lines_file_t *counted = &lines->files[file];
+
+    if (!lines_reserve((void **)&counted->lines, &counted->size, (unsigned long)line->ln, sizeof(lines_line_t)))
+    {
+        return NULL;
+    }
+
+    lines_charge(lines, lines_now());
+
+    lines->running.file = file;
+    lines->running.ln = line->ln;
+
+    return &counted->lines[line->ln];
+}
+
+////////////////////////////////////////////////////////////
+void soare_lines_statement(soare_lines_t *lines, const document_t *line)
+{
+    lines_line_t *counters = lines_switch(lines, line);
+
+    if (counters)
+    {
+        counters->statements++;
+    }
+}
+
+////////////////////////////////////////////////////////////
+void soare_lines_expression(soare_lines_t *lines, const document_t *line)
+{
+    lines_line_t *counters = lines_switch(lines, line);
+
+    if (counters)
+    {
+        counters->expressions++;
+    }
+}
+
+////////////////////////////////////////////////////////////
+unsigned long soare_lines_enter(soare_lines_t *lines)
+{
+    if (!lines_reserve((void **)&lines->calls, &lines->calls_size, lines->calls_count, sizeof(lines_running_t)))
+    {
+        return 0;
+    }
+
+    lines->calls[lines->calls_count++] = lines->running;
+    return lines->calls_count;
+}
+
+////////////////////////////////////////////////////////////
+void soare_lines_leave(soare_lines_t *lines, unsigned long depth)
+{
+    // Calls of suspended tasks may already be gone
+    if (!depth || depth > lines->calls_count)
+    {
+        return;
+    }
+
+    lines_charge(lines, lines_now());
+
+    lines->running = lines->calls[depth - 1];
+    lines->calls_count = depth - 1;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_lines_start(soare_state_t *state)
+{
+    state = lines_state(state);
+    soare_lines_stop(state);
+
+    soare_lines_t *lines = (soare_lines_t *)calloc(1, sizeof(soare_lines_t));
+
+    if (!lines)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return bFalse;
+    }
+
+    lines->running.file = LINES_NONE;
+    lines->start = lines->since = lines_now();
+
+    state->lines = lines;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+void soare_lines_stop(soare_state_t *state)
+{
+    state = lines_state(state);
+    soare_lines_t *lines = state->lines;
+
+    if (!lines)
+    {
+        return;
+    }
+
+    for (unsigned long i = 0; i < lines->files_count; i++)
+    {
+        free(lines->files[i].filename);
+        free(lines->files[i].lines);
+    }
+
+    free(lines->files);
+    free(lines->calls);
+    free(lines);
+
+    state->lines = NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void lines_counters(FILE *report, const lines_line_t *line)
+{
+    if (!line || !(line->statements || line->expressions))
+    {
+        fprintf(report, "%14s %14s %14s", "", "", "");
+        return;
+    }
+
+    fprintf(report, "%14.3f %14llu %14llu", (double)line->time / 1e6, line->statements, line->expressions);
+}
+
+////////////////////////////////////////////////////////////
+static void lines_hottest(soare_lines_t *lines, FILE *report)
+{
+    lines_running_t hottest[LINES_HOTTEST];
+    unsigned long count = 0;
+
+    for (unsigned long file = 0; file < lines->files_count; file++)
+    {
+        for (unsigned long ln = 0; ln < lines->files[file].size; ln++)
+        {
+            unsigned long long time = lines->files[file].lines[ln].time;
+
+            if (!time)
+            {
+                continue;
+            }
+
+            // Insertion into the sorted hottest lines
+            unsigned long i = count < LINES_HOTTEST ? count++ : LINES_HOTTEST;
+
+            for (; i && lines->files[hottest[i - 1].file].lines[hottest[i - 1].ln].time < time; i--)
+            {
+                if (i < LINES_HOTTEST)
+                {
+                    hottest[i] = hottest[i - 1];
+                }
+            }
+
+            if (i < LINES_HOTTEST)
+            {
+                hottest[i] = (lines_running_t){file, ln};
+            }
+        }
+    }
+
+    fprintf(report, "%14s %14s %14s  %s\n", "time (ms)", "statements", "expressions", "hottest lines");
+
+    for (unsigned long i = 0; i < count; i++)
+    {
+        lines_counters(report, &lines->files[hottest[i].file].lines[hottest[i].ln]);
+        fprintf(report, "  %s:%llu\n", lines->files[hottest[i].file].filename, hottest[i].ln);
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void lines_listing(lines_file_t *file, FILE *report)
+{
+    fprintf(report, "\n%14s %14s %14s  %s\n", "time (ms)", "statements", "expressions", file->filename);
+
+    FILE *source = fopen(file->filename, "r");
+    unsigned long long ln = 1;
+
+    if (source)
+    {
+        int character = fgetc(source);
+
+        while (character != EOF)
+        {
+            lines_counters(report, ln < file->size ? &file->lines[ln] : NULL);
+            fprintf(report, " %6llu | ", ln);
+
+            for (; character != EOF && character != '\n'; character = fgetc(source))
+            {
+                fputc(character, report);
+            }
+
+            fputc('\n', report);
+
+            if (character != EOF)
+            {
+                character = fgetc(source);
+            }
+
+            ln++;
+        }
+
+        fclose(source);
+    }
+
+    // Lines past the end of the file, or source not readable
+    for (; ln < file->size; ln++)
+    {
+        if (file->lines[ln].statements || file->lines[ln].expressions)
+        {
+            lines_counters(report, &file->lines[ln]);
+            fprintf(report, " %6llu |\n", ln);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_lines_write(soare_state_t *state, FILE *report)
+{
+    state = lines_state(state);
+    soare_lines_t *lines = state->lines;
+
+    if (!lines)
+    {
+        return bFalse;
+    }
+
+    unsigned long long now = lines_now();
+    lines_charge(lines, now);
+
+    fprintf(report, "SOARE line statistics: %.3f ms\n\n", (double)(now - lines->start) / 1e6);
+    lines_hottest(lines, report);
+
+    for (unsigned long file = 0; file < lines->files_count; file++)
+    {
+        lines_listing(&lines->files[file], report);
+    }
+
+    return bTrue;
+}
@@ -1,3 +1,5 @@
+#include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -57,13 +59,44 @@ static inline char *__int(int number)
     return strdup(str);
 }
 
+////////////////////////////////////////////////////////////
+static inline boolean_t math_integral(long double number)
+{
+    // Cast to long long only in its range: NaN, infinities and
+    // larger values are undefined behaviour
+    return isfinite(number) && number > -9.2e18L && number < 9.2e18L && number == (long double)(long long)number;
+}
+
 ////////////////////////////////////////////////////////////
 static inline char *__float(long double number)
 {
     char str[42] = {0};
-    sprintf(str, "%Lf", number);
-    remove_useless_zeros(str);
-    return strdup(str);
+
+    if (math_integral(number))
+    {
+        // Integers print the same without the costly "%Lf"
+        sprintf(str, "%s%lld", number == 0 && signbit(number) ? "-" : "", (long long)number);
+        return strdup(str);
+    }
+
+    // Large numbers have up to thousands of digits
+    int length = snprintf(str, sizeof(str), "%Lf", number);
+
+    if (length < 0 || (size_t)length < sizeof(str))
+    {
+        remove_useless_zeros(str);
+        return strdup(str);
+    }
+
+    char *large = (char *)malloc((size_t)length + 1);
+
+    if (large)
+    {
+        snprintf(large, (size_t)length + 1, "%Lf", number);
+        remove_useless_zeros(large);
+    }
+
+    return large;
 }
 
 ////////////////////////////////////////////////////////////
@@ -95,6 +128,32 @@ static inline char *__at(document_t file, char *string, long long index)
     return strdup(str);
 }
 
+////////////////////////////////////////////////////////////
+static inline boolean_t is_true_str(const char *str)
+{
+    return str && *str && strcmp(str, "0");
+}
+
+////////////////////////////////////////////////////////////
+static int math_compare(const char *symbol, const char *sx, const char *sy)
+{
+    // Returns the truth value of a string comparison, or -1
+    // if `symbol` is not a string comparison operator
+
+    switch (*symbol)
+    {
+    case '=':
+        return !strcmp(sx, sy);
+
+    case '~':
+    case '!':
+        return !!strcmp(sx, sy);
+
+    default:
+        return -1;
+    }
+}
+
 ////////////////////////////////////////////////////////////
 static inline short math_priority(char symbol)
 {
@@ -279,163 +338,1077 @@ ast_t soare_parse_expression(tokens_t **tokens, short priority)
 }
 
 ////////////////////////////////////////////////////////////
-char *soare_math(ast_t tree)
+static inline boolean_t is_numeric_operator(const char *symbol)
 {
-    if (!tree)
+    // Operators converting both operands with strtold()
+    return *symbol && strchr("<>&|+-*/%^", *symbol) != NULL;
+}
+
+////////////////////////////////////////////////////////////
+static inline boolean_t is_float_operator(const char *symbol)
+{
+    // Operators formatting their result with __float()
+    return *symbol && strchr("+-*/", *symbol) != NULL;
+}
+
+////////////////////////////////////////////////////////////
+static long double math_strtold(const char *string)
+{
+    // Plain integers (up to 18 digits) are converted exactly
+    // without the costly strtold()
+    const char *chr = string + (*string == '-');
+    long long number = 0;
+    int digits = 0;
+
+    // 18 digits always fit: a 19th one may overflow
+    for (; *chr >= '0' && *chr <= '9' && digits < 18; chr++, digits++)
+    {
+        number = number * 10 + (*chr - '0');
+    }
+
+    // More digits, or not a plain integer
+    if (*chr || !digits)
+    {
+        return strtold(string, NULL);
+    }
+
+    return *string == '-' ? -(long double)number : (long double)number;
+}
+
+////////////////////////////////////////////////////////////
+static long double math_normalize(long double number)
+{
+    /**
+     *
+     * Intermediate results used to go through their string form
+     * (__float), which rounds them to 6 decimals
+     *
+     * Integers are unchanged by this round trip (every long double
+     * above 2^63 is an integer), others are rounded in a stack buffer
+     *
+     */
+
+    // NaN and infinities are printed as they are
+    if (!isfinite(number) || number >= 9.2e18L || number <= -9.2e18L || math_integral(number))
+    {
+        return number;
+    }
+
+    char str[64] = {0};
+    snprintf(str, sizeof(str), "%Lf", number);
+    return strtold(str, NULL);
+}
+
+////////////////////////////////////////////////////////////
+static inline void math_quicken(ast_t tree, node_type_t type)
+{
+    // Shared nodes are read by several states: never rewritten
+    if (!tree->shared && tree->type != type)
+    {
+        tree->type = type;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static soare_variables_t *math_variable(ast_t tree)
+{
+    soare_variables_t *get = soare_get_variable_cached(tree);
+
+    if (!get)
+    {
+        // Deoptimize
+        math_quicken(tree, NODE_MEMGET);
+        soare_leave_exception(UndefinedReference, tree->value, tree->file);
         return NULL;
+    }
+
+    if (get->body)
+    {
+        // Deoptimize
+        math_quicken(tree, NODE_MEMGET);
+        soare_leave_exception(VariableDefinedAsFunction, tree->value, tree->file);
+        return NULL;
+    }
+
+    // LOAD_SLOT: resolved until a variable is registered or removed
+    math_quicken(tree, NODE_MEMGET_SLOT);
+    return get;
+}
+
+////////////////////////////////////////////////////////////
+static int math_int(long double number)
+{
+    // Out of range (or NaN): INT_MIN, as x86 converts, without the undefined behaviour
+    if (!(number > (long double)INT_MIN - 1 && number < (long double)INT_MAX + 1))
+    {
+        return INT_MIN;
+    }
+
+    return (int)number;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t math_apply(ast_t tree, long double dx, long double dy, long double *result)
+{
+    switch (*(tree->value))
+    {
+    // < or <=
+    case '<':
+        *result = dx < dy || (tree->value[1] == '=' && dx == dy);
+        return bTrue;
+
+    // > or >=
+    case '>':
+        *result = dx > dy || (tree->value[1] == '=' && dx == dy);
+        return bTrue;
+
+    case '&':
+        *result = dx && dy;
+        return bTrue;
+
+    case '|':
+        *result = dx || dy;
+        return bTrue;
+
+    case '+':
+        *result = dx + dy;
+        return bTrue;
+
+    case '-':
+        *result = dx - dy;
+        return bTrue;
+
+    case '*':
+        *result = dx * dy;
+        return bTrue;
+
+    case '^':
+        *result = math_int(dx) ^ math_int(dy);
+        return bTrue;
+
+    case '%':
+        // Operands are converted to int: 0.5 is a null divisor
+        if (!math_int(dy))
+        {
+            soare_leave_exception(DivideByZero, tree->value, tree->file);
+            return bFalse;
+        }
+        // INT_MIN % -1 overflows
+        *result = math_int(dy) == -1 ? 0 : math_int(dx) % math_int(dy);
+        return bTrue;
+
+    case '/':
+        if (!dy)
+        {
+            soare_leave_exception(DivideByZero, tree->value, tree->file);
+            return bFalse;
+        }
+        *result = dx / dy;
+        return bTrue;
+
+    default:
+        break;
+    }
+
+    soare_leave_exception(MathError, tree->value, tree->file);
+    return bFalse;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t math_number(ast_t tree, long double *number);
+
+////////////////////////////////////////////////////////////
+static boolean_t math_operator(ast_t tree, long double *result)
+{
+    long double dx = 0;
+    long double dy = 0;
+
+    SOARE_STATS_ADD(soare_state_current(), operations, 1);
+
+    // Both operands are always evaluated
+    boolean_t x = math_number(tree->child, &dx);
+    boolean_t y = math_number(tree->child->sibling, &dy);
+
+    return x && y && math_apply(tree, dx, dy, result);
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t math_number(ast_t tree, long double *number)
+{
+    /**
+     *
+     * Evaluate an operand of a numeric operator straight to a
+     * number, as strtold(soare_math(tree)) would, but without
+     * building the intermediate strings
+     *
+     */
+
+    if (!tree)
+    {
+        return bFalse;
+    }
+
+    SOARE_STATS_ADD(soare_state_current(), nodes, 1);
 
     switch (tree->type)
     {
     case NODE_BODY:
-        return soare_math(tree->child);
-
-    case NODE_CALL:
-        return soare_run_function(tree);
+        return math_number(tree->child, number);
 
     case NODE_VALUE:
     {
-        if (tree->value)
+        if (!tree->value)
         {
-            return strdup(tree->value);
+            return bFalse;
         }
-        return NULL;
+
+        *number = math_strtold(tree->value);
+        return bTrue;
     }
 
     case NODE_MEMGET:
+    case NODE_MEMGET_SLOT:
     {
-        soare_variables_t *get = soare_get_variable(tree->value);
+        soare_variables_t *get = math_variable(tree);
 
-        if (!get)
+        if (!get || !get->value)
         {
-            soare_leave_exception(UndefinedReference, tree->value, tree->file);
-            return NULL;
+            return bFalse;
         }
 
-        if (get->body)
+        *number = math_strtold(get->value);
+        return bTrue;
+    }
+
+    case NODE_OPERATOR:
+
+        if (!is_numeric_operator(tree->value))
         {
-            soare_leave_exception(VariableDefinedAsFunction, tree->value, tree->file);
-            return NULL;
+            break;
         }
 
-        if (get->value)
+        math_quicken(tree, NODE_OPERATOR_NUM);
+
+    case NODE_OPERATOR_NUM:
+    {
+        if (!math_operator(tree, number))
         {
-            return strdup(get->value);
+            return bFalse;
         }
 
-        return NULL;
+        if (is_float_operator(tree->value))
+        {
+            *number = math_normalize(*number);
+        }
+
+        return bTrue;
     }
 
-    case NODE_OPERATOR:
+    default:
+        break;
+    }
+
+    char *value = soare_math(tree);
+
+    if (!value)
     {
-        char *sx = soare_math(tree->child);
-        char *sy = soare_math(tree->child->sibling);
+        return bFalse;
+    }
 
-        if (!sx || !sy)
-        {
-            free(sx);
-            free(sy);
-            return NULL;
-        }
+    *number = math_strtold(value);
+    free(value);
 
-        char *result = NULL;
+    return bTrue;
+}
 
-        switch (*(tree->value))
+////////////////////////////////////////////////////////////
+static char *math_call(ast_t tree)
+{
+    if (tree->type == NODE_CALL_NATIVE)
+    {
+        if (tree->epoch == soare_functions_epoch())
         {
-        case ',':
-            if (!(result = malloc(strlen(sx) + strlen(sy) + 1)))
-            {
-                SOARE_OUT_OF_MEMORY();
-                return NULL;
-            }
+            soare_functions_t *function = (soare_functions_t *)tree->cache;
+            soare_state_t *state = soare_state_current();
+            SOARE_STATS_ADD(state, native_calls, 1);
 
-            strcat(strcpy(result, sx), sy);
-            break;
+            return state->profile || state->sampler || state->lines || state->trace ? soare_profile_native(function, tree->child) : function->exec(tree->child);
+        }
 
-        case '=':
-            result = __boolean(!strcmp(sx, sy));
-            break;
+        // Deoptimize: the function was shadowed or unregistered
+        tree->type = NODE_CALL;
+        tree->cache = NULL;
+    }
 
-        case '~':
-        case '!':
-            result = __boolean(strcmp(sx, sy));
-            break;
+    return soare_run_function(tree);
+}
 
-        case ':':
-            result = __at(tree->file, sx, strtoll(sy, &result, 10));
-            break;
+////////////////////////////////////////////////////////////
+static char *math_string(ast_t tree, char *sx, char *sy)
+{
+    // Apply a string operator, `sx` and `sy` are freed
 
-        default:
-            break;
-        }
+    SOARE_STATS_ADD(soare_state_current(), operations, 1);
 
-        if (result)
-        {
-            free(sx);
-            free(sy);
-            return result;
-        }
+    if (!sx || !sy)
+    {
+        free(sx);
+        free(sy);
+        return NULL;
+    }
 
-        long double dx = strtold(sx, &result);
-        long double dy = strtold(sy, &result);
+    char *result = NULL;
+    int truth = math_compare(tree->value, sx, sy);
 
+    if (truth >= 0)
+    {
         free(sx);
         free(sy);
+        return __boolean((char)truth);
+    }
 
-        switch (*(tree->value))
+    switch (*(tree->value))
+    {
+    case ',':
+        if (!(result = malloc(strlen(sx) + strlen(sy) + 1)))
         {
-        // < or <=
-        case '<':
-            return __boolean(dx < dy || (tree->value[1] == '=' && dx == dy));
+            SOARE_OUT_OF_MEMORY();
+            return NULL;
+        }
+
+        strcat(strcpy(result, sx), sy);
+        break;
+
+    case ':':
+        result = __at(tree->file, sx, strtoll(sy, &result, 10));
+        break;
 
-        // > or >=
-        case '>':
-            return __boolean(dx > dy || (tree->value[1] == '=' && dx == dy));
+    default:
+        break;
+    }
 
-        case '&':
-            return __boolean(dx && dy);
+    free(sx);
+    free(sy);
 
-        case '|':
-            return __boolean(dx || dy);
+    if (!result)
+    {
+        soare_leave_exception(MathError, tree->value, tree->file);
+    }
 
-        case '+':
-            return __float(dx + dy);
+    return result;
+}
 
-        case '-':
-            return __float(dx - dy);
+////////////////////////////////////////////////////////////
+char *soare_math(ast_t tree)
+{
+    if (!tree)
+        return NULL;
 
-        case '*':
-            return __float(dx * dy);
+    soare_state_t *state = soare_state_current();
+    SOARE_STATS_ADD(state, nodes, 1);
 
-        case '^':
-            return __int((int)dx ^ (int)dy);
+    if (state->lines)
+    {
+        soare_lines_expression(state->lines, &tree->file);
+    }
 
-        case '%':
-            if (!dy)
-            {
-                soare_leave_exception(DivideByZero, tree->value, tree->file);
-                return NULL;
-            }
-            return __int((int)dx % (int)dy);
+    switch (tree->type)
+    {
+    case NODE_BODY:
+        return soare_math(tree->child);
 
-        case '/':
-            if (!dy)
-            {
-                soare_leave_exception(DivideByZero, tree->value, tree->file);
-                return NULL;
-            }
-            return __float(dx / dy);
+    case NODE_CALL_NATIVE:
+    case NODE_CALL:
+        return math_call(tree);
 
-        default:
-            break;
+    case NODE_VALUE:
+    {
+        if (tree->value)
+        {
+            return strdup(tree->value);
+        }
+        return NULL;
+    }
+
+    case NODE_MEMGET:
+    case NODE_MEMGET_SLOT:
+    {
+        soare_variables_t *get = math_variable(tree);
+
+        if (get && get->value)
+        {
+            return strdup(get->value);
         }
 
-        break;
+        return NULL;
     }
 
-    default:
-        break;
+    case NODE_OPERATOR:
+    {
+        if (!is_numeric_operator(tree->value))
+        {
+            char *sx = soare_math(tree->child);
+            char *sy = soare_math(tree->child->sibling);
+
+            return math_string(tree, sx, sy);
+        }
+
+        // ADD_NUM, LT_NUM, ...
+        math_quicken(tree, NODE_OPERATOR_NUM);
     }
 
-    soare_leave_exception(MathError, tree->value, tree->file);
-    return NULL;
+    case NODE_OPERATOR_NUM:
+    {
+        long double result = 0;
+
+        if (!math_operator(tree, &result))
+        {
+            return NULL;
+        }
+
+        switch (*(tree->value))
+        {
+        case '%':
+        case '^':
+            return __int((int)result);
+
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+            return __float(result);
+
+        default:
+            return __boolean(result != 0);
+        }
+    }
+
+    default:
+        break;
+    }
+
+    soare_leave_exception(MathError, tree->value, tree->file);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_math_truth(ast_t tree)
+{
+    if (!tree)
+    {
+        return bFalse;
+    }
+
+    soare_state_t *state = soare_state_current();
+    SOARE_STATS_ADD(state, nodes, 1);
+
+    switch (tree->type)
+    {
+    case NODE_BODY:
+        return soare_math_truth(tree->child);
+
+    case NODE_VALUE:
+        return is_true_str(tree->value);
+
+    case NODE_MEMGET:
+    case NODE_MEMGET_SLOT:
+    {
+        soare_variables_t *get = math_variable(tree);
+        return get && is_true_str(get->value);
+    }
+
+    case NODE_OPERATOR:
+    case NODE_OPERATOR_NUM:
+    {
+        if (strchr("<>&|", *(tree->value)))
+        {
+            // Numeric comparison, no string at all
+            long double result = 0;
+            math_quicken(tree, NODE_OPERATOR_NUM);
+            return math_operator(tree, &result) && result != 0;
+        }
+
+        if (!strchr("=~!", *(tree->value)))
+        {
+            // Arithmetic: the truth value depends on the formatted result
+            break;
+        }
+
+        SOARE_STATS_ADD(state, operations, 1);
+
+        char *sx = soare_math(tree->child);
+        char *sy = soare_math(tree->child->sibling);
+
+        int truth = sx && sy && math_compare(tree->value, sx, sy) > 0;
+
+        free(sx);
+        free(sy);
+        return (boolean_t)truth;
+    }
+
+    default:
+        break;
+    }
+
+    char *value = soare_math(tree);
+    boolean_t truth = is_true_str(value);
+    free(value);
+
+    return truth;
+}
+
+/**
+ *
+ * Closure compilation
+ *
+ * Each expression node is compiled once into a soare_closure_t
+ * holding direct pointers to the evaluators of its operation and
+ * to the closures of its operands: evaluation no longer switches
+ * on the node type or on the operator
+ *
+ */
+
+////////////////////////////////////////////////////////////
+static char *closure_null(soare_closure_t *self)
+{
+    (void)self;
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_invalid(soare_closure_t *self)
+{
+    soare_leave_exception(MathError, self->node->value, self->node->file);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_number(soare_closure_t *self, long double *number)
+{
+    // Default: convert the string result
+    char *value = self->eval(self);
+
+    if (!value)
+    {
+        return bFalse;
+    }
+
+    *number = math_strtold(value);
+    free(value);
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static int closure_truth(soare_closure_t *self)
+{
+    // Default: test the string result
+    char *value = self->eval(self);
+
+    if (!value)
+    {
+        return -1;
+    }
+
+    int truth = is_true_str(value);
+    free(value);
+
+    return truth;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_value(soare_closure_t *self)
+{
+    return strdup(self->node->value);
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_value_number(soare_closure_t *self, long double *number)
+{
+    *number = self->constant;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static int closure_value_truth(soare_closure_t *self)
+{
+    return is_true_str(self->node->value);
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_variable(soare_closure_t *self)
+{
+    soare_variables_t *get = math_variable(self->node);
+
+    if (get && get->value)
+    {
+        return strdup(get->value);
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_variable_number(soare_closure_t *self, long double *number)
+{
+    soare_variables_t *get = math_variable(self->node);
+
+    if (!get || !get->value)
+    {
+        return bFalse;
+    }
+
+    *number = math_strtold(get->value);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static int closure_variable_truth(soare_closure_t *self)
+{
+    soare_variables_t *get = math_variable(self->node);
+
+    if (!get || !get->value)
+    {
+        return -1;
+    }
+
+    return is_true_str(get->value);
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_call(soare_closure_t *self)
+{
+    return math_call(self->node);
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_string(soare_closure_t *self)
+{
+    char *sx = self->x->eval(self->x);
+    char *sy = self->y->eval(self->y);
+
+    return math_string(self->node, sx, sy);
+}
+
+////////////////////////////////////////////////////////////
+static int closure_compare_truth(soare_closure_t *self)
+{
+    char *sx = self->x->eval(self->x);
+    char *sy = self->y->eval(self->y);
+
+    int truth = sx && sy ? math_compare(self->node->value, sx, sy) : -1;
+
+    free(sx);
+    free(sy);
+    return truth;
+}
+
+////////////////////////////////////////////////////////////
+static inline boolean_t closure_operands(soare_closure_t *self, long double *dx, long double *dy)
+{
+    // Both operands are always evaluated
+    boolean_t x = self->x->number(self->x, dx);
+    boolean_t y = self->y->number(self->y, dy);
+
+    return x && y;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_add(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = math_normalize(dx + dy);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_sub(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = math_normalize(dx - dy);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_mul(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = math_normalize(dx * dy);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_div(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    if (!dy)
+    {
+        soare_leave_exception(DivideByZero, self->node->value, self->node->file);
+        return bFalse;
+    }
+
+    *result = math_normalize(dx / dy);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_mod(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    // Same conversions as math_apply()
+    if (!math_int(dy))
+    {
+        soare_leave_exception(DivideByZero, self->node->value, self->node->file);
+        return bFalse;
+    }
+
+    *result = math_int(dy) == -1 ? 0 : math_int(dx) % math_int(dy);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_xor(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = math_int(dx) ^ math_int(dy);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_lt(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = dx < dy;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_le(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = dx < dy || dx == dy;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_gt(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = dx > dy;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_ge(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = dx > dy || dx == dy;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_and(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = dx && dy;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_or(soare_closure_t *self, long double *result)
+{
+    long double dx = 0, dy = 0;
+
+    if (!closure_operands(self, &dx, &dy))
+    {
+        return bFalse;
+    }
+
+    *result = dx || dy;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_float(soare_closure_t *self)
+{
+    long double result = 0;
+    return self->number(self, &result) ? __float(result) : NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_int(soare_closure_t *self)
+{
+    long double result = 0;
+    return self->number(self, &result) ? __int((int)result) : NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_boolean(soare_closure_t *self)
+{
+    long double result = 0;
+    return self->number(self, &result) ? __boolean(result != 0) : NULL;
+}
+
+////////////////////////////////////////////////////////////
+static int closure_number_truth(soare_closure_t *self)
+{
+    long double result = 0;
+    return self->number(self, &result) ? result != 0 : -1;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t closure_numeric_operator(soare_closure_t *closure, const char *symbol)
+{
+    switch (*symbol)
+    {
+    case '+':
+        closure->number = closure_add;
+        closure->eval = closure_float;
+        return bTrue;
+
+    case '-':
+        closure->number = closure_sub;
+        closure->eval = closure_float;
+        return bTrue;
+
+    case '*':
+        closure->number = closure_mul;
+        closure->eval = closure_float;
+        return bTrue;
+
+    case '/':
+        closure->number = closure_div;
+        closure->eval = closure_float;
+        return bTrue;
+
+    case '%':
+        closure->number = closure_mod;
+        closure->eval = closure_int;
+        return bTrue;
+
+    case '^':
+        closure->number = closure_xor;
+        closure->eval = closure_int;
+        return bTrue;
+
+    case '<':
+        closure->number = symbol[1] == '=' ? closure_le : closure_lt;
+        break;
+
+    case '>':
+        closure->number = symbol[1] == '=' ? closure_ge : closure_gt;
+        break;
+
+    case '&':
+        closure->number = closure_and;
+        break;
+
+    case '|':
+        closure->number = closure_or;
+        break;
+
+    default:
+        return bFalse;
+    }
+
+    // Comparisons
+    closure->eval = closure_boolean;
+    closure->truth = closure_number_truth;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+void soare_math_freeze(ast_t tree)
+{
+    for (; tree; tree = tree->sibling)
+    {
+        // Quickened once and for all: shared nodes are never rewritten
+        if (tree->type == NODE_OPERATOR && is_numeric_operator(tree->value))
+        {
+            tree->type = NODE_OPERATOR_NUM;
+        }
+
+        // Inline caches of a tree which already ran are dropped
+        if (tree->type == NODE_MEMGET_SLOT)
+        {
+            tree->type = NODE_MEMGET;
+        }
+
+        if (tree->type == NODE_CALL_NATIVE)
+        {
+            tree->type = NODE_CALL;
+        }
+
+        tree->cache = NULL;
+        tree->shared = bTrue;
+        soare_math_freeze(tree->child);
+    }
+}
+
+////////////////////////////////////////////////////////////
+soare_closure_t *soare_math_compile(ast_t tree)
+{
+    if (!tree)
+    {
+        return NULL;
+    }
+
+    if (tree->type == NODE_BODY && tree->child)
+    {
+        // Parentheses have no evaluator of their own
+        return soare_math_compile(tree->child);
+    }
+
+    if (tree->closure)
+    {
+        return tree->closure;
+    }
+
+    soare_closure_t *closure = (soare_closure_t *)calloc(1, sizeof(soare_closure_t));
+
+    if (!closure)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    closure->node = tree;
+    closure->eval = closure_invalid;
+    closure->number = closure_number;
+    closure->truth = closure_truth;
+
+    tree->closure = closure;
+
+    switch (tree->type)
+    {
+    case NODE_BODY:
+        closure->eval = closure_null;
+        break;
+
+    case NODE_VALUE:
+
+        if (!tree->value)
+        {
+            closure->eval = closure_null;
+            break;
+        }
+
+        closure->eval = closure_value;
+        closure->number = closure_value_number;
+        closure->truth = closure_value_truth;
+        closure->constant = math_strtold(tree->value);
+        break;
+
+    case NODE_MEMGET:
+    case NODE_MEMGET_SLOT:
+        closure->eval = closure_variable;
+        closure->number = closure_variable_number;
+        closure->truth = closure_variable_truth;
+        break;
+
+    case NODE_CALL:
+    case NODE_CALL_NATIVE:
+        closure->eval = closure_call;
+        break;
+
+    case NODE_OPERATOR:
+    case NODE_OPERATOR_NUM:
+    {
+        closure->x = soare_math_compile(tree->child);
+        closure->y = soare_math_compile(tree->child->sibling);
+
+        if (!closure->x || !closure->y)
+        {
+            // Out of memory, the closure is freed with the tree
+            closure->eval = closure_null;
+            break;
+        }
+
+        if (closure_numeric_operator(closure, tree->value))
+        {
+            break;
+        }
+
+        // String operators
+        closure->eval = closure_string;
+
+        if (strchr("=~!", *(tree->value)))
+        {
+            closure->truth = closure_compare_truth;
+        }
+
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    return closure;
 }
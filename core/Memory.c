@@ -97,22 +97,186 @@ Implement this function: soare_add_function(<function name>, <function>)
 
 soare_add_function("int_add", int_add);
 
+Or register a static table at once (names are not copied):
+
+static const soare_function_entry_t functions[] = {
+    {"int_add", int_add},
+};
+
+soare_add_functions(functions, sizeof(functions) / sizeof(*functions));
+
 ----------------------------------------------------------
 
 */
 
-/* Functions */
-static soare_functions_t *functions_list = NULL;
-static soare_functions_t *functions_list_ptr = NULL;
+/* Initial number of hash buckets (power of two) */
+#define REGISTRY_BUCKETS 64
+
+/**
+ * Functions and keywords are kept twice:
+ *
+ * - In a linked list, in registration order (`next`)
+ * - In a hash table, for constant-time lookup (`bucket`)
+ *
+ * Bulk registrations share a single allocation, remembered in a
+ * `registry_block_t` list so it can be released at once
+ *
+ */
+
+/* Bulk registration allocation */
+typedef struct registry_block
+{
+
+    void *nodes;                 /**< Shared allocation */
+    struct registry_block *next; /**< Next block        */
+
+} registry_block_t;
+
+////////////////////////////////////////////////////////////
+static unsigned long registry_hash(const char *name)
+{
+    // FNV-1a
+    unsigned long hash = 2166136261UL;
+
+    while (*name)
+    {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t registry_block_add(registry_block_t **blocks, void *nodes)
+{
+    registry_block_t *block = (registry_block_t *)malloc(sizeof(registry_block_t));
+
+    if (!block)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return bFalse;
+    }
+
+    block->nodes = nodes;
+    block->next = *blocks;
+    *blocks = block;
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void registry_block_clear(registry_block_t **blocks)
+{
+    registry_block_t *block = *blocks;
+
+    while (block)
+    {
+        registry_block_t *next = block->next;
+        free(block->nodes);
+        free(block);
+        block = next;
+    }
+
+    *blocks = NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void functions_table_insert(soare_functions_t *node)
+{
+    soare_state_t *state = soare_state_current();
+
+    soare_functions_t **slot = &state->functions_table[registry_hash(node->name) & (state->functions_table_size - 1)];
+
+    // The first registered function keeps the name
+    for (; *slot; slot = &(*slot)->bucket)
+    {
+        if (!strcmp((*slot)->name, node->name))
+        {
+            return;
+        }
+    }
+
+    *slot = node;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t functions_table_reserve(unsigned long count)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (state->functions_table && count <= state->functions_table_size)
+    {
+        return bTrue;
+    }
+
+    unsigned long size = state->functions_table_size ? state->functions_table_size : REGISTRY_BUCKETS;
+
+    while (size < count)
+    {
+        size <<= 1;
+    }
+
+    soare_functions_t **table = (soare_functions_t **)calloc(size, sizeof(soare_functions_t *));
+
+    if (!table)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return bFalse;
+    }
+
+    free(state->functions_table);
+    state->functions_table = table;
+    state->functions_table_size = size;
+
+    // Rehash in registration order
+    for (soare_functions_t *function = state->functions_list; function; function = function->next)
+    {
+        function->bucket = NULL;
+        functions_table_insert(function);
+    }
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void functions_list_append(soare_functions_t *node)
+{
+    soare_state_t *state = soare_state_current();
+
+    node->next = NULL;
+    node->bucket = NULL;
+
+    if (!state->functions_list)
+    {
+        state->functions_list = node;
+    }
+    else
+    {
+        state->functions_last->next = node;
+    }
+
+    state->functions_last = node;
+    functions_table_insert(node);
+    state->functions_count++;
+    state->functions_epoch++;
+}
 
 ////////////////////////////////////////////////////////////
 soare_functions_t *soare_add_function(char *name, char *(*function)(soare_arguments_list_t))
 {
+    soare_state_t *state = soare_state_current();
+
     if (!name || !function)
     {
         return NULL;
     }
 
+    if (!functions_table_reserve(state->functions_count + 1))
+    {
+        return NULL;
+    }
+
     soare_functions_t *node = (soare_functions_t *)malloc(sizeof(soare_functions_t));
 
     if (!node)
@@ -121,51 +285,137 @@ soare_functions_t *soare_add_function(char *name, char *(*function)(soare_argume
         return NULL;
     }
 
-    node->name = strdup(name);
+    if (!(node->name = strdup(name)))
+    {
+        free(node);
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
     node->exec = function;
-    node->next = NULL;
+    node->owned = bTrue;
+
+    functions_list_append(node);
+    return node;
+}
+
+////////////////////////////////////////////////////////////
+unsigned int soare_add_functions(const soare_function_entry_t *table, unsigned int count)
+{
+    soare_state_t *state = soare_state_current();
 
-    if (!functions_list)
+    if (!table || !count)
     {
-        functions_list = node;
-        functions_list_ptr = node;
-        return node;
+        return 0;
+    }
+
+    if (!functions_table_reserve(state->functions_count + count))
+    {
+        return 0;
     }
 
-    functions_list_ptr->next = node;
-    functions_list_ptr = node;
+    soare_functions_t *nodes = (soare_functions_t *)malloc(count * sizeof(soare_functions_t));
 
-    return node;
+    if (!nodes)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return 0;
+    }
+
+    if (!registry_block_add(&state->functions_blocks, nodes))
+    {
+        free(nodes);
+        return 0;
+    }
+
+    unsigned int registered = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!table[i].name || !table[i].exec)
+        {
+            continue;
+        }
+
+        soare_functions_t *node = &nodes[registered++];
+
+        node->name = table[i].name;
+        node->exec = table[i].exec;
+        node->owned = bFalse;
+
+        functions_list_append(node);
+    }
+
+    return registered;
 }
 
 ////////////////////////////////////////////////////////////
 soare_functions_t *soare_get_function(char *name)
 {
-    for (soare_functions_t *function = functions_list; function; function = function->next)
+    if (!name)
     {
-        if (function->name && !strcmp(function->name, name))
+        return NULL;
+    }
+
+    unsigned long hash = registry_hash(name);
+
+    // Selected state first, then the inherited ones
+    for (const soare_state_t *state = soare_state_current(); state; state = state->parent)
+    {
+        if (!state->functions_table)
         {
-            return function;
+            continue;
+        }
+
+        soare_functions_t *function = state->functions_table[hash & (state->functions_table_size - 1)];
+
+        for (; function; function = function->bucket)
+        {
+            if (!strcmp(function->name, name))
+            {
+                return function;
+            }
         }
     }
+
     return NULL;
 }
 
+////////////////////////////////////////////////////////////
+unsigned long long soare_functions_epoch(void)
+{
+    return soare_state_current()->functions_epoch;
+}
+
 ////////////////////////////////////////////////////////////
 void soare_clear_functions(void)
 {
-    soare_functions_t *list = functions_list;
+    soare_state_t *state = soare_state_current();
+
+    soare_functions_t *list = state->functions_list;
 
     while (list)
     {
         soare_functions_t *next = list->next;
-        free(list->name);
-        free(list);
+
+        if (list->owned)
+        {
+            free(list->name);
+            free(list);
+        }
+
         list = next;
     }
 
-    functions_list = NULL;
-    functions_list_ptr = NULL;
+    registry_block_clear(&state->functions_blocks);
+    free(state->functions_table);
+
+    state->functions_list = NULL;
+    state->functions_last = NULL;
+    state->functions_table = NULL;
+    state->functions_table_size = 0;
+    state->functions_count = 0;
+    state->functions_epoch++;
 }
 
 ////////////////////////////////////////////////////////////
@@ -204,22 +454,113 @@ Implement this keyword: soare_add_keyword(<keyword name>, <function>)
 
 soare_add_keyword("clear", clear);
 
+Or register a static table at once (names are not copied):
+
+static const soare_keyword_entry_t keywords[] = {
+    {"clear", clear},
+};
+
+soare_add_keywords(keywords, sizeof(keywords) / sizeof(*keywords));
+
 ----------------------------------------------------------
 
 */
 
-/* Keywords */
-static soare_keywords_t *keywords_list = NULL;
-static soare_keywords_t *keywords_list_ptr = NULL;
+////////////////////////////////////////////////////////////
+static void keywords_table_insert(soare_keywords_t *node)
+{
+    soare_state_t *state = soare_state_current();
+
+    soare_keywords_t **slot = &state->keywords_table[registry_hash(node->name) & (state->keywords_table_size - 1)];
+
+    // The first registered keyword keeps the name
+    for (; *slot; slot = &(*slot)->bucket)
+    {
+        if (!strcmp((*slot)->name, node->name))
+        {
+            return;
+        }
+    }
+
+    *slot = node;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t keywords_table_reserve(unsigned long count)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (state->keywords_table && count <= state->keywords_table_size)
+    {
+        return bTrue;
+    }
+
+    unsigned long size = state->keywords_table_size ? state->keywords_table_size : REGISTRY_BUCKETS;
+
+    while (size < count)
+    {
+        size <<= 1;
+    }
+
+    soare_keywords_t **table = (soare_keywords_t **)calloc(size, sizeof(soare_keywords_t *));
+
+    if (!table)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return bFalse;
+    }
+
+    free(state->keywords_table);
+    state->keywords_table = table;
+    state->keywords_table_size = size;
+
+    // Rehash in registration order
+    for (soare_keywords_t *keyword = state->keywords_list; keyword; keyword = keyword->next)
+    {
+        keyword->bucket = NULL;
+        keywords_table_insert(keyword);
+    }
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void keywords_list_append(soare_keywords_t *node)
+{
+    soare_state_t *state = soare_state_current();
+
+    node->next = NULL;
+    node->bucket = NULL;
+
+    if (!state->keywords_list)
+    {
+        state->keywords_list = node;
+    }
+    else
+    {
+        state->keywords_last->next = node;
+    }
+
+    state->keywords_last = node;
+    keywords_table_insert(node);
+    state->keywords_count++;
+}
 
 ////////////////////////////////////////////////////////////
 soare_keywords_t *soare_add_keyword(char *name, void (*keyword)(void))
 {
+    soare_state_t *state = soare_state_current();
+
     if (!name || !keyword)
     {
         return NULL;
     }
 
+    if (!keywords_table_reserve(state->keywords_count + 1))
+    {
+        return NULL;
+    }
+
     soare_keywords_t *node = (soare_keywords_t *)malloc(sizeof(soare_keywords_t));
 
     if (!node)
@@ -228,51 +569,130 @@ soare_keywords_t *soare_add_keyword(char *name, void (*keyword)(void))
         return NULL;
     }
 
-    keywords_list_ptr->name = strdup(name);
-    keywords_list_ptr->exec = keyword;
-    keywords_list_ptr->next = NULL;
-
-    if (!keywords_list)
+    if (!(node->name = strdup(name)))
     {
-        keywords_list = node;
-        keywords_list_ptr = node;
-        return node;
+        free(node);
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
     }
 
-    keywords_list_ptr->next = node;
-    keywords_list_ptr = node;
+    node->exec = keyword;
+    node->owned = bTrue;
 
+    keywords_list_append(node);
     return node;
 }
 
+////////////////////////////////////////////////////////////
+unsigned int soare_add_keywords(const soare_keyword_entry_t *table, unsigned int count)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (!table || !count)
+    {
+        return 0;
+    }
+
+    if (!keywords_table_reserve(state->keywords_count + count))
+    {
+        return 0;
+    }
+
+    soare_keywords_t *nodes = (soare_keywords_t *)malloc(count * sizeof(soare_keywords_t));
+
+    if (!nodes)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return 0;
+    }
+
+    if (!registry_block_add(&state->keywords_blocks, nodes))
+    {
+        free(nodes);
+        return 0;
+    }
+
+    unsigned int registered = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!table[i].name || !table[i].exec)
+        {
+            continue;
+        }
+
+        soare_keywords_t *node = &nodes[registered++];
+
+        node->name = table[i].name;
+        node->exec = table[i].exec;
+        node->owned = bFalse;
+
+        keywords_list_append(node);
+    }
+
+    return registered;
+}
+
 ////////////////////////////////////////////////////////////
 soare_keywords_t *soare_get_keyword(char *name)
 {
-    for (soare_keywords_t *keyword = keywords_list; keyword; keyword = keyword->next)
+    if (!name)
     {
-        if (keyword->name && !strcmp(keyword->name, name))
+        return NULL;
+    }
+
+    unsigned long hash = registry_hash(name);
+
+    // Selected state first, then the inherited ones
+    for (const soare_state_t *state = soare_state_current(); state; state = state->parent)
+    {
+        if (!state->keywords_table)
+        {
+            continue;
+        }
+
+        soare_keywords_t *keyword = state->keywords_table[hash & (state->keywords_table_size - 1)];
+
+        for (; keyword; keyword = keyword->bucket)
         {
-            return keyword;
+            if (!strcmp(keyword->name, name))
+            {
+                return keyword;
+            }
         }
     }
+
     return NULL;
 }
 
 ////////////////////////////////////////////////////////////
 void soare_clear_keywords(void)
 {
-    soare_keywords_t *list = keywords_list;
+    soare_state_t *state = soare_state_current();
+
+    soare_keywords_t *list = state->keywords_list;
 
     while (list)
     {
         soare_keywords_t *next = list->next;
-        free(list->name);
-        free(list);
+
+        if (list->owned)
+        {
+            free(list->name);
+            free(list);
+        }
+
         list = next;
     }
 
-    keywords_list = NULL;
-    keywords_list_ptr = NULL;
+    registry_block_clear(&state->keywords_blocks);
+    free(state->keywords_table);
+
+    state->keywords_list = NULL;
+    state->keywords_last = NULL;
+    state->keywords_table = NULL;
+    state->keywords_table_size = 0;
+    state->keywords_count = 0;
 }
 
 /*
@@ -299,52 +719,71 @@ soare_add_variable("false", bool_false, 0);
 
 */
 
-/* Current scope level */
-static unsigned long long scope = 0;
+////////////////////////////////////////////////////////////
+static void variable_free(soare_variables_t *variable)
+{
+    soare_memory_account(SOARE_MEMORY_STRINGS, variable->size, 0);
 
-/* Variables */
-static soare_variables_t *variables_list = NULL;
-static soare_variables_t *variables_list_ptr = NULL;
+    soare_free(variable->name);
+    free(variable->value);
+    soare_free(variable);
+}
 
 ////////////////////////////////////////////////////////////
 soare_variables_t *soare_add_variable(char *name, char *value, boolean_t mutable)
 {
+    soare_state_t *state = soare_state_current();
+
     if (!name)
     {
         return NULL;
     }
 
-    soare_variables_t *node = (soare_variables_t *)malloc(sizeof(soare_variables_t));
+    soare_variables_t *node = (soare_variables_t *)soare_alloc(SOARE_MEMORY_VARIABLES, sizeof(soare_variables_t));
 
     if (!node)
     {
-        SOARE_OUT_OF_MEMORY();
         return NULL;
     }
 
-    node->name = strdup(name);
+    node->name = soare_strdup(SOARE_MEMORY_VARIABLES, name);
     node->body = NULL;
     node->prev = NULL;
     node->next = NULL;
     node->value = NULL;
-    node->scope = scope;
+    node->size = 0;
+    node->scope = state->scope;
     node->mutable = mutable;
 
+    if (!node->name)
+    {
+        soare_free(node);
+        return NULL;
+    }
+
     if (value)
     {
-        node->value = strdup(value);
+        soare_set_value(node, strdup(value));
+    }
+
+    state->variables_epoch++;
+
+    if (soare_get_function(name))
+    {
+        // Calls resolved to this native function are shadowed
+        state->functions_epoch++;
     }
 
-    if (!variables_list)
+    if (!state->variables_list)
     {
-        variables_list = node;
-        variables_list_ptr = node;
+        state->variables_list = node;
+        state->variables_last = node;
         return node;
     }
 
-    node->prev = variables_list_ptr;
-    variables_list_ptr->next = node;
-    variables_list_ptr = node;
+    node->prev = state->variables_last;
+    state->variables_last->next = node;
+    state->variables_last = node;
 
     return node;
 }
@@ -352,76 +791,247 @@ soare_variables_t *soare_add_variable(char *name, char *value, boolean_t mutable
 ////////////////////////////////////////////////////////////
 soare_variables_t *soare_get_variable(char *name)
 {
-    for (soare_variables_t *var = variables_list_ptr; var; var = var->prev)
+    soare_state_t *current = soare_state_current();
+    const soare_state_t *state = current;
+
+    unsigned long long steps = 0;
+    soare_variables_t *found = NULL;
+
+    for (soare_variables_t *var = state->variables_last; var && !found; var = var->prev, steps++)
     {
         if (var->name && !strcmp(var->name, name))
         {
-            return var;
+            found = var;
         }
     }
-    return NULL;
+
+    // Inherited states only share their constants and the SOARE
+    // functions of shared trees: other trees are rewritten at runtime
+    for (state = state->parent; state && !found; state = state->parent)
+    {
+        for (soare_variables_t *var = state->variables_last; var && !found; var = var->prev, steps++)
+        {
+            if (var->name && !var->mutable && (!var->body || var->body->shared) && !strcmp(var->name, name))
+            {
+                found = var;
+            }
+        }
+    }
+
+    SOARE_STATS_ADD(current, lookups, 1);
+    SOARE_STATS_ADD(current, lookup_steps, steps);
+
+    return found;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_set_value(soare_variables_t *variable, char *value)
+{
+    size_t size = value ? strlen(value) + 1 : 0;
+
+    if (!soare_memory_account(SOARE_MEMORY_STRINGS, variable->size, size))
+    {
+        free(value);
+        return bFalse;
+    }
+
+    free(variable->value);
+    variable->value = value;
+    variable->size = size;
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+soare_variables_t *soare_get_variable_cached(ast_t tree)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (tree->shared)
+    {
+        // Other states may read this node at the same time
+        return soare_get_variable(tree->value);
+    }
+
+    if (tree->cache && tree->epoch == state->variables_epoch)
+    {
+        return (soare_variables_t *)tree->cache;
+    }
+
+    soare_variables_t *get = soare_get_variable(tree->value);
+
+    tree->cache = get;
+    tree->epoch = state->variables_epoch;
+
+    return get;
+}
+
+////////////////////////////////////////////////////////////
+soare_variables_t *soare_last_variable(void)
+{
+    return soare_state_current()->variables_last;
+}
+
+////////////////////////////////////////////////////////////
+void soare_reset_scope(soare_variables_t *mark)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (state->variables_last == mark)
+    {
+        return;
+    }
+
+    state->variables_epoch++;
+
+    soare_variables_t *list = state->variables_last;
+
+    while (list && list != mark)
+    {
+        soare_variables_t *prev = list->prev;
+
+        variable_free(list);
+
+        list = prev;
+    }
+
+    state->variables_last = mark;
+
+    if (!mark)
+    {
+        state->variables_list = NULL;
+        return;
+    }
+
+    mark->next = NULL;
+}
+
+////////////////////////////////////////////////////////////
+soare_variables_t *soare_detach_variables(soare_variables_t *mark)
+{
+    soare_state_t *state = soare_state_current();
+
+    soare_variables_t *first = mark ? mark->next : state->variables_list;
+
+    if (!first)
+    {
+        return NULL;
+    }
+
+    state->variables_epoch++;
+    state->variables_last = mark;
+
+    if (mark)
+    {
+        mark->next = NULL;
+    }
+    else
+    {
+        state->variables_list = NULL;
+    }
+
+    first->prev = NULL;
+    return first;
+}
+
+////////////////////////////////////////////////////////////
+void soare_attach_variables(soare_variables_t *variables, long long shift)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (!variables)
+    {
+        return;
+    }
+
+    state->variables_epoch++;
+
+    variables->prev = state->variables_last;
+
+    if (state->variables_last)
+    {
+        state->variables_last->next = variables;
+    }
+    else
+    {
+        state->variables_list = variables;
+    }
+
+    for (; variables; variables = variables->next)
+    {
+        variables->scope += (unsigned long long)shift;
+        state->variables_last = variables;
+    }
 }
 
 ////////////////////////////////////////////////////////////
 void soare_up_scope(void)
 {
-    scope += 1;
+    // Read by soare_state_stats() from other threads
+    __atomic_fetch_add(&soare_state_current()->scope, 1, __ATOMIC_RELAXED);
 }
 
 ////////////////////////////////////////////////////////////
 void soare_down_scope(void)
 {
-    scope -= scope ? 1 : 0;
+    soare_state_t *state = soare_state_current();
+
+    if (state->scope)
+    {
+        __atomic_fetch_sub(&state->scope, 1, __ATOMIC_RELAXED);
+    }
 }
 
 ////////////////////////////////////////////////////////////
 void soare_clear_scope(void)
 {
-    if (scope <= 1)
+    soare_state_t *state = soare_state_current();
+
+    if (state->scope <= 1)
     {
         return;
     }
 
-    soare_variables_t *list = variables_list_ptr;
+    soare_variables_t *list = state->variables_last;
 
     while (list)
     {
-        if (list->scope < scope)
+        if (list->scope < state->scope)
         {
             soare_down_scope();
-            variables_list_ptr = list;
-            variables_list_ptr->next = NULL;
+            state->variables_last = list;
+            state->variables_last->next = NULL;
             return;
         }
 
         soare_variables_t *prev = list->prev;
 
-        free(list->name);
-        free(list->value);
-        free(list);
+        variable_free(list);
 
+        state->variables_epoch++;
         list = prev;
     }
 
-    scope = 0;
-    variables_list = NULL;
-    variables_list_ptr = NULL;
+    __atomic_store_n(&state->scope, 0, __ATOMIC_RELAXED);
+    state->variables_list = NULL;
+    state->variables_last = NULL;
 }
 
 ////////////////////////////////////////////////////////////
 void soare_clear_variables(void)
 {
-    soare_variables_t *list = variables_list;
+    soare_state_t *state = soare_state_current();
+
+    soare_variables_t *list = state->variables_list;
 
     while (list)
     {
         soare_variables_t *next = list->next;
-        free(list->name);
-        free(list->value);
-        free(list);
+        variable_free(list);
         list = next;
     }
 
-    variables_list = NULL;
-    variables_list_ptr = NULL;
+    state->variables_list = NULL;
+    state->variables_last = NULL;
+    state->variables_epoch++;
 }
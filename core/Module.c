@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Module.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#include <SOARE/SOARE.h>
+
+/* Loaded modules, shared by all states */
+static soare_module_t *cache = NULL;
+
+/* Protects the module cache and the references */
+static char cache_lock = 0;
+
+////////////////////////////////////////////////////////////
+static void lock(void)
+{
+    while (__atomic_test_and_set(&cache_lock, __ATOMIC_ACQUIRE))
+        ;
+}
+
+////////////////////////////////////////////////////////////
+static void unlock(void)
+{
+    __atomic_clear(&cache_lock, __ATOMIC_RELEASE);
+}
+
+////////////////////////////////////////////////////////////
+static soare_module_t *module_new(char *filename, char *rawcode)
+{
+    // Any state may release the last reference
+    soare_memory_shared(bTrue);
+    tokens_t *tokens = soare_tokenizer(filename, rawcode);
+    ast_t tree = soare_parser(tokens);
+    soare_tokens_free(tokens);
+    soare_memory_shared(bFalse);
+
+    if (!tree)
+    {
+        return NULL;
+    }
+
+    soare_module_t *module = (soare_module_t *)calloc(1, sizeof(soare_module_t));
+
+    if (!module || !(module->filename = strdup(filename)))
+    {
+        free(module);
+        soare_tree_free(tree);
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    // Closures are compiled before any state can run the tree
+    soare_closure_compile(tree);
+    soare_math_freeze(tree);
+
+    module->tree = tree;
+    module->references = 1;
+
+    return module;
+}
+
+////////////////////////////////////////////////////////////
+soare_module_t *soare_module_load(char *filename)
+{
+    struct stat info;
+
+    if (stat(filename, &info) != 0)
+    {
+        soare_leave_exception(FileError, filename, soare_empty_document());
+        return NULL;
+    }
+
+    lock();
+
+    for (soare_module_t *module = cache; module; module = module->next)
+    {
+        if (module->modified == (long long)info.st_mtime && module->size == (long long)info.st_size && !strcmp(module->filename, filename))
+        {
+            module->references++;
+            unlock();
+            return module;
+        }
+    }
+
+    unlock();
+
+    FILE *file = fopen(filename, "rb");
+
+    if (!file)
+    {
+        soare_leave_exception(FileError, filename, soare_empty_document());
+        return NULL;
+    }
+
+    if (fseek(file, 0, SEEK_END) != 0)
+    {
+        fclose(file);
+        soare_leave_exception(FileError, filename, soare_empty_document());
+        return NULL;
+    }
+
+    long size = ftell(file);
+
+    if (size <= 0)
+    {
+        fclose(file);
+        soare_leave_exception(FileError, filename, soare_empty_document());
+        return NULL;
+    }
+
+    rewind(file);
+
+    char *content = (char *)malloc((size_t)size + 1);
+
+    if (!content)
+    {
+        fclose(file);
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    size_t read = fread(content, 1, (size_t)size, file);
+    fclose(file);
+
+    if (read != (size_t)size)
+    {
+        free(content);
+        soare_leave_exception(FileError, filename, soare_empty_document());
+        return NULL;
+    }
+
+    content[read] = 0;
+
+    // Parsed without the lock: another thread may load the same file
+    soare_module_t *module = module_new(filename, content);
+    free(content);
+
+    if (!module)
+    {
+        return NULL;
+    }
+
+    module->modified = (long long)info.st_mtime;
+    module->size = (long long)info.st_size;
+    module->registered = bTrue;
+
+    lock();
+    module->next = cache;
+    cache = module;
+    unlock();
+
+    return module;
+}
+
+////////////////////////////////////////////////////////////
+soare_module_t *soare_module_compile(char *__restrict__ filename, char *__restrict__ rawcode)
+{
+    return module_new(filename, rawcode);
+}
+
+////////////////////////////////////////////////////////////
+soare_module_t *soare_module_retain(soare_module_t *module)
+{
+    if (module)
+    {
+        lock();
+        module->references++;
+        unlock();
+    }
+
+    return module;
+}
+
+////////////////////////////////////////////////////////////
+void soare_module_release(soare_module_t *module)
+{
+    if (!module)
+    {
+        return;
+    }
+
+    lock();
+
+    if (--module->references)
+    {
+        unlock();
+        return;
+    }
+
+    if (module->registered)
+    {
+        soare_module_t **link = &cache;
+
+        while (*link != module)
+        {
+            link = &(*link)->next;
+        }
+
+        *link = module->next;
+    }
+
+    unlock();
+
+    soare_tree_free(module->tree);
+    free(module->filename);
+    free(module);
+}
@@ -17,9 +17,6 @@
 
 #include <SOARE/SOARE.h>
 
-/* Global flag to track if all statements are properly closed */
-static boolean_t all_statement_closed = bTrue;
-
 /**
  *  Example of AST (Abstract Syntax Tree) :
  *
@@ -60,31 +57,36 @@ static boolean_t all_statement_closed = bTrue;
 ////////////////////////////////////////////////////////////
 boolean_t soare_is_all_statement_closed(void)
 {
-    return all_statement_closed;
+    return soare_state_current()->all_statement_closed;
 }
 
 ////////////////////////////////////////////////////////////
 node_t *soare_new_node(char *value, node_type_t type, document_t file)
 {
-    node_t *node = (node_t *)malloc(sizeof(node_t));
+    node_t *node = (node_t *)soare_alloc(SOARE_MEMORY_AST, sizeof(node_t));
 
     if (!node)
     {
-        SOARE_OUT_OF_MEMORY();
         return NULL;
     }
 
     node->value = value;
 
-    if (value)
+    if (value && !(node->value = soare_strdup(SOARE_MEMORY_AST, value)))
     {
-        node->value = strdup(value);
+        soare_free(node);
+        return NULL;
     }
 
     node->type = type;
     node->file = file;
+    node->cache = NULL;
+    node->epoch = 0;
+    node->closure = NULL;
+    node->shared = bFalse;
     node->parent = NULL;
     node->child = NULL;
+    node->last = NULL;
     node->sibling = NULL;
 
     return node;
@@ -178,7 +180,8 @@ ast_t soare_tree_join(ast_t parent, ast_t child)
 
     if (parent->child)
     {
-        node_t *tmp = parent->child;
+        // From the last joined child: bodies may hold many statements
+        node_t *tmp = parent->last ? parent->last : parent->child;
 
         while (tmp->sibling)
         {
@@ -193,30 +196,38 @@ ast_t soare_tree_join(ast_t parent, ast_t child)
     }
 
     child->parent = parent;
+    parent->last = child;
+
     return parent;
 }
 
 ////////////////////////////////////////////////////////////
 void soare_tree_free(ast_t tree)
 {
-    if (!tree)
-        return;
+    // Siblings in a loop: a body may hold many statements
+    while (tree)
+    {
+        ast_t sibling = tree->sibling;
+
+        soare_tree_free(tree->child);
+        free(tree->closure);
+        soare_free(tree->value);
+        soare_free(tree);
 
-    soare_tree_free(tree->sibling);
-    soare_tree_free(tree->child);
-    free(tree->value);
-    free(tree);
+        tree = sibling;
+    }
 }
 
 ////////////////////////////////////////////////////////////
-ast_t soare_parser(tokens_t *tokens)
+static ast_t parse(tokens_t *tokens)
 {
     ast_t root = soare_new_node(NULL, NODE_ROOT, soare_empty_document());
     ast_t curr = root;
 
-    all_statement_closed = bTrue;
+    soare_state_current()->all_statement_closed = bTrue;
 
-    while (tokens)
+    // Stops on errors raised while building the nodes (quotas)
+    while (tokens && !soare_errorlevel())
     {
         if (tokens->type == TKN_EOF)
         {
@@ -324,6 +335,30 @@ ast_t soare_parser(tokens_t *tokens)
                 soare_tree_join(curr, soare_tree_join(return_stmt, content));
             }
 
+            else if (!strcmp(old->value, KEYWORD_YIELD))
+            {
+                // The innermost function becomes a generator
+                ast_t body = curr;
+
+                while (body != root && body->parent->type != NODE_FUNCTION)
+                {
+                    body = body->parent;
+                }
+
+                if (body == root)
+                {
+                    soare_tree_free(root);
+                    soare_leave_exception(UnexpectedNear, old->value, old->file);
+                    return NULL;
+                }
+
+                body->type = NODE_GENERATOR;
+
+                ast_t yield = soare_new_node(NULL, NODE_YIELD, old->file);
+                ast_t content = soare_parse_expression(&tokens, 0xF);
+                soare_tree_join(curr, soare_tree_join(yield, content));
+            }
+
             else if (!strcmp(old->value, KEYWORD_RAISE))
             {
                 if (tokens->type != TKN_STRING)
@@ -412,6 +447,15 @@ ast_t soare_parser(tokens_t *tokens)
 
             else if (!strcmp(old->value, KEYWORD_WHILE))
             {
+                char *name = NULL;
+
+                // while <varname> in <generator> (`in` is not reserved)
+                if (tokens->type == TKN_NAME && tokens->next->type == TKN_NAME && !strcmp(tokens->next->value, KEYWORD_IN))
+                {
+                    name = tokens->value;
+                    tokens = tokens->next->next;
+                }
+
                 ast_t condition = soare_parse_expression(&tokens, 0xF);
 
                 if (!condition)
@@ -421,7 +465,7 @@ ast_t soare_parser(tokens_t *tokens)
                     return NULL;
                 }
 
-                ast_t statement = soare_new_node(NULL, NODE_REPETITION, old->file);
+                ast_t statement = soare_new_node(name, NODE_REPETITION, old->file);
                 ast_t body = soare_new_node(NULL, NODE_BODY, old->file);
 
                 soare_tree_join(statement, condition);
@@ -537,6 +581,23 @@ ast_t soare_parser(tokens_t *tokens)
         return NULL;
     }
 
-    all_statement_closed = (boolean_t)(curr == root);
+    soare_state_current()->all_statement_closed = (boolean_t)(curr == root);
     return root;
 }
+
+////////////////////////////////////////////////////////////
+ast_t soare_parser(tokens_t *tokens)
+{
+    soare_trace_t *trace = soare_state_current()->trace;
+
+    if (!trace)
+    {
+        return parse(tokens);
+    }
+
+    soare_trace_begin(trace, "parse", tokens ? tokens->file.filename : NULL);
+    ast_t tree = parse(tokens);
+    soare_trace_end(trace);
+
+    return tree;
+}
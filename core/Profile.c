@@ -0,0 +1,577 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Profile.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#include <SOARE/SOARE.h>
+
+/**
+ *
+ * The profile keeps:
+ *
+ * - A table of functions (calls, self and inclusive time)
+ * - A calling context tree: one node per distinct call path, with
+ *   its self time, written as collapsed stacks
+ * - The stack of running calls, above a root frame for the code
+ *   outside of any function
+ *
+ * Everything is indexed, so that arrays can grow while frames
+ * refer to their function and to their node
+ *
+ */
+
+/* No function (root frame) */
+#define PROFILE_NONE ((unsigned long)-1)
+/* Initial number of hash buckets (power of two) */
+#define PROFILE_BUCKETS 64
+
+/**
+ * @brief Profiled function
+ */
+typedef struct profile_function
+{
+
+    const void *key;          /**< Definition of the function         */
+    char *name;               /**< Name of the function               */
+    char *location;           /**< "file:line:column", or NULL        */
+    unsigned long long calls; /**< Number of calls                    */
+    unsigned long long self;  /**< Time in the function itself (ns)   */
+    unsigned long long total; /**< Time with its callees (ns)         */
+    unsigned long active;     /**< Calls running (recursion)          */
+
+} profile_function_t;
+
+/**
+ * @brief Call path (calling context tree)
+ */
+typedef struct profile_node
+{
+
+    unsigned long function;  /**< Function, or PROFILE_NONE (root)   */
+    unsigned long parent;    /**< Calling path                       */
+    unsigned long child;     /**< First callee, or 0                 */
+    unsigned long sibling;   /**< Next callee of the parent, or 0    */
+    unsigned long long self; /**< Time in the function itself (ns)   */
+
+} profile_node_t;
+
+/**
+ * @brief Running call
+ */
+typedef struct profile_frame
+{
+
+    unsigned long function;      /**< Called function                 */
+    unsigned long node;          /**< Call path                       */
+    unsigned long long start;    /**< Start time (ns)                 */
+    unsigned long long children; /**< Time in the callees (ns)        */
+
+} profile_frame_t;
+
+/**
+ * @brief Function profile of a state
+ */
+struct soare_profile
+{
+
+    profile_function_t *functions; /**< Profiled functions              */
+    unsigned long functions_count; /**< Number of functions             */
+    unsigned long functions_size;  /**< Capacity of the functions       */
+    unsigned long *table;          /**< Functions by key (index + 1)    */
+    unsigned long table_size;      /**< Number of buckets               */
+    profile_node_t *nodes;         /**< Call paths, root first          */
+    unsigned long nodes_count;     /**< Number of call paths            */
+    unsigned long nodes_size;      /**< Capacity of the call paths      */
+    profile_frame_t *frames;       /**< Running calls, root first       */
+    unsigned long frames_count;    /**< Number of running calls         */
+    unsigned long frames_size;     /**< Capacity of the running calls   */
+
+};
+
+////////////////////////////////////////////////////////////
+static unsigned long long profile_now(void)
+{
+    struct timespec now;
+
+#ifdef _WIN32
+    timespec_get(&now, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t profile_reserve(void **array, unsigned long *size, unsigned long count, size_t item)
+{
+    if (count < *size)
+    {
+        return bTrue;
+    }
+
+    unsigned long grown = *size ? *size * 2 : 64;
+    void *resized = realloc(*array, grown * item);
+
+    if (!resized)
+    {
+        return bFalse;
+    }
+
+    *array = resized;
+    *size = grown;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long profile_hash(const void *key)
+{
+    unsigned long long hash = (unsigned long long)(size_t)key;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+
+    return (unsigned long)hash;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t profile_rehash(soare_profile_t *profile)
+{
+    unsigned long size = profile->table_size ? profile->table_size * 2 : PROFILE_BUCKETS;
+    unsigned long *table = (unsigned long *)calloc(size, sizeof(unsigned long));
+
+    if (!table)
+    {
+        return bFalse;
+    }
+
+    for (unsigned long i = 0; i < profile->functions_count; i++)
+    {
+        unsigned long bucket = profile_hash(profile->functions[i].key) & (size - 1);
+
+        while (table[bucket])
+        {
+            bucket = (bucket + 1) & (size - 1);
+        }
+
+        table[bucket] = i + 1;
+    }
+
+    free(profile->table);
+    profile->table = table;
+    profile->table_size = size;
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long profile_function(soare_profile_t *profile, const void *key, const char *name, const document_t *file)
+{
+    unsigned long bucket = profile_hash(key) & (profile->table_size - 1);
+
+    for (; profile->table[bucket]; bucket = (bucket + 1) & (profile->table_size - 1))
+    {
+        profile_function_t *function = &profile->functions[profile->table[bucket] - 1];
+
+        // A freed definition may have been replaced at the same address
+        if (function->key == key && !strcmp(function->name, name))
+        {
+            return profile->table[bucket] - 1;
+        }
+    }
+
+    // At most half full
+    if (2 * (profile->functions_count + 1) > profile->table_size)
+    {
+        if (!profile_rehash(profile))
+        {
+            return PROFILE_NONE;
+        }
+
+        return profile_function(profile, key, name, file);
+    }
+
+    if (!profile_reserve((void **)&profile->functions, &profile->functions_size, profile->functions_count, sizeof(profile_function_t)))
+    {
+        return PROFILE_NONE;
+    }
+
+    profile_function_t *function = &profile->functions[profile->functions_count];
+    memset(function, 0, sizeof(profile_function_t));
+
+    function->key = key;
+    function->name = strdup(name);
+
+    if (file && file->filename)
+    {
+        size_t size = strlen(file->filename) + 48;
+
+        if ((function->location = (char *)malloc(size)))
+        {
+            snprintf(function->location, size, "%s:%llu:%llu", file->filename, file->ln, file->col);
+        }
+    }
+
+    if (!function->name)
+    {
+        free(function->location);
+        return PROFILE_NONE;
+    }
+
+    profile->table[bucket] = ++profile->functions_count;
+    return profile->functions_count - 1;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long profile_node(soare_profile_t *profile, unsigned long parent, unsigned long function)
+{
+    for (unsigned long node = profile->nodes[parent].child; node; node = profile->nodes[node].sibling)
+    {
+        if (profile->nodes[node].function == function)
+        {
+            return node;
+        }
+    }
+
+    if (!profile_reserve((void **)&profile->nodes, &profile->nodes_size, profile->nodes_count, sizeof(profile_node_t)))
+    {
+        return 0;
+    }
+
+    unsigned long node = profile->nodes_count++;
+
+    profile->nodes[node].function = function;
+    profile->nodes[node].parent = parent;
+    profile->nodes[node].child = 0;
+    profile->nodes[node].sibling = profile->nodes[parent].child;
+    profile->nodes[node].self = 0;
+    profile->nodes[parent].child = node;
+
+    return node;
+}
+
+////////////////////////////////////////////////////////////
+static void profile_pop(soare_profile_t *profile, unsigned long long now)
+{
+    profile_frame_t *frame = &profile->frames[--profile->frames_count];
+    profile_function_t *function = &profile->functions[frame->function];
+
+    unsigned long long elapsed = now - frame->start;
+    unsigned long long self = elapsed > frame->children ? elapsed - frame->children : 0;
+
+    function->self += self;
+    profile->nodes[frame->node].self += self;
+
+    // Recursive calls are included in the outermost one
+    if (!--function->active)
+    {
+        function->total += elapsed;
+    }
+
+    profile->frames[profile->frames_count - 1].children += elapsed;
+}
+
+////////////////////////////////////////////////////////////
+unsigned long soare_profile_enter(soare_profile_t *profile, const void *key, const char *name, const document_t *file)
+{
+    if (!profile_reserve((void **)&profile->frames, &profile->frames_size, profile->frames_count, sizeof(profile_frame_t)))
+    {
+        return 0;
+    }
+
+    unsigned long function = profile_function(profile, key, name, file);
+
+    if (function == PROFILE_NONE)
+    {
+        return 0;
+    }
+
+    unsigned long node = profile_node(profile, profile->frames[profile->frames_count - 1].node, function);
+
+    if (!node)
+    {
+        return 0;
+    }
+
+    profile->functions[function].calls++;
+    profile->functions[function].active++;
+
+    profile_frame_t *frame = &profile->frames[profile->frames_count];
+
+    frame->function = function;
+    frame->node = node;
+    frame->children = 0;
+    frame->start = profile_now();
+
+    return profile->frames_count++;
+}
+
+////////////////////////////////////////////////////////////
+void soare_profile_leave(soare_profile_t *profile, unsigned long depth)
+{
+    // Frames of suspended tasks may already be gone
+    if (!depth || depth >= profile->frames_count)
+    {
+        return;
+    }
+
+    unsigned long long now = profile_now();
+
+    while (profile->frames_count > depth)
+    {
+        profile_pop(profile, now);
+    }
+}
+
+////////////////////////////////////////////////////////////
+char *soare_profile_native(soare_functions_t *function, soare_arguments_list_t args)
+{
+    soare_state_t *state = soare_state_current();
+
+    soare_profile_t *profile = state->profile;
+    soare_sampler_t *sampler = state->sampler;
+    soare_lines_t *lines = state->lines;
+    soare_trace_t *trace = state->trace;
+
+    unsigned long depth = profile ? soare_profile_enter(profile, function, function->name, NULL) : 0;
+    unsigned long sampled = sampler ? soare_sampler_enter(sampler, function->name, NULL) : 0;
+    unsigned long caller = lines ? soare_lines_enter(lines) : 0;
+
+    if (trace)
+    {
+        soare_trace_begin(trace, "native", function->name);
+    }
+
+    char *returned = function->exec(args);
+
+    if (profile)
+    {
+        soare_profile_leave(profile, depth);
+    }
+
+    if (sampler)
+    {
+        soare_sampler_leave(sampler, sampled);
+    }
+
+    if (lines)
+    {
+        soare_lines_leave(lines, caller);
+    }
+
+    if (trace)
+    {
+        soare_trace_end(trace);
+    }
+
+    return returned;
+}
+
+////////////////////////////////////////////////////////////
+static soare_state_t *profile_state(soare_state_t *state)
+{
+    if (state)
+    {
+        return state;
+    }
+
+    // NULL selects the default state
+    soare_state_t *previous = soare_state_select(NULL);
+    state = soare_state_current();
+    soare_state_select(previous);
+
+    return state;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_profile_start(soare_state_t *state)
+{
+    state = profile_state(state);
+    soare_profile_stop(state);
+
+    soare_profile_t *profile = (soare_profile_t *)calloc(1, sizeof(soare_profile_t));
+
+    if (!profile || !profile_rehash(profile) ||
+        !profile_reserve((void **)&profile->nodes, &profile->nodes_size, 0, sizeof(profile_node_t)) ||
+        !profile_reserve((void **)&profile->frames, &profile->frames_size, 0, sizeof(profile_frame_t)))
+    {
+        if (profile)
+        {
+            free(profile->table);
+            free(profile->nodes);
+        }
+
+        free(profile);
+        SOARE_OUT_OF_MEMORY();
+        return bFalse;
+    }
+
+    // Root: the code outside of any function
+    profile->nodes[0] = (profile_node_t){PROFILE_NONE, 0, 0, 0, 0};
+    profile->frames[0] = (profile_frame_t){PROFILE_NONE, 0, profile_now(), 0};
+    profile->nodes_count = 1;
+    profile->frames_count = 1;
+
+    state->profile = profile;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+void soare_profile_stop(soare_state_t *state)
+{
+    state = profile_state(state);
+    soare_profile_t *profile = state->profile;
+
+    if (!profile)
+    {
+        return;
+    }
+
+    for (unsigned long i = 0; i < profile->functions_count; i++)
+    {
+        free(profile->functions[i].name);
+        free(profile->functions[i].location);
+    }
+
+    free(profile->functions);
+    free(profile->table);
+    free(profile->nodes);
+    free(profile->frames);
+    free(profile);
+
+    state->profile = NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void profile_report(soare_profile_t *profile, FILE *file, unsigned long long elapsed)
+{
+    unsigned long *order = (unsigned long *)malloc((profile->functions_count + 1) * sizeof(unsigned long));
+
+    if (!order)
+    {
+        return;
+    }
+
+    for (unsigned long i = 0; i < profile->functions_count; i++)
+    {
+        order[i] = i;
+    }
+
+    // By self time, stable
+    for (unsigned long i = 1; i < profile->functions_count; i++)
+    {
+        unsigned long current = order[i];
+        unsigned long j = i;
+
+        for (; j && profile->functions[order[j - 1]].self < profile->functions[current].self; j--)
+        {
+            order[j] = order[j - 1];
+        }
+
+        order[j] = current;
+    }
+
+    fprintf(file, "SOARE profile: %.3f ms\n\n", (double)elapsed / 1e6);
+    fprintf(file, "%14s %14s %12s  %s\n", "self (ms)", "total (ms)", "calls", "function");
+    fprintf(file, "%14.3f %14.3f %12d  %s\n", (double)profile->nodes[0].self / 1e6, (double)elapsed / 1e6, 1, "<main>");
+
+    for (unsigned long i = 0; i < profile->functions_count; i++)
+    {
+        const profile_function_t *function = &profile->functions[order[i]];
+
+        fprintf(
+            //
+            file, "%14.3f %14.3f %12llu  %s (%s)\n",
+            (double)function->self / 1e6, (double)function->total / 1e6, function->calls,
+            function->name, function->location ? function->location : "native"
+            //
+        );
+    }
+
+    free(order);
+}
+
+////////////////////////////////////////////////////////////
+static void profile_label(soare_profile_t *profile, FILE *file, unsigned long node)
+{
+    // Path from the root to the node
+    if (node)
+    {
+        profile_label(profile, file, profile->nodes[node].parent);
+
+        const profile_function_t *function = &profile->functions[profile->nodes[node].function];
+        fprintf(file, ";%s", function->name);
+
+        if (function->location)
+        {
+            fprintf(file, " (%s)", function->location);
+        }
+
+        return;
+    }
+
+    fprintf(file, "<main>");
+}
+
+////////////////////////////////////////////////////////////
+static void profile_collapsed(soare_profile_t *profile, FILE *file)
+{
+    for (unsigned long node = 0; node < profile->nodes_count; node++)
+    {
+        unsigned long long microseconds = profile->nodes[node].self / 1000;
+
+        if (microseconds)
+        {
+            profile_label(profile, file, node);
+            fprintf(file, " %llu\n", microseconds);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_profile_write(soare_state_t *state, FILE *report, FILE *collapsed)
+{
+    state = profile_state(state);
+    soare_profile_t *profile = state->profile;
+
+    if (!profile)
+    {
+        return bFalse;
+    }
+
+    // Calls still running (exit(), error...) end now
+    unsigned long long now = profile_now();
+
+    while (profile->frames_count > 1)
+    {
+        profile_pop(profile, now);
+    }
+
+    unsigned long long elapsed = now - profile->frames[0].start;
+    profile->nodes[0].self = elapsed > profile->frames[0].children ? elapsed - profile->frames[0].children : 0;
+
+    if (report)
+    {
+        profile_report(profile, report, elapsed);
+    }
+
+    if (collapsed)
+    {
+        profile_collapsed(profile, collapsed);
+    }
+
+    return bTrue;
+}
@@ -17,14 +17,6 @@
 
 #include <SOARE/SOARE.h>
 
-/* Stored tree */
-ast_t ROOT = NULL;
-
-/* Break */
-static boolean_t scope_broken = bFalse;
-/* Return */
-static boolean_t scope_returned = bFalse;
-
 ////////////////////////////////////////////////////////////
 static inline char *exit_scope(char *returns)
 {
@@ -33,95 +25,126 @@ static inline char *exit_scope(char *returns)
 }
 
 ////////////////////////////////////////////////////////////
-static inline void *exit_scope_error(soare_exceptions_t error, char *string, document_t file)
+static inline boolean_t is_true_str(const char *str)
 {
-    soare_leave_exception(error, string, file);
-    soare_clear_scope();
-    return NULL;
+    return str && *str && strcmp(str, "0");
 }
 
 ////////////////////////////////////////////////////////////
-static inline boolean_t is_true_str(const char *str)
+static inline boolean_t step(soare_state_t *state, document_t file)
 {
-    return str && *str && strcmp(str, "0");
+    // Counted on each iteration and call, checked once per slice
+    return ++state->steps < state->steps_next || soare_state_slice(state, file);
 }
 
 ////////////////////////////////////////////////////////////
 static char *runtime(ast_t tree);
 
 ////////////////////////////////////////////////////////////
-static void loadimport(char *filename)
+static char *statements(ast_t current);
+
+////////////////////////////////////////////////////////////
+static char *execute(soare_closure_t *statement);
+
+////////////////////////////////////////////////////////////
+static char *evaluate(ast_t tree)
 {
-    FILE *file = fopen(filename, "rb");
+    soare_state_t *state = soare_state_current();
 
-    if (!file)
+    if (!state->closure_mode)
     {
-        soare_leave_exception(FileError, filename, soare_empty_document());
-        return;
+        return soare_math(tree);
     }
 
-    if (fseek(file, 0, SEEK_END) != 0)
-    {
-        fclose(file);
-        soare_leave_exception(FileError, filename, soare_empty_document());
-        return;
-    }
+    soare_closure_t *closure = soare_math_compile(tree);
+    return closure ? closure->eval(closure) : NULL;
+}
 
-    long size = ftell(file);
+////////////////////////////////////////////////////////////
+static boolean_t hold(soare_module_t *module)
+{
+    // The state owns the reference until it is freed
+    soare_state_t *state = soare_state_current();
 
-    if (size <= 0)
+    if (state->modules_count == state->modules_size)
     {
-        fclose(file);
-        soare_leave_exception(FileError, filename, soare_empty_document());
-        return;
+        unsigned long size = state->modules_size ? state->modules_size * 2 : 8;
+        soare_module_t **modules = (soare_module_t **)realloc(state->modules, size * sizeof(soare_module_t *));
+
+        if (!modules)
+        {
+            soare_module_release(module);
+            SOARE_OUT_OF_MEMORY();
+            return bFalse;
+        }
+
+        state->modules = modules;
+        state->modules_size = size;
     }
 
-    rewind(file);
+    state->modules[state->modules_count++] = module;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void loadimport(char *filename)
+{
+    soare_state_t *state = soare_state_current();
+    soare_trace_t *trace = state->trace;
 
-    char *content = (char *)malloc((size_t)size + 1);
+    SOARE_STATS_ADD(state, imports, 1);
 
-    if (!content)
+    if (trace)
     {
-        fclose(file);
-        SOARE_OUT_OF_MEMORY();
-        return;
+        soare_trace_begin(trace, "import", filename);
     }
 
-    size_t read = fread(content, 1, (size_t)size, file);
-    fclose(file);
+    // Parsed once per process, shared by all states
+    soare_module_t *module = soare_module_load(filename);
 
-    if (read != (size_t)size)
+    if (module && hold(module))
     {
-        free(content);
-        soare_leave_exception(FileError, filename, soare_empty_document());
-        return;
+        soare_down_scope();
+        free(runtime(module->tree));
+        soare_up_scope();
     }
 
-    content[read] = 0;
-
-    tokens_t *tokens = soare_tokenizer(filename, content);
-    free(content);
-    ast_t ast = soare_parser(tokens);
-    soare_tokens_free(tokens);
-    soare_tree_juxtapose(ROOT, ast);
-
-    soare_down_scope();
-    free(runtime(ast));
-    soare_up_scope();
+    if (trace)
+    {
+        soare_trace_end(trace);
+    }
 }
 
 ////////////////////////////////////////////////////////////
-char *soare_run_function(ast_t tree)
+static char *call(ast_t tree, boolean_t suspended)
 {
-    soare_variables_t *get = soare_get_variable(tree->value);
+    soare_state_t *state = soare_state_current();
+
+    soare_variables_t *get = soare_get_variable_cached(tree);
 
     if (!get)
     {
         soare_functions_t *function = soare_get_function(tree->value);
 
+        if (function && suspended)
+        {
+            // Native functions have no body to suspend
+            soare_leave_exception(ObjectIsNotCallable, tree->value, tree->file);
+            return NULL;
+        }
+
         if (function)
         {
-            return function->exec(tree->child);
+            // CALL_NATIVE: skip the lookups until the function is shadowed
+            if (!tree->shared)
+            {
+                tree->type = NODE_CALL_NATIVE;
+                tree->cache = function;
+                tree->epoch = soare_functions_epoch();
+            }
+
+            SOARE_STATS_ADD(state, native_calls, 1);
+            return state->profile || state->sampler || state->lines || state->trace ? soare_profile_native(function, tree->child) : function->exec(tree->child);
         }
 
         soare_leave_exception(UndefinedReference, tree->value, tree->file);
@@ -134,18 +157,88 @@ char *soare_run_function(ast_t tree)
         return NULL;
     }
 
+    if (!step(state, tree->file))
+    {
+        return NULL;
+    }
+
+    if (soare_generator_overflow())
+    {
+        // Too deep for the stack of the running generator
+        soare_leave_exception(MemoryError, "OUT OF STACK", tree->file);
+        return NULL;
+    }
+
     ast_t def = get->body->child;
     ast_t arg = tree->child;
 
+    soare_variables_t *mark = soare_last_variable();
     soare_up_scope();
 
     while (def)
     {
+        if (def->type == NODE_GENERATOR || (suspended && def->type == NODE_BODY))
+        {
+            // The arguments become the frame of the generator
+            soare_down_scope();
+            return soare_generator_new(def, mark, tree->file);
+        }
+
         if (def->type == NODE_BODY)
         {
             soare_down_scope();
-            char *returned = runtime(def);
-            scope_returned = bFalse;
+            char *returned = NULL;
+
+            SOARE_STATS_ADD(state, calls, 1);
+
+            soare_profile_t *profile = state->profile;
+            soare_sampler_t *sampler = state->sampler;
+            soare_lines_t *lines = state->lines;
+            soare_trace_t *trace = state->trace;
+
+            unsigned long depth = profile ? soare_profile_enter(profile, get->body, get->body->value, &get->body->file) : 0;
+            unsigned long sampled = sampler ? soare_sampler_enter(sampler, get->body->value, &get->body->file) : 0;
+            unsigned long caller = lines ? soare_lines_enter(lines) : 0;
+
+            if (trace)
+            {
+                soare_trace_begin(trace, "call", get->body->value);
+            }
+
+            if (soare_jit_function(get->body, &returned))
+            {
+                // Release the parameters as runtime() does
+                soare_up_scope();
+                soare_clear_scope();
+            }
+            else
+            {
+                returned = runtime(def);
+            }
+
+            if (profile)
+            {
+                soare_profile_leave(profile, depth);
+            }
+
+            if (sampler)
+            {
+                soare_sampler_leave(sampler, sampled);
+            }
+
+            if (lines)
+            {
+                soare_lines_leave(lines, caller);
+            }
+
+            if (trace)
+            {
+                soare_trace_end(trace);
+            }
+
+            // A function cannot break or return its caller
+            state->broken = bFalse;
+            state->returned = bFalse;
             return returned;
         }
 
@@ -156,7 +249,7 @@ char *soare_run_function(ast_t tree)
             return NULL;
         }
 
-        char *param = soare_math(arg);
+        char *param = evaluate(arg);
         soare_add_variable(def->value, param, bTrue);
         free(param);
 
@@ -170,39 +263,289 @@ char *soare_run_function(ast_t tree)
 }
 
 ////////////////////////////////////////////////////////////
-static char *runtime(ast_t tree)
+char *soare_run_function(ast_t tree)
 {
-    if (!tree)
+    return call(tree, bFalse);
+}
+
+////////////////////////////////////////////////////////////
+char *soare_generator_call(ast_t tree)
+{
+    return call(tree, bTrue);
+}
+
+////////////////////////////////////////////////////////////
+char *soare_run_body(ast_t body)
+{
+    soare_state_t *state = soare_state_current();
+
+    // Parameters are registered one level above
+    soare_down_scope();
+    char *returned = runtime(body);
+
+    state->broken = bFalse;
+    state->returned = bFalse;
+    return returned;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t declares_variables(ast_t body)
+{
+    // Nested bodies open their own scope: only the direct
+    // statements can declare variables in the loop scope
+    for (ast_t statement = body->child; statement; statement = statement->sibling)
+    {
+        switch (statement->type)
+        {
+        case NODE_MEMNEW:
+        case NODE_FUNCTION:
+        case NODE_IMPORT:
+            return bTrue;
+
+        default:
+            break;
+        }
+    }
+
+    return bFalse;
+}
+
+////////////////////////////////////////////////////////////
+static char *repetition(ast_t loop)
+{
+    /**
+     *
+     * The body is analysed once, before the first iteration:
+     *
+     * - Without declarations, it runs in the current scope
+     * - Otherwise, a single scope frame is opened and reset
+     *   after each iteration instead of being rebuilt
+     *
+     * Variables registered by native functions (`def`) are
+     * removed at the end of each iteration in both cases
+     *
+     */
+
+    soare_state_t *state = soare_state_current();
+
+    ast_t condition = loop->child;
+    ast_t body = condition->sibling;
+
+    boolean_t frame = declares_variables(body);
+
+    if (frame)
+    {
+        soare_up_scope();
+    }
+
+    soare_variables_t *mark = soare_last_variable();
+    char *value = NULL;
+    unsigned int iterations = 0;
+
+    while (!soare_errorlevel() && soare_math_truth(condition) && step(state, loop->file))
+    {
+        if (++iterations == SOARE_JIT_HOT_LOOP && soare_jit_enabled() && soare_jit_loop(loop))
+        {
+            // Remaining iterations run by the compiled loop
+            break;
+        }
+
+        state->broken = bFalse;
+        state->returned = bFalse;
+
+        value = statements(body->child);
+        soare_reset_scope(mark);
+
+        if (value || state->broken || state->returned || soare_errorlevel())
+        {
+            break;
+        }
+    }
+
+    if (frame)
+    {
+        soare_down_scope();
+    }
+
+    // Break only leaves the current loop
+    state->broken = bFalse;
+    return value;
+}
+
+////////////////////////////////////////////////////////////
+static char *iteration(ast_t loop, char *handle, soare_closure_t *body)
+{
+    /**
+     *
+     * while <varname> in <generator>
+     *
+     * The variable is declared in the scope frame of the loop and
+     * receives each yielded value. A generator created by the loop
+     * itself (a call) cannot be resumed by anything else: it is
+     * closed if the loop ends first
+     *
+     */
+
+    soare_state_t *state = soare_state_current();
+
+    ast_t iterator = loop->child;
+
+    if (!handle)
     {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(ValueError, loop->value, loop->file);
+        }
+
         return NULL;
     }
 
+    soare_variables_t *outside = soare_last_variable();
     soare_up_scope();
 
-    scope_broken = bFalse;
-    scope_returned = bFalse;
+    soare_variables_t *item = soare_add_variable(loop->value, NULL, bTrue);
+    char *value = NULL;
+    char *yielded = NULL;
+
+    boolean_t finished = bFalse;
+
+    while (item && !soare_errorlevel() && step(state, loop->file))
+    {
+        if (!soare_generator_next(handle, &yielded, loop->file))
+        {
+            // Value returned by the generator
+            free(yielded);
+            finished = bTrue;
+            break;
+        }
+
+        if (!soare_set_value(item, yielded))
+        {
+            break;
+        }
+
+        state->broken = bFalse;
+        state->returned = bFalse;
+
+        value = body ? execute(body->x) : statements(iterator->sibling->child);
+        soare_reset_scope(item);
+
+        if (value || state->broken || state->returned || soare_errorlevel())
+        {
+            break;
+        }
+    }
+
+    if (!finished && (iterator->type == NODE_CALL || iterator->type == NODE_CALL_NATIVE))
+    {
+        boolean_t broken = state->broken;
+        boolean_t returned = state->returned;
+
+        soare_generator_close(handle);
+
+        state->broken = broken;
+        state->returned = returned;
+    }
+
+    free(handle);
+
+    soare_reset_scope(outside);
+    soare_down_scope();
+
+    // Break only leaves the current loop
+    state->broken = bFalse;
+    return value;
+}
+
+////////////////////////////////////////////////////////////
+static void declare_function(ast_t current)
+{
+    soare_variables_t *fn = soare_add_variable(current->value, NULL, bFalse);
+
+    if (fn)
+    {
+        fn->body = current;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void custom_keyword(ast_t current)
+{
+    soare_keywords_t *keyword = soare_get_keyword(current->value);
+
+    if (keyword)
+    {
+        keyword->exec();
+    }
+}
+
+////////////////////////////////////////////////////////////
+static soare_variables_t *assignable(ast_t current)
+{
+    soare_variables_t *get = soare_get_variable_cached(current);
+
+    if (!get)
+    {
+        soare_leave_exception(UndefinedReference, current->value, current->file);
+        return NULL;
+    }
+
+    if (get->body)
+    {
+        soare_leave_exception(VariableDefinedAsFunction, current->value, current->file);
+        return NULL;
+    }
+
+    if (!get->mutable)
+    {
+        soare_leave_exception(AssignConstantVariable, current->value, current->file);
+        return NULL;
+    }
+
+    return get;
+}
 
-    ast_t current = tree->child;
+////////////////////////////////////////////////////////////
+static char *statements(ast_t current)
+{
+    soare_state_t *state = soare_state_current();
 
     while (current && !soare_errorlevel())
     {
+        SOARE_STATS_ADD(state, statements, 1);
+
+        if (state->sampler)
+        {
+            soare_sampler_line(state->sampler, &current->file);
+        }
+
+        if (state->lines)
+        {
+            soare_lines_statement(state->lines, &current->file);
+        }
+
+#ifdef __SOARE_TRACK_ALLOCATIONS
+        soare_track_line(&current->file);
+#endif /* __SOARE_TRACK_ALLOCATIONS */
+
         switch (current->type)
         {
         case NODE_RAISE:
         {
-            return exit_scope_error(RaiseException, current->value, current->file);
+            soare_leave_exception(RaiseException, current->value, current->file);
+            return NULL;
         }
 
         case NODE_BREAK:
         {
-            scope_broken = bTrue;
-            return exit_scope(NULL);
+            state->broken = bTrue;
+            return NULL;
         }
 
         case NODE_RETURN:
         {
-            scope_returned = bTrue;
-            return exit_scope(soare_math(current->child));
+            state->returned = bTrue;
+            return soare_math(current->child);
         }
 
         case NODE_IMPORT:
@@ -227,49 +570,28 @@ static char *runtime(ast_t tree)
 
         case NODE_FUNCTION:
         {
-            soare_variables_t *fn = soare_add_variable(current->value, NULL, bFalse);
-
-            if (fn)
-            {
-                fn->body = current;
-            }
-
+            declare_function(current);
             break;
         }
 
         case NODE_MEMSET:
         {
-            soare_variables_t *get = soare_get_variable(current->value);
+            soare_variables_t *get = assignable(current);
 
             if (!get)
             {
-                return exit_scope_error(UndefinedReference, current->value, current->file);
+                return NULL;
             }
 
-            if (get->body)
-            {
-                return exit_scope_error(VariableDefinedAsFunction, current->value, current->file);
-            }
-
-            if (!get->mutable)
-            {
-                return exit_scope_error(AssignConstantVariable, current->value, current->file);
-            }
-
-            free(get->value);
-            get->value = soare_math(current->child);
+            // The new value may depend on the old one
+            // The new value may depend on the old one
+            soare_set_value(get, soare_math(current->child));
             break;
         }
 
         case NODE_CUSTOM_KEYWORD:
         {
-            soare_keywords_t *keyword = soare_get_keyword(current->value);
-
-            if (keyword)
-            {
-                keyword->exec();
-            }
-
+            custom_keyword(current);
             break;
         }
 
@@ -285,9 +607,9 @@ static char *runtime(ast_t tree)
                     free(condition);
                     char *value = runtime(tmp->sibling);
 
-                    if (value || scope_broken || scope_returned)
+                    if (value || state->broken || state->returned)
                     {
-                        return exit_scope(value);
+                        return value;
                     }
 
                     break;
@@ -306,25 +628,25 @@ static char *runtime(ast_t tree)
             break;
         }
 
-        case NODE_REPETITION:
+        case NODE_YIELD:
         {
-            char *condition = soare_math(current->child);
-
-            while (condition && is_true_str(condition) && !soare_errorlevel() && !scope_broken && !scope_returned)
+            if (!soare_generator_yield(soare_math(current->child)))
             {
-                free(condition);
+                return NULL;
+            }
 
-                char *value = runtime(current->child->sibling);
+            break;
+        }
 
-                if (value)
-                {
-                    return exit_scope(value);
-                }
+        case NODE_REPETITION:
+        {
+            char *value = current->value ? iteration(current, soare_math(current->child), NULL) : repetition(current);
 
-                condition = soare_math(current->child);
+            if (value || state->returned)
+            {
+                return value;
             }
 
-            free(condition);
             break;
         }
 
@@ -335,16 +657,17 @@ static char *runtime(ast_t tree)
             char *value = runtime(current->child);
             soare_ignore_exception(previous);
 
-            if (soare_errorlevel() && !scope_broken && !scope_returned)
+            if (soare_errorlevel() && !state->broken && !state->returned)
             {
+                SOARE_STATS_ADD(state, caught, 1);
                 free(value);
                 soare_clear_exception();
                 value = runtime(current->child->sibling);
             }
 
-            if (value || scope_broken || scope_returned)
+            if (value || state->broken || state->returned)
             {
-                return exit_scope(value);
+                return value;
             }
 
             break;
@@ -359,37 +682,605 @@ static char *runtime(ast_t tree)
         current = current->sibling;
     }
 
-    return exit_scope(NULL);
+    return NULL;
 }
 
 ////////////////////////////////////////////////////////////
-void soare_kill(void)
+static char *execute(soare_closure_t *statement)
 {
-    soare_tree_free(ROOT);
+    soare_state_t *state = soare_state_current();
 
-    soare_clear_keywords();
-    soare_clear_functions();
-    soare_clear_variables();
-    soare_clear_exception();
+    while (statement && !soare_errorlevel())
+    {
+        SOARE_STATS_ADD(state, statements, 1);
 
-    ROOT = NULL;
-}
+        if (state->sampler)
+        {
+            soare_sampler_line(state->sampler, &statement->node->file);
+        }
 
-////////////////////////////////////////////////////////////
-char *soare_execute(char *__restrict__ filename, char *__restrict__ rawcode)
-{
-    // Clear interpreter exception
-    soare_clear_exception();
+        if (state->lines)
+        {
+            soare_lines_statement(state->lines, &statement->node->file);
+        }
 
-    // Interpretation step 1: Tokenizer
-    tokens_t *tokens = soare_tokenizer(filename, rawcode);
+#ifdef __SOARE_TRACK_ALLOCATIONS
+        soare_track_line(&statement->node->file);
+#endif /* __SOARE_TRACK_ALLOCATIONS */
+
+        char *value = statement->exec(statement);
+
+        if (value || state->broken || state->returned)
+        {
+            return value;
+        }
+
+        statement = statement->next;
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *enter(soare_closure_t *body)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (!body)
+    {
+        return NULL;
+    }
+
+    soare_up_scope();
+
+    state->broken = bFalse;
+    state->returned = bFalse;
+
+    return exit_scope(execute(body->x));
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_raise(soare_closure_t *self)
+{
+    soare_leave_exception(RaiseException, self->node->value, self->node->file);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_break(soare_closure_t *self)
+{
+    (void)self;
+    soare_state_current()->broken = bTrue;
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_return(soare_closure_t *self)
+{
+    soare_state_current()->returned = bTrue;
+    return self->x ? self->x->eval(self->x) : NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_yield(soare_closure_t *self)
+{
+    soare_generator_yield(self->x ? self->x->eval(self->x) : NULL);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_import(soare_closure_t *self)
+{
+    loadimport(self->node->value);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_strerror(soare_closure_t *self)
+{
+    soare_add_variable(self->node->value, soare_get_exception(), bFalse);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_memnew(soare_closure_t *self)
+{
+    char *content = self->x ? self->x->eval(self->x) : NULL;
+    soare_add_variable(self->node->value, content, bTrue);
+    free(content);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_function(soare_closure_t *self)
+{
+    declare_function(self->node);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_memset(soare_closure_t *self)
+{
+    soare_variables_t *get = assignable(self->node);
+
+    if (!get)
+    {
+        return NULL;
+    }
+
+    // The new value may depend on the old one
+    // The new value may depend on the old one
+    soare_set_value(get, self->x ? self->x->eval(self->x) : NULL);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_keyword(soare_closure_t *self)
+{
+    custom_keyword(self->node);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_condition(soare_closure_t *self)
+{
+    // Branches are bodies guarded by their condition (y)
+    for (soare_closure_t *branch = self->x; branch; branch = branch->next)
+    {
+        int truth = branch->y->truth(branch->y);
+
+        if (truth < 0)
+        {
+            break;
+        }
+
+        if (truth)
+        {
+            return enter(branch);
+        }
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_repetition(soare_closure_t *self)
+{
+    soare_state_t *state = soare_state_current();
+
+    // Same strategy as repetition()
+    soare_closure_t *condition = self->x;
+    soare_closure_t *body = self->y;
+
+    if (body->scope)
+    {
+        soare_up_scope();
+    }
+
+    soare_variables_t *mark = soare_last_variable();
+    char *value = NULL;
+    unsigned int iterations = 0;
+
+    while (!soare_errorlevel() && condition->truth(condition) > 0 && step(state, self->node->file))
+    {
+        if (++iterations == SOARE_JIT_HOT_LOOP && soare_jit_enabled() && soare_jit_loop(self->node))
+        {
+            break;
+        }
+
+        state->broken = bFalse;
+        state->returned = bFalse;
+
+        value = execute(body->x);
+        soare_reset_scope(mark);
+
+        if (value || state->broken || state->returned || soare_errorlevel())
+        {
+            break;
+        }
+    }
+
+    if (body->scope)
+    {
+        soare_down_scope();
+    }
+
+    // Break only leaves the current loop
+    state->broken = bFalse;
+    return value;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_iteration(soare_closure_t *self)
+{
+    return iteration(self->node, self->x->eval(self->x), self->y);
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_try(soare_closure_t *self)
+{
+    soare_state_t *state = soare_state_current();
+
+    boolean_t previous = soare_as_ignored_exception();
+    soare_ignore_exception(bTrue);
+    char *value = enter(self->x);
+    soare_ignore_exception(previous);
+
+    if (soare_errorlevel() && !state->broken && !state->returned)
+    {
+        SOARE_STATS_ADD(state, caught, 1);
+        free(value);
+        soare_clear_exception();
+        value = enter(self->y);
+    }
+
+    return value;
+}
+
+////////////////////////////////////////////////////////////
+static char *closure_expression(soare_closure_t *self)
+{
+    free(self->eval(self));
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static soare_closure_t *compile_body(ast_t body);
+
+////////////////////////////////////////////////////////////
+static soare_closure_t *compile_statement(ast_t statement)
+{
+    if (statement->closure && statement->closure->exec)
+    {
+        return statement->closure;
+    }
+
+    char *(*exec)(soare_closure_t *) = NULL;
+
+    switch (statement->type)
+    {
+    case NODE_RAISE:
+        exec = closure_raise;
+        break;
+
+    case NODE_BREAK:
+        exec = closure_break;
+        break;
+
+    case NODE_RETURN:
+        exec = closure_return;
+        break;
+
+    case NODE_YIELD:
+        exec = closure_yield;
+        break;
+
+    case NODE_IMPORT:
+        exec = closure_import;
+        break;
+
+    case NODE_STRERROR:
+        exec = closure_strerror;
+        break;
+
+    case NODE_MEMNEW:
+        exec = closure_memnew;
+        break;
+
+    case NODE_FUNCTION:
+        exec = closure_function;
+        break;
+
+    case NODE_MEMSET:
+        exec = closure_memset;
+        break;
+
+    case NODE_CUSTOM_KEYWORD:
+        exec = closure_keyword;
+        break;
+
+    case NODE_CONDITION:
+        exec = closure_condition;
+        break;
+
+    case NODE_REPETITION:
+        exec = statement->value ? closure_iteration : closure_repetition;
+        break;
+
+    case NODE_TRY:
+        exec = closure_try;
+        break;
+
+    default:
+    {
+        // Expression statement: its result is discarded
+        soare_closure_t *expression = soare_math_compile(statement);
+
+        if (expression)
+        {
+            expression->exec = closure_expression;
+        }
+
+        return expression;
+    }
+    }
+
+    // Reuse the closure left by a failed compilation
+    soare_closure_t *closure = statement->closure;
+
+    if (!closure && !(closure = (soare_closure_t *)calloc(1, sizeof(soare_closure_t))))
+    {
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    closure->node = statement;
+    statement->closure = closure;
+
+    // Operands are resolved once, before the first execution
+    ast_t child = statement->child;
+    boolean_t compiled = bTrue;
+
+    switch (statement->type)
+    {
+    case NODE_RETURN:
+    case NODE_YIELD:
+    case NODE_MEMNEW:
+    case NODE_MEMSET:
+        closure->x = soare_math_compile(child);
+        compiled = !child || closure->x;
+        break;
+
+    case NODE_CONDITION:
+    {
+        soare_closure_t **link = &closure->x;
+
+        for (ast_t guard = child; guard && guard->sibling && compiled; guard = guard->sibling->sibling)
+        {
+            soare_closure_t *branch = compile_body(guard->sibling);
+
+            if (!branch || !(branch->y = soare_math_compile(guard)))
+            {
+                compiled = bFalse;
+                break;
+            }
+
+            *link = branch;
+            link = &branch->next;
+        }
+
+        break;
+    }
+
+    case NODE_REPETITION:
+        closure->x = soare_math_compile(child);
+        closure->y = compile_body(child->sibling);
+        compiled = closure->x && closure->y;
+        break;
+
+    case NODE_TRY:
+        closure->x = compile_body(child);
+        closure->y = child->sibling ? compile_body(child->sibling) : NULL;
+        compiled = closure->x && (!child->sibling || closure->y);
+        break;
+
+    default:
+        break;
+    }
+
+    if (!compiled)
+    {
+        // Out of memory, the closure is freed with the tree
+        return NULL;
+    }
+
+    closure->exec = exec;
+    return closure;
+}
+
+////////////////////////////////////////////////////////////
+static soare_closure_t *compile_body(ast_t body)
+{
+    /**
+     *
+     * Compile a body into a linked list of statement closures
+     *
+     * Nested bodies (conditions, loops, try) are compiled with their
+     * parent, functions and imports on their first execution
+     *
+     */
+
+    if (body->closure)
+    {
+        return body->closure;
+    }
+
+    soare_closure_t *closure = (soare_closure_t *)calloc(1, sizeof(soare_closure_t));
+
+    if (!closure)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    closure->node = body;
+    closure->scope = declares_variables(body);
+
+    soare_closure_t **link = &closure->x;
+
+    for (ast_t statement = body->child; statement; statement = statement->sibling)
+    {
+        soare_closure_t *compiled = compile_statement(statement);
+
+        if (!compiled)
+        {
+            free(closure);
+            return NULL;
+        }
+
+        *link = compiled;
+        link = &compiled->next;
+    }
+
+    body->closure = closure;
+    return closure;
+}
+
+////////////////////////////////////////////////////////////
+static char *runtime(ast_t tree)
+{
+    soare_state_t *state = soare_state_current();
+
+    if (!tree)
+    {
+        return NULL;
+    }
+
+    if (state->closure_mode)
+    {
+        return enter(compile_body(tree));
+    }
+
+    soare_up_scope();
+
+    state->broken = bFalse;
+    state->returned = bFalse;
+
+    return exit_scope(statements(tree->child));
+}
+
+////////////////////////////////////////////////////////////
+void soare_closure_mode(boolean_t enabled)
+{
+    soare_state_current()->closure_mode = enabled;
+}
+
+////////////////////////////////////////////////////////////
+static void compile_tree(ast_t tree)
+{
+    for (ast_t child = tree->child; child; child = child->sibling)
+    {
+        // Function bodies and call arguments
+        if (tree->type == NODE_FUNCTION && (child->type == NODE_BODY || child->type == NODE_GENERATOR))
+        {
+            compile_body(child);
+        }
+
+        if (tree->type == NODE_CALL)
+        {
+            soare_math_compile(child);
+        }
+
+        compile_tree(child);
+    }
+}
+
+////////////////////////////////////////////////////////////
+void soare_closure_compile(ast_t tree)
+{
+    // A root is itself a body
+    if (tree && (tree->type != NODE_ROOT || compile_body(tree)))
+    {
+        compile_tree(tree);
+    }
+}
+
+////////////////////////////////////////////////////////////
+void soare_share_functions(void)
+{
+    for (soare_variables_t *var = soare_last_variable(); var; var = var->prev)
+    {
+        if (var->body && !var->body->shared)
+        {
+            soare_closure_compile(var->body);
+            soare_math_freeze(var->body->child);
+            var->body->shared = bTrue;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+char *soare_module_attach(soare_module_t *module)
+{
+    if (!module || !hold(soare_module_retain(module)))
+    {
+        return NULL;
+    }
+
+    soare_trace_t *trace = soare_state_current()->trace;
+
+    if (!trace)
+    {
+        return runtime(module->tree);
+    }
+
+    soare_trace_begin(trace, "execute", module->filename);
+    char *value = runtime(module->tree);
+    soare_trace_end(trace);
+
+    return value;
+}
+
+////////////////////////////////////////////////////////////
+void soare_kill(void)
+{
+    soare_state_t *state = soare_state_current();
+
+    // Work started by the state may still use its trees
+    soare_state_release(state);
+    soare_generator_clear(0);
+    soare_profile_stop(state);
+    soare_sampler_stop(state);
+    soare_lines_stop(state);
+    soare_trace_stop(state);
+
+    // Compiled code is indexed by node: drop it before the nodes
+    soare_jit_clear();
+    soare_tree_free(state->root);
+
+    soare_clear_keywords();
+    soare_clear_functions();
+    soare_clear_variables();
+    soare_clear_exception();
+
+    while (state->modules_count)
+    {
+        soare_module_release(state->modules[--state->modules_count]);
+    }
+
+    free(state->modules);
+
+    state->root = NULL;
+    state->modules = NULL;
+    state->modules_size = 0;
+}
+
+////////////////////////////////////////////////////////////
+char *soare_execute(char *__restrict__ filename, char *__restrict__ rawcode)
+{
+    soare_state_t *state = soare_state_current();
+
+    // Clear interpreter exception
+    soare_clear_exception();
+
+    // Interpretation step 1: Tokenizer
+    tokens_t *tokens = soare_tokenizer(filename, rawcode);
     // Interpretation step 2: Parser
     ast_t ast = soare_parser(tokens);
     // Free tokens
     soare_tokens_free(tokens);
     // Save ast
-    ROOT = soare_tree_juxtapose(ROOT, ast);
+    state->root = soare_tree_juxtapose(state->root, ast);
+
+    if (!state->trace)
+    {
+        // Interpretation step 3: runtime
+        return runtime(ast);
+    }
+
+    soare_trace_begin(state->trace, "execute", filename);
+    char *value = runtime(ast);
+    soare_trace_end(state->trace);
 
-    // Interpretation step 3: runtime
-    return runtime(ast);
+    return value;
 }
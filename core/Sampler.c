@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/time.h>
+#endif /* _WIN32 */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Sampler.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#include <SOARE/SOARE.h>
+
+/**
+ *
+ * The interpreter pushes each call on a shadow stack allocated once,
+ * and notes the running statement. The signal handler copies them
+ * into a ring buffer: it never allocates nor locks, and is the only
+ * writer of the ring. The interpreter is the only reader: it counts
+ * the samples in a table of call paths once the ring is half full,
+ * and when the samples are written
+ *
+ */
+
+/* Calls kept by the shadow stack (deeper calls are not sampled) */
+#define SAMPLER_STACK 1024
+/* Innermost calls kept by a sample */
+#define SAMPLER_DEPTH 48
+/* Samples in the ring buffer (power of two) */
+#define SAMPLER_RING 512
+/* Initial number of hash buckets (power of two) */
+#define SAMPLER_BUCKETS 256
+
+/**
+ * @brief Call on the shadow stack
+ */
+typedef struct sampler_frame
+{
+
+    const char *name;       /**< Name of the function         */
+    const document_t *file; /**< Definition, or NULL (native) */
+
+} sampler_frame_t;
+
+/**
+ * @brief Sample written by the signal handler
+ */
+typedef struct sampler_sample
+{
+
+    unsigned long depth;                   /**< Frames kept            */
+    boolean_t truncated;                   /**< Outer frames dropped   */
+    const document_t *line;                /**< Running statement      */
+    sampler_frame_t frames[SAMPLER_DEPTH]; /**< Calls, outermost first */
+
+} sampler_sample_t;
+
+/**
+ * @brief Call path and its number of samples
+ */
+typedef struct sampler_path
+{
+
+    char *label;               /**< Collapsed stack        */
+    unsigned long long count;  /**< Number of samples      */
+    struct sampler_path *next; /**< Next path of the bucket */
+
+} sampler_path_t;
+
+/**
+ * @brief Sampling profiler of a state
+ */
+struct soare_sampler
+{
+
+    sampler_frame_t stack[SAMPLER_STACK]; /**< Shadow stack                  */
+    volatile unsigned long depth;         /**< Running calls                 */
+    const document_t *volatile line;      /**< Running statement             */
+    sampler_sample_t ring[SAMPLER_RING];  /**< Samples not counted yet       */
+    volatile unsigned long head;          /**< Written by the handler        */
+    volatile unsigned long tail;          /**< Read by the interpreter       */
+    unsigned long long dropped;           /**< Samples lost (ring full)      */
+    sampler_path_t **paths;               /**< Counted samples, by path      */
+    unsigned long paths_size;             /**< Number of buckets             */
+    unsigned long paths_count;            /**< Number of paths               */
+    unsigned long long samples;           /**< Counted samples               */
+
+};
+
+////////////////////////////////////////////////////////////
+static soare_state_t *sampler_state(soare_state_t *state)
+{
+    if (state)
+    {
+        return state;
+    }
+
+    // NULL selects the default state
+    soare_state_t *previous = soare_state_select(NULL);
+    state = soare_state_current();
+    soare_state_select(previous);
+
+    return state;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long sampler_hash(const char *label)
+{
+    unsigned long hash = 5381;
+
+    while (*label)
+    {
+        hash = hash * 33 ^ (unsigned char)*label++;
+    }
+
+    return hash;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t sampler_grow(soare_sampler_t *sampler)
+{
+    unsigned long size = sampler->paths_size ? sampler->paths_size * 2 : SAMPLER_BUCKETS;
+    sampler_path_t **paths = (sampler_path_t **)calloc(size, sizeof(sampler_path_t *));
+
+    if (!paths)
+    {
+        return bFalse;
+    }
+
+    for (unsigned long i = 0; i < sampler->paths_size; i++)
+    {
+        sampler_path_t *path = sampler->paths[i];
+
+        while (path)
+        {
+            sampler_path_t *next = path->next;
+            unsigned long bucket = sampler_hash(path->label) & (size - 1);
+
+            path->next = paths[bucket];
+            paths[bucket] = path;
+            path = next;
+        }
+    }
+
+    free(sampler->paths);
+    sampler->paths = paths;
+    sampler->paths_size = size;
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void sampler_count(soare_sampler_t *sampler, const char *label)
+{
+    unsigned long hash = sampler_hash(label);
+
+    for (sampler_path_t *path = sampler->paths[hash & (sampler->paths_size - 1)]; path; path = path->next)
+    {
+        if (!strcmp(path->label, label))
+        {
+            path->count++;
+            return;
+        }
+    }
+
+    if (sampler->paths_count >= sampler->paths_size && !sampler_grow(sampler))
+    {
+        return;
+    }
+
+    sampler_path_t *path = (sampler_path_t *)malloc(sizeof(sampler_path_t));
+
+    if (!path || !(path->label = strdup(label)))
+    {
+        free(path);
+        return;
+    }
+
+    unsigned long bucket = hash & (sampler->paths_size - 1);
+
+    path->count = 1;
+    path->next = sampler->paths[bucket];
+    sampler->paths[bucket] = path;
+    sampler->paths_count++;
+}
+
+////////////////////////////////////////////////////////////
+static void sampler_label(char *label, size_t size, const sampler_sample_t *sample)
+{
+    size_t length = (size_t)snprintf(label, size, "<main>%s", sample->truncated ? ";..." : "");
+
+    for (unsigned long i = 0; i < sample->depth && length < size; i++)
+    {
+        const sampler_frame_t *frame = &sample->frames[i];
+
+        if (frame->file && frame->file->filename)
+        {
+            length += (size_t)snprintf(label + length, size - length, ";%s (%s:%llu:%llu)", frame->name, frame->file->filename, frame->file->ln, frame->file->col);
+            continue;
+        }
+
+        length += (size_t)snprintf(label + length, size - length, ";%s", frame->name);
+    }
+
+    if (sample->line && sample->line->filename && length < size)
+    {
+        snprintf(label + length, size - length, ";%s:%llu", sample->line->filename, sample->line->ln);
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void sampler_drain(soare_sampler_t *sampler)
+{
+    // The handler only moves the head
+    static char label[SAMPLER_DEPTH * 160];
+
+    while (sampler->tail != sampler->head)
+    {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        sampler_label(label, sizeof(label), &sampler->ring[sampler->tail & (SAMPLER_RING - 1)]);
+        sampler_count(sampler, label);
+
+        sampler->samples++;
+        sampler->tail++;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static inline void sampler_check(soare_sampler_t *sampler)
+{
+    if (sampler->head - sampler->tail >= SAMPLER_RING / 2)
+    {
+        sampler_drain(sampler);
+    }
+}
+
+////////////////////////////////////////////////////////////
+unsigned long soare_sampler_enter(soare_sampler_t *sampler, const char *name, const document_t *file)
+{
+    sampler_check(sampler);
+
+    unsigned long depth = sampler->depth;
+
+    if (depth < SAMPLER_STACK)
+    {
+        sampler->stack[depth].name = name;
+        sampler->stack[depth].file = file;
+    }
+
+    // The frame is complete before the handler can see it
+    __atomic_signal_fence(__ATOMIC_RELEASE);
+    sampler->depth = depth + 1;
+
+    return depth;
+}
+
+////////////////////////////////////////////////////////////
+void soare_sampler_leave(soare_sampler_t *sampler, unsigned long depth)
+{
+    // Frames of suspended tasks may already be gone
+    if (depth < sampler->depth)
+    {
+        sampler->depth = depth;
+    }
+}
+
+////////////////////////////////////////////////////////////
+void soare_sampler_line(soare_sampler_t *sampler, const document_t *line)
+{
+    sampler->line = line;
+    sampler_check(sampler);
+}
+
+#ifndef _WIN32
+
+/* Sampled state of the process */
+static soare_sampler_t *volatile sampling = NULL;
+
+////////////////////////////////////////////////////////////
+static void sampler_signal(int sig)
+{
+    (void)sig;
+    soare_sampler_t *sampler = sampling;
+
+    // Other threads run other states
+    if (!sampler || soare_state_current()->sampler != sampler)
+    {
+        return;
+    }
+
+    unsigned long head = sampler->head;
+
+    if (head - sampler->tail >= SAMPLER_RING)
+    {
+        sampler->dropped++;
+        return;
+    }
+
+    sampler_sample_t *sample = &sampler->ring[head & (SAMPLER_RING - 1)];
+
+    unsigned long depth = sampler->depth < SAMPLER_STACK ? sampler->depth : SAMPLER_STACK;
+    unsigned long first = depth > SAMPLER_DEPTH ? depth - SAMPLER_DEPTH : 0;
+
+    sample->depth = depth - first;
+    sample->truncated = (boolean_t)(first > 0);
+    sample->line = sampler->line;
+    memcpy(sample->frames, &sampler->stack[first], sample->depth * sizeof(sampler_frame_t));
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    sampler->head = head + 1;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t sampler_timer(unsigned int hz)
+{
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+
+    if (hz)
+    {
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = hz > 1000000 ? 1 : (suseconds_t)(1000000 / hz);
+        timer.it_value = timer.it_interval;
+    }
+
+    return (boolean_t)!setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_sampler_start(soare_state_t *state, unsigned int hz)
+{
+    state = sampler_state(state);
+
+    if (sampling)
+    {
+        soare_leave_exception(InterpreterError, "sampler busy", soare_empty_document());
+        return bFalse;
+    }
+
+    soare_sampler_t *sampler = (soare_sampler_t *)calloc(1, sizeof(soare_sampler_t));
+
+    if (!sampler || !sampler_grow(sampler))
+    {
+        free(sampler);
+        SOARE_OUT_OF_MEMORY();
+        return bFalse;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sampler_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    state->sampler = sampler;
+    sampling = sampler;
+
+    if (sigaction(SIGPROF, &action, NULL) || !sampler_timer(hz ? hz : SOARE_SAMPLER_HZ))
+    {
+        soare_sampler_stop(state);
+        return bFalse;
+    }
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+void soare_sampler_stop(soare_state_t *state)
+{
+    state = sampler_state(state);
+    soare_sampler_t *sampler = state->sampler;
+
+    if (!sampler)
+    {
+        return;
+    }
+
+    if (sampling == sampler)
+    {
+        // A pending signal finds nothing to sample
+        sampler_timer(0);
+        sampling = NULL;
+        signal(SIGPROF, SIG_IGN);
+    }
+
+    state->sampler = NULL;
+
+    for (unsigned long i = 0; i < sampler->paths_size; i++)
+    {
+        while (sampler->paths[i])
+        {
+            sampler_path_t *next = sampler->paths[i]->next;
+            free(sampler->paths[i]->label);
+            free(sampler->paths[i]);
+            sampler->paths[i] = next;
+        }
+    }
+
+    free(sampler->paths);
+    free(sampler);
+}
+
+#else
+
+////////////////////////////////////////////////////////////
+boolean_t soare_sampler_start(soare_state_t *state, unsigned int hz)
+{
+    (void)state;
+    (void)hz;
+
+    soare_leave_exception(InterpreterError, "not available on this platform", soare_empty_document());
+    return bFalse;
+}
+
+////////////////////////////////////////////////////////////
+void soare_sampler_stop(soare_state_t *state)
+{
+    (void)sampler_state(state);
+}
+
+#endif /* _WIN32 */
+
+////////////////////////////////////////////////////////////
+unsigned long long soare_sampler_write(soare_state_t *state, FILE *collapsed)
+{
+    soare_sampler_t *sampler = sampler_state(state)->sampler;
+
+    if (!sampler)
+    {
+        return 0;
+    }
+
+    sampler_drain(sampler);
+
+    for (unsigned long i = 0; i < sampler->paths_size; i++)
+    {
+        for (sampler_path_t *path = sampler->paths[i]; path; path = path->next)
+        {
+            fprintf(collapsed, "%s %llu\n", path->label, path->count);
+        }
+    }
+
+    return sampler->samples;
+}
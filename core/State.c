@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <State.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#include <SOARE/SOARE.h>
+
+/* Initial value of a state */
+#define STATE_INITIALIZER              \
+    {                                  \
+        .error_display = bTrue,        \
+        .error_level = EXIT_SUCCESS,   \
+        .all_statement_closed = bTrue, \
+        .functions_epoch = 1,          \
+        .variables_epoch = 1,          \
+        .steps_next = ULLONG_MAX,      \
+    }
+
+/* State used by the single-state API */
+static soare_state_t default_state = STATE_INITIALIZER;
+
+/* State selected by each thread */
+static _Thread_local soare_state_t *current = &default_state;
+
+/* Maximum number of release hooks */
+#define STATE_HOOKS 8
+
+/* Called before a state releases its trees */
+static void (*release_hooks[STATE_HOOKS])(soare_state_t *);
+static unsigned int release_hooks_count = 0;
+
+/* Called at the end of each slice of steps */
+static void (*slice_hooks[STATE_HOOKS])(soare_state_t *);
+static unsigned int slice_hooks_count = 0;
+
+////////////////////////////////////////////////////////////
+static void state_next_check(soare_state_t *state)
+{
+    state->steps_next = ULLONG_MAX;
+
+    if (state->steps_slice)
+    {
+        state->steps_next = state->steps + state->steps_slice;
+    }
+
+    if (state->steps_limit && state->steps_limit < state->steps_next)
+    {
+        // Checked once the limit is exceeded
+        state->steps_next = state->steps_limit + 1;
+    }
+}
+
+////////////////////////////////////////////////////////////
+soare_state_t *soare_state_new(void)
+{
+    soare_state_t *state = (soare_state_t *)malloc(sizeof(soare_state_t));
+
+    if (!state)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    *state = (soare_state_t)STATE_INITIALIZER;
+    return state;
+}
+
+////////////////////////////////////////////////////////////
+soare_state_t *soare_state_inherit(const soare_state_t *parent)
+{
+    soare_state_t *state = soare_state_new();
+
+    if (state && parent)
+    {
+        state->parent = parent;
+        state->closure_mode = parent->closure_mode;
+        state->jit_mode = parent->jit_mode;
+        soare_state_budget(state, parent->steps_slice, parent->steps_limit);
+        state->allocator = parent->allocator;
+        state->trace = parent->trace;
+
+        for (unsigned int category = 0; category <= SOARE_MEMORY_TOTAL; category++)
+        {
+            state->memory[category].quota = parent->memory[category].quota;
+        }
+    }
+
+    return state;
+}
+
+////////////////////////////////////////////////////////////
+void soare_state_free(soare_state_t *state)
+{
+    if (!state)
+    {
+        return;
+    }
+
+    soare_state_t *previous = soare_state_select(state);
+
+    soare_kill();
+
+    // Never leave the thread on a freed state
+    soare_state_select(previous == state ? NULL : previous);
+
+    if (state != &default_state)
+    {
+        free(state);
+    }
+}
+
+////////////////////////////////////////////////////////////
+soare_state_t *soare_state_select(soare_state_t *state)
+{
+    soare_state_t *previous = current;
+    current = state ? state : &default_state;
+    return previous;
+}
+
+////////////////////////////////////////////////////////////
+soare_state_t *soare_state_current(void)
+{
+    return current;
+}
+
+////////////////////////////////////////////////////////////
+char *soare_state_execute(soare_state_t *state, char *__restrict__ filename, char *__restrict__ rawcode)
+{
+    soare_state_t *previous = soare_state_select(state);
+    char *value = soare_execute(filename, rawcode);
+    soare_state_select(previous);
+
+    return value;
+}
+
+////////////////////////////////////////////////////////////
+char *soare_state_execute_isolated(soare_state_t *state, char *__restrict__ filename, char *__restrict__ rawcode)
+{
+    soare_state_t *previous = soare_state_select(state);
+    state = soare_state_current();
+
+    // Everything after these marks belongs to the code
+    soare_variables_t *mark = soare_last_variable();
+    unsigned long long scope = state->scope;
+    unsigned long modules = state->modules_count;
+    unsigned long generators = state->generators_id;
+    ast_t root = state->root;
+
+    // Each code has its own budget
+    state->root = NULL;
+    soare_state_budget(state, state->steps_slice, state->steps_limit);
+    char *value = soare_execute(filename, rawcode);
+
+    soare_state_release(state);
+    soare_generator_clear(generators);
+
+    // Compiled code is indexed by node: drop it before the nodes
+    soare_jit_clear();
+    soare_tree_free(state->root);
+    soare_reset_scope(mark);
+
+    while (state->modules_count > modules)
+    {
+        soare_module_release(state->modules[--state->modules_count]);
+    }
+
+    state->root = root;
+    __atomic_store_n(&state->scope, scope, __ATOMIC_RELAXED);
+    state->broken = bFalse;
+    state->returned = bFalse;
+
+    soare_state_select(previous);
+    return value;
+}
+
+////////////////////////////////////////////////////////////
+void soare_state_streams(soare_state_t *state, FILE *input, FILE *output, FILE *error)
+{
+    if (!state)
+    {
+        state = &default_state;
+    }
+
+    state->input = input;
+    state->output = output;
+    state->error = error;
+}
+
+////////////////////////////////////////////////////////////
+FILE *soare_stdin(void)
+{
+    return current->input ? current->input : stdin;
+}
+
+////////////////////////////////////////////////////////////
+FILE *soare_stdout(void)
+{
+    return current->output ? current->output : stdout;
+}
+
+////////////////////////////////////////////////////////////
+FILE *soare_stderr(void)
+{
+    return current->error ? current->error : stderr;
+}
+
+////////////////////////////////////////////////////////////
+int soare_state_errorlevel(soare_state_t *state)
+{
+    return state ? state->error_level : default_state.error_level;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_state_on_release(void (*hook)(soare_state_t *state))
+{
+    for (unsigned int i = 0; i < release_hooks_count; i++)
+    {
+        if (release_hooks[i] == hook)
+        {
+            return bTrue;
+        }
+    }
+
+    if (release_hooks_count == STATE_HOOKS)
+    {
+        return bFalse;
+    }
+
+    release_hooks[release_hooks_count++] = hook;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+void soare_state_release(soare_state_t *state)
+{
+    for (unsigned int i = 0; i < release_hooks_count; i++)
+    {
+        release_hooks[i](state);
+    }
+}
+
+////////////////////////////////////////////////////////////
+void soare_state_budget(soare_state_t *state, unsigned long long slice, unsigned long long limit)
+{
+    if (!state)
+    {
+        state = &default_state;
+    }
+
+    state->steps = 0;
+    state->steps_slice = slice;
+    state->steps_limit = limit;
+
+    state_next_check(state);
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_state_on_slice(void (*hook)(soare_state_t *state))
+{
+    for (unsigned int i = 0; i < slice_hooks_count; i++)
+    {
+        if (slice_hooks[i] == hook)
+        {
+            return bTrue;
+        }
+    }
+
+    if (slice_hooks_count == STATE_HOOKS)
+    {
+        return bFalse;
+    }
+
+    slice_hooks[slice_hooks_count++] = hook;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_state_slice(soare_state_t *state, document_t file)
+{
+    if (state->steps_limit && state->steps > state->steps_limit)
+    {
+        // Every following check raises again, even after a `try`
+        state->steps_next = state->steps + 1;
+        soare_leave_exception(TimeoutError, "step limit reached", file);
+        return bFalse;
+    }
+
+    state_next_check(state);
+
+    for (unsigned int i = 0; i < slice_hooks_count && state->steps_slice; i++)
+    {
+        slice_hooks[i](state);
+    }
+
+    return !soare_errorlevel();
+}
+
+////////////////////////////////////////////////////////////
+void soare_state_allocator(soare_state_t *state, const soare_allocator_t *allocator)
+{
+    if (!state)
+    {
+        state = &default_state;
+    }
+
+    if (!allocator || !allocator->alloc || !allocator->free)
+    {
+        state->allocator = (soare_allocator_t){0};
+        return;
+    }
+
+    state->allocator = *allocator;
+}
+
+////////////////////////////////////////////////////////////
+void soare_state_quota(soare_state_t *state, soare_memory_t category, size_t bytes)
+{
+    if (!state)
+    {
+        state = &default_state;
+    }
+
+    state->memory[category].quota = bytes;
+}
+
+////////////////////////////////////////////////////////////
+soare_memory_usage_t soare_state_memory(const soare_state_t *state, soare_memory_t category)
+{
+    return (state ? state : &default_state)->memory[category];
+}
+
+////////////////////////////////////////////////////////////
+soare_stats_t soare_state_stats(const soare_state_t *state)
+{
+    state = state ? state : &default_state;
+
+    soare_stats_t stats = {0};
+
+    stats.statements = __atomic_load_n(&state->stats.statements, __ATOMIC_RELAXED);
+    stats.nodes = __atomic_load_n(&state->stats.nodes, __ATOMIC_RELAXED);
+    stats.operations = __atomic_load_n(&state->stats.operations, __ATOMIC_RELAXED);
+    stats.calls = __atomic_load_n(&state->stats.calls, __ATOMIC_RELAXED);
+    stats.native_calls = __atomic_load_n(&state->stats.native_calls, __ATOMIC_RELAXED);
+    stats.lookups = __atomic_load_n(&state->stats.lookups, __ATOMIC_RELAXED);
+    stats.lookup_steps = __atomic_load_n(&state->stats.lookup_steps, __ATOMIC_RELAXED);
+    stats.raised = __atomic_load_n(&state->stats.raised, __ATOMIC_RELAXED);
+    stats.caught = __atomic_load_n(&state->stats.caught, __ATOMIC_RELAXED);
+    stats.imports = __atomic_load_n(&state->stats.imports, __ATOMIC_RELAXED);
+
+    // Updated with relaxed atomics by the thread running the state
+    stats.allocations = __atomic_load_n(&state->memory[SOARE_MEMORY_TOTAL].count, __ATOMIC_RELAXED);
+    stats.scope = __atomic_load_n(&state->scope, __ATOMIC_RELAXED);
+
+    stats.lookup_chain = stats.lookups ? (double)stats.lookup_steps / (double)stats.lookups : 0.0;
+
+    return stats;
+}
+
+////////////////////////////////////////////////////////////
+soare_stats_t soare_get_stats(void)
+{
+    return soare_state_stats(soare_state_current());
+}
@@ -81,6 +81,7 @@ static inline unsigned char str_keyword(char *string)
         !strcmp(KEYWORD_END, string) ||
         !strcmp(KEYWORD_ELSE, string) ||
         !strcmp(KEYWORD_WHILE, string) ||
+        !strcmp(KEYWORD_YIELD, string) ||
         !strcmp(KEYWORD_RAISE, string) ||
         !strcmp(KEYWORD_BREAK, string) ||
         !strcmp(KEYWORD_RETURN, string) ||
@@ -195,7 +196,15 @@ static void translate_escape_sequence(tokens_t *token)
         }
 
         chr++;
-        memmove(chr, chr + len, end - chr + len);
+
+        if (len > end - chr)
+        {
+            len = (int)(end - chr);
+        }
+
+        // Shift the rest of the string, null character included
+        memmove(chr, chr + len, (size_t)(end - chr - len) + 1);
+        end -= len;
     }
 }
 
@@ -214,15 +223,21 @@ document_t soare_empty_document(void)
 ////////////////////////////////////////////////////////////
 tokens_t *soare_new_tokens(char *__restrict__ filename, char *__restrict__ value, token_type_t type)
 {
-    tokens_t *token = (tokens_t *)malloc(sizeof(tokens_t));
+    tokens_t *token = (tokens_t *)soare_alloc(SOARE_MEMORY_TOKENS, sizeof(tokens_t));
 
     if (!token)
     {
-        SOARE_OUT_OF_MEMORY();
         return NULL;
     }
 
-    token->value = !value ? NULL : strdup(value);
+    token->value = !value ? NULL : soare_strdup(SOARE_MEMORY_TOKENS, value);
+
+    if (value && !token->value)
+    {
+        soare_free(token);
+        return NULL;
+    }
+
     token->type = type;
 
     token->file.ln = 0;
@@ -248,29 +263,33 @@ void soare_tokens_next(tokens_t **tokens)
 ////////////////////////////////////////////////////////////
 void soare_tokens_free(tokens_t *token)
 {
-    if (!token)
+    // In a loop: large sources have millions of tokens
+    while (token)
     {
-        return;
-    }
+        tokens_t *next = token->next;
+
+        soare_free(token->value);
+        soare_free(token);
 
-    soare_tokens_free(token->next);
-    free(token->value);
-    free(token);
+        token = next;
+    }
 }
 
 ////////////////////////////////////////////////////////////
 static char *strcut(const char *string, size_t size)
 {
-    if (strlen(string) < size)
+    // Only the token is scanned, not the rest of the source
+    const char *end = (const char *)memchr(string, 0, size);
+
+    if (end)
     {
-        size = strlen(string);
+        size = (size_t)(end - string);
     }
 
-    char *result = (char *)malloc(size + 1);
+    char *result = (char *)soare_alloc(SOARE_MEMORY_TOKENS, size + 1);
 
     if (!result)
     {
-        SOARE_OUT_OF_MEMORY();
         return NULL;
     }
 
@@ -292,7 +311,7 @@ static inline void updateln(unsigned long long *__restrict__ ln, unsigned long l
 }
 
 ////////////////////////////////////////////////////////////
-tokens_t *soare_tokenizer(char *__restrict__ filename, char *__restrict__ text)
+static tokens_t *tokenize(char *__restrict__ filename, char *__restrict__ text)
 {
     if (!text)
     {
@@ -302,6 +321,11 @@ tokens_t *soare_tokenizer(char *__restrict__ filename, char *__restrict__ text)
     tokens_t *root = soare_new_tokens(filename, NULL, TKN_EOF);
     tokens_t *curr = root;
 
+    if (!root)
+    {
+        return NULL;
+    }
+
     // Line/Column
     unsigned long long ln = 1;
     unsigned long long col = 1;
@@ -438,6 +462,12 @@ tokens_t *soare_tokenizer(char *__restrict__ filename, char *__restrict__ text)
 
         curr->value = strcut(text, offset);
 
+        if (!curr->value)
+        {
+            soare_tokens_free(root);
+            return NULL;
+        }
+
         if (type == TKN_STRING)
         {
             translate_escape_sequence(curr);
@@ -451,7 +481,11 @@ tokens_t *soare_tokenizer(char *__restrict__ filename, char *__restrict__ text)
         curr->type = type;
         curr->next = soare_new_tokens(filename, NULL, TKN_EOF);
 
-        curr = curr->next;
+        if (!(curr = curr->next))
+        {
+            soare_tokens_free(root);
+            return NULL;
+        }
 
         offset += type == TKN_STRING;
 
@@ -471,3 +505,20 @@ tokens_t *soare_tokenizer(char *__restrict__ filename, char *__restrict__ text)
 
     return root;
 }
+
+////////////////////////////////////////////////////////////
+tokens_t *soare_tokenizer(char *__restrict__ filename, char *__restrict__ text)
+{
+    soare_trace_t *trace = soare_state_current()->trace;
+
+    if (!trace)
+    {
+        return tokenize(filename, text);
+    }
+
+    soare_trace_begin(trace, "tokenize", filename);
+    tokens_t *tokens = tokenize(filename, text);
+    soare_trace_end(trace);
+
+    return tokens;
+}
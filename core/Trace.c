@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Trace.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#include <SOARE/SOARE.h>
+
+/**
+ *
+ * There is one trace per process. Each thread appends its events to
+ * chunks of its own buffer, found through a thread-local pointer, so
+ * that recording never locks. Buffers are pushed once on a list read
+ * when the trace is written. Names are copied into the events: the
+ * functions of an `eval()` may be gone by then
+ *
+ */
+
+/* Events per chunk */
+#define TRACE_CHUNK 4096
+/* Longest name kept by an event (with the null character) */
+#define TRACE_NAME 48
+/* Nanoseconds between two samples of the counters of a thread */
+#define TRACE_COUNTERS_NS 1000000ULL
+
+/**
+ * @brief Counters sampled with the events
+ */
+typedef enum trace_counter
+{
+
+    TRACE_TOKENS,    /**< Bytes of tokens              */
+    TRACE_AST,       /**< Bytes of trees               */
+    TRACE_STRINGS,   /**< Bytes of values              */
+    TRACE_VARIABLES, /**< Bytes of variables           */
+    TRACE_COUNT,     /**< Number of variables          */
+    TRACE_COUNTERS   /**< Number of counters           */
+
+} trace_counter_t;
+
+/**
+ * @brief Recorded event
+ */
+typedef struct trace_event
+{
+
+    unsigned long long time;                         /**< Since the start (ns)   */
+    const char *category;                            /**< Category, NULL: end    */
+    char phase;                                      /**< 'B', 'E' or 'C'        */
+    union
+    {
+        char name[TRACE_NAME];                       /**< Name ('B')             */
+        unsigned long long counters[TRACE_COUNTERS]; /**< Counters ('C')         */
+    } data;                                          /**< Payload of the event   */
+
+} trace_event_t;
+
+/**
+ * @brief Chunk of events
+ */
+typedef struct trace_chunk
+{
+
+    trace_event_t events[TRACE_CHUNK]; /**< Events                 */
+    unsigned long count;               /**< Number of events       */
+    struct trace_chunk *next;          /**< Next chunk, or NULL    */
+
+} trace_chunk_t;
+
+/**
+ * @brief Events of a thread
+ */
+typedef struct trace_buffer
+{
+
+    unsigned long tid;          /**< Thread number, from 1         */
+    trace_chunk_t *first;       /**< Oldest chunk                  */
+    trace_chunk_t *last;        /**< Chunk being written           */
+    unsigned long depth;        /**< Duration events still open    */
+    unsigned long skipped;      /**< Open events not recorded      */
+    unsigned long long counted; /**< Last sample of the counters   */
+    struct trace_buffer *next;  /**< Buffer of another thread      */
+
+} trace_buffer_t;
+
+/**
+ * @brief Trace of the process
+ */
+struct soare_trace
+{
+
+    trace_buffer_t *buffers;  /**< Buffers of the threads       */
+    unsigned long threads;    /**< Number of buffers            */
+    unsigned long generation; /**< Changes when cleared         */
+    unsigned long long start; /**< Start of the trace (ns)      */
+
+};
+
+static soare_trace_t session = {NULL, 0, 1, 0};
+
+/* Buffer of the calling thread */
+static _Thread_local trace_buffer_t *local = NULL;
+static _Thread_local unsigned long local_generation = 0;
+
+////////////////////////////////////////////////////////////
+static soare_state_t *trace_state(soare_state_t *state)
+{
+    if (state)
+    {
+        return state;
+    }
+
+    // NULL selects the default state
+    soare_state_t *previous = soare_state_select(NULL);
+    state = soare_state_current();
+    soare_state_select(previous);
+
+    return state;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long long trace_now(void)
+{
+    struct timespec now;
+
+#ifdef _WIN32
+    timespec_get(&now, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////
+static trace_buffer_t *trace_buffer(void)
+{
+    if (local && local_generation == __atomic_load_n(&session.generation, __ATOMIC_ACQUIRE))
+    {
+        return local;
+    }
+
+    trace_buffer_t *buffer = (trace_buffer_t *)calloc(1, sizeof(trace_buffer_t));
+
+    if (!buffer)
+    {
+        return NULL;
+    }
+
+    buffer->tid = __atomic_add_fetch(&session.threads, 1, __ATOMIC_RELAXED);
+    buffer->next = __atomic_load_n(&session.buffers, __ATOMIC_RELAXED);
+
+    // Lock-free push, the list is only read when written
+    while (!__atomic_compare_exchange_n(&session.buffers, &buffer->next, buffer, bFalse, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+
+    local = buffer;
+    local_generation = session.generation;
+
+    return buffer;
+}
+
+////////////////////////////////////////////////////////////
+static trace_event_t *trace_event(trace_buffer_t *buffer, char phase, unsigned long long now)
+{
+    if (!buffer->last || buffer->last->count == TRACE_CHUNK)
+    {
+        trace_chunk_t *chunk = (trace_chunk_t *)malloc(sizeof(trace_chunk_t));
+
+        if (!chunk)
+        {
+            return NULL;
+        }
+
+        chunk->count = 0;
+        chunk->next = NULL;
+
+        if (buffer->last)
+        {
+            buffer->last->next = chunk;
+        }
+        else
+        {
+            buffer->first = chunk;
+        }
+
+        buffer->last = chunk;
+    }
+
+    trace_event_t *event = &buffer->last->events[buffer->last->count++];
+
+    event->time = now - session.start;
+    event->category = NULL;
+    event->phase = phase;
+
+    return event;
+}
+
+////////////////////////////////////////////////////////////
+static void trace_counters(trace_buffer_t *buffer, unsigned long long now)
+{
+    if (now - buffer->counted < TRACE_COUNTERS_NS)
+    {
+        return;
+    }
+
+    soare_state_t *state = soare_state_current();
+    trace_event_t *event = trace_event(buffer, 'C', now);
+
+    if (!event)
+    {
+        return;
+    }
+
+    unsigned long long variables = 0;
+
+    for (soare_variables_t *variable = state->variables_last; variable; variable = variable->prev)
+    {
+        variables++;
+    }
+
+    event->data.counters[TRACE_TOKENS] = state->memory[SOARE_MEMORY_TOKENS].live;
+    event->data.counters[TRACE_AST] = state->memory[SOARE_MEMORY_AST].live;
+    event->data.counters[TRACE_STRINGS] = state->memory[SOARE_MEMORY_STRINGS].live;
+    event->data.counters[TRACE_VARIABLES] = state->memory[SOARE_MEMORY_VARIABLES].live;
+    event->data.counters[TRACE_COUNT] = variables;
+
+    buffer->counted = now;
+}
+
+////////////////////////////////////////////////////////////
+void soare_trace_begin(soare_trace_t *trace, const char *category, const char *name)
+{
+    (void)trace;
+
+    trace_buffer_t *buffer = trace_buffer();
+
+    if (!buffer)
+    {
+        return;
+    }
+
+    unsigned long long now = trace_now();
+    trace_counters(buffer, now);
+
+    trace_event_t *event = trace_event(buffer, 'B', now);
+
+    if (!event)
+    {
+        // Its end is not recorded either
+        buffer->skipped++;
+        return;
+    }
+
+    event->category = category;
+    snprintf(event->data.name, TRACE_NAME, "%s", name ? name : category);
+
+    buffer->depth++;
+}
+
+////////////////////////////////////////////////////////////
+void soare_trace_end(soare_trace_t *trace)
+{
+    (void)trace;
+
+    trace_buffer_t *buffer = trace_buffer();
+
+    if (!buffer)
+    {
+        return;
+    }
+
+    if (buffer->skipped)
+    {
+        buffer->skipped--;
+        return;
+    }
+
+    if (!buffer->depth || !trace_event(buffer, 'E', trace_now()))
+    {
+        return;
+    }
+
+    buffer->depth--;
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_trace_start(soare_state_t *state)
+{
+    state = trace_state(state);
+
+    if (!session.start)
+    {
+        session.start = trace_now();
+    }
+
+    state->trace = &session;
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+void soare_trace_stop(soare_state_t *state)
+{
+    trace_state(state)->trace = NULL;
+}
+
+////////////////////////////////////////////////////////////
+void soare_trace_clear(void)
+{
+    trace_buffer_t *buffer = __atomic_exchange_n(&session.buffers, NULL, __ATOMIC_ACQ_REL);
+
+    while (buffer)
+    {
+        trace_buffer_t *next = buffer->next;
+
+        while (buffer->first)
+        {
+            trace_chunk_t *chunk = buffer->first->next;
+            free(buffer->first);
+            buffer->first = chunk;
+        }
+
+        free(buffer);
+        buffer = next;
+    }
+
+    // Threads drop their old buffer at their next event
+    __atomic_add_fetch(&session.generation, 1, __ATOMIC_RELEASE);
+    session.threads = 0;
+    session.start = 0;
+}
+
+////////////////////////////////////////////////////////////
+static void trace_string(FILE *file, const char *string)
+{
+    fputc('"', file);
+
+    for (; *string; string++)
+    {
+        unsigned char character = (unsigned char)*string;
+
+        if (character == '"' || character == '\\')
+        {
+            fprintf(file, "\\%c", character);
+        }
+        else if (character < 0x20)
+        {
+            fprintf(file, "\\u%04x", character);
+        }
+        else
+        {
+            fputc(character, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+////////////////////////////////////////////////////////////
+static void trace_write_event(FILE *file, const trace_buffer_t *buffer, const trace_event_t *event)
+{
+    fprintf(file, ",\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f", event->phase, buffer->tid, (double)event->time / 1e3);
+
+    switch (event->phase)
+    {
+    case 'B':
+        fprintf(file, ",\"cat\":");
+        trace_string(file, event->category);
+        fprintf(file, ",\"name\":");
+        trace_string(file, event->data.name);
+        break;
+
+    case 'C':
+        fprintf(
+            //
+            file, ",\"name\":\"memory\",\"args\":{\"tokens\":%llu,\"ast\":%llu,\"strings\":%llu,\"variables\":%llu}}",
+            event->data.counters[TRACE_TOKENS], event->data.counters[TRACE_AST],
+            event->data.counters[TRACE_STRINGS], event->data.counters[TRACE_VARIABLES]
+            //
+        );
+        fprintf(file, ",\n{\"ph\":\"C\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f", buffer->tid, (double)event->time / 1e3);
+        fprintf(file, ",\"name\":\"variables\",\"args\":{\"count\":%llu}", event->data.counters[TRACE_COUNT]);
+        break;
+
+    default:
+        break;
+    }
+
+    fputc('}', file);
+}
+
+////////////////////////////////////////////////////////////
+unsigned long long soare_trace_write(FILE *file)
+{
+    unsigned long long events = 0;
+    double now = (double)(trace_now() - session.start) / 1e3;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"soare\"}}");
+
+    for (trace_buffer_t *buffer = __atomic_load_n(&session.buffers, __ATOMIC_ACQUIRE); buffer; buffer = buffer->next)
+    {
+        fprintf(file, ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"name\":\"thread_name\",\"args\":{\"name\":\"thread %lu\"}}", buffer->tid, buffer->tid);
+
+        for (const trace_chunk_t *chunk = buffer->first; chunk; chunk = chunk->next)
+        {
+            for (unsigned long i = 0; i < chunk->count; i++)
+            {
+                trace_write_event(file, buffer, &chunk->events[i]);
+                events++;
+            }
+        }
+
+        // Calls still running (exit(), error...) end now
+        for (unsigned long depth = buffer->depth; depth; depth--)
+        {
+            fprintf(file, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f}", buffer->tid, now);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    return events;
+}
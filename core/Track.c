@@ -0,0 +1,585 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Track.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+// The tracker allocates with the C library
+#define __SOARE_TRACK_INTERNAL
+#include <SOARE/SOARE.h>
+
+/**
+ *
+ * Live blocks are kept in a table indexed by address, so that blocks
+ * the tracker never saw (C library, untracked files) are released
+ * untouched. Each block names its site and its SOARE line, which
+ * hold the counters. Threads share the tables under a spinlock:
+ * tracking builds are meant for measurements, not for production
+ *
+ */
+
+/* Initial number of blocks, sites and lines (power of two) */
+#define TRACK_BUCKETS 1024
+/* No SOARE line running */
+#define TRACK_NONE 0
+
+/**
+ * @brief Counters of a site or of a line
+ */
+typedef struct track_usage
+{
+
+    unsigned long long count;      /**< Allocations                     */
+    unsigned long long bytes;      /**< Allocated bytes                 */
+    unsigned long long live;       /**< Blocks alive                    */
+    unsigned long long live_bytes; /**< Bytes alive                     */
+    unsigned long long released;   /**< Blocks released                 */
+    unsigned long long lifetime;   /**< Lifetime of the released (ns)   */
+
+} track_usage_t;
+
+/**
+ * @brief Allocating site (C code) or running line (SOARE code)
+ */
+typedef struct track_key
+{
+
+    const char *name;       /**< Function, or filename              */
+    unsigned long long ln;  /**< Line number                        */
+    track_usage_t usage;    /**< Counters                           */
+
+} track_key_t;
+
+/**
+ * @brief Live block
+ */
+typedef struct track_block
+{
+
+    void *pointer;           /**< Address, or NULL (free bucket)     */
+    size_t size;             /**< Size in bytes                      */
+    unsigned long site;      /**< Allocating site                    */
+    unsigned long line;      /**< SOARE line running                 */
+    unsigned long long time; /**< Allocation time (ns)               */
+
+} track_block_t;
+
+/**
+ * @brief Copy of a filename (lines outlive the modules)
+ */
+typedef struct track_file
+{
+
+    struct track_file *next; /**< Other filename                     */
+    char name[];             /**< Filename                           */
+
+} track_file_t;
+
+/**
+ * @brief Sites or lines, with their hash table
+ */
+typedef struct track_keys
+{
+
+    track_key_t *keys;     /**< Keys                                */
+    unsigned long count;   /**< Number of keys                      */
+    unsigned long size;    /**< Capacity of the keys                */
+    unsigned long *table;  /**< Keys by name and line (index + 1)   */
+    unsigned long buckets; /**< Number of buckets                   */
+
+} track_keys_t;
+
+static track_block_t *blocks = NULL;
+static unsigned long blocks_count = 0;
+static unsigned long blocks_size = 0;
+
+static track_keys_t sites = {0};
+static track_keys_t lines = {0};
+static track_file_t *files = NULL;
+
+static volatile char lock = 0;
+
+/* SOARE line running on the thread */
+static _Thread_local const char *running_file = NULL;
+static _Thread_local unsigned long long running_ln = 0;
+static _Thread_local const char *running_name = NULL;
+
+////////////////////////////////////////////////////////////
+static unsigned long long track_now(void)
+{
+    struct timespec now;
+
+#ifdef _WIN32
+    timespec_get(&now, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////
+static inline unsigned long track_hash(const void *pointer, unsigned long long ln)
+{
+    unsigned long long hash = ((unsigned long long)(size_t)pointer ^ ln * 0x9E3779B97F4A7C15ULL) * 0xFF51AFD7ED558CCDULL;
+    return (unsigned long)(hash >> 17);
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t track_rehash(track_keys_t *keys)
+{
+    unsigned long buckets = keys->buckets ? keys->buckets * 2 : TRACK_BUCKETS;
+    unsigned long *table = (unsigned long *)calloc(buckets, sizeof(unsigned long));
+
+    if (!table)
+    {
+        return bFalse;
+    }
+
+    for (unsigned long i = 0; i < keys->count; i++)
+    {
+        unsigned long bucket = track_hash(keys->keys[i].name, keys->keys[i].ln) & (buckets - 1);
+
+        while (table[bucket])
+        {
+            bucket = (bucket + 1) & (buckets - 1);
+        }
+
+        table[bucket] = i + 1;
+    }
+
+    free(keys->table);
+    keys->table = table;
+    keys->buckets = buckets;
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long track_key(track_keys_t *keys, const char *name, unsigned long long ln)
+{
+    // Index of the key, created on first use, TRACK_NONE if out of memory
+    if (keys->count * 2 >= keys->buckets && !track_rehash(keys))
+    {
+        return TRACK_NONE;
+    }
+
+    unsigned long bucket = track_hash(name, ln) & (keys->buckets - 1);
+
+    for (; keys->table[bucket]; bucket = (bucket + 1) & (keys->buckets - 1))
+    {
+        track_key_t *key = &keys->keys[keys->table[bucket] - 1];
+
+        if (key->name == name && key->ln == ln)
+        {
+            return keys->table[bucket] - 1;
+        }
+    }
+
+    if (keys->count == keys->size)
+    {
+        unsigned long size = keys->size ? keys->size * 2 : TRACK_BUCKETS;
+        track_key_t *resized = (track_key_t *)realloc(keys->keys, size * sizeof(track_key_t));
+
+        if (!resized)
+        {
+            return TRACK_NONE;
+        }
+
+        keys->keys = resized;
+        keys->size = size;
+    }
+
+    keys->keys[keys->count] = (track_key_t){name, ln, {0}};
+    keys->table[bucket] = ++keys->count;
+
+    return keys->count - 1;
+}
+
+////////////////////////////////////////////////////////////
+static inline unsigned long track_bucket(const void *pointer)
+{
+    return track_hash(pointer, 0) & (blocks_size - 1);
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t track_grow(void)
+{
+    unsigned long size = blocks_size ? blocks_size * 2 : TRACK_BUCKETS;
+    track_block_t *table = (track_block_t *)calloc(size, sizeof(track_block_t));
+
+    if (!table)
+    {
+        return bFalse;
+    }
+
+    track_block_t *previous = blocks;
+    unsigned long previous_size = blocks_size;
+
+    blocks = table;
+    blocks_size = size;
+
+    for (unsigned long i = 0; i < previous_size; i++)
+    {
+        if (previous[i].pointer)
+        {
+            unsigned long bucket = track_bucket(previous[i].pointer);
+
+            while (blocks[bucket].pointer)
+            {
+                bucket = (bucket + 1) & (blocks_size - 1);
+            }
+
+            blocks[bucket] = previous[i];
+        }
+    }
+
+    free(previous);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static void track_release(unsigned long bucket, unsigned long long now)
+{
+    // Count the block as released, then close the gap (linear probing)
+    track_block_t *block = &blocks[bucket];
+    track_key_t *keys[] = {&sites.keys[block->site], &lines.keys[block->line]};
+
+    for (int i = 0; i < 2; i++)
+    {
+        keys[i]->usage.live--;
+        keys[i]->usage.live_bytes -= block->size;
+        keys[i]->usage.released++;
+        keys[i]->usage.lifetime += now - block->time;
+    }
+
+    blocks[bucket].pointer = NULL;
+    blocks_count--;
+
+    for (unsigned long next = (bucket + 1) & (blocks_size - 1); blocks[next].pointer; next = (next + 1) & (blocks_size - 1))
+    {
+        unsigned long home = track_bucket(blocks[next].pointer);
+
+        // Move back the blocks which cannot be found past the gap
+        if ((next > bucket && (home <= bucket || home > next)) || (next < bucket && home <= bucket && home > next))
+        {
+            blocks[bucket] = blocks[next];
+            blocks[next].pointer = NULL;
+            bucket = next;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long track_find(const void *pointer)
+{
+    // Bucket of the block, or blocks_size if not tracked
+    if (!blocks_size)
+    {
+        return 0;
+    }
+
+    for (unsigned long bucket = track_bucket(pointer); blocks[bucket].pointer; bucket = (bucket + 1) & (blocks_size - 1))
+    {
+        if (blocks[bucket].pointer == pointer)
+        {
+            return bucket;
+        }
+    }
+
+    return blocks_size;
+}
+
+////////////////////////////////////////////////////////////
+static void track_record(void *pointer, size_t size, const char *function, int line)
+{
+    unsigned long long now = track_now();
+
+    // Sites and lines start with the untracked line
+    if (!lines.count && track_key(&lines, "<none>", 0) != TRACK_NONE)
+    {
+        track_key(&sites, "<none>", 0);
+    }
+
+    unsigned long bucket = track_find(pointer);
+
+    if (bucket < blocks_size)
+    {
+        // Released behind the tracker's back, then allocated again
+        track_release(bucket, now);
+    }
+
+    if ((blocks_count + 1) * 2 > blocks_size && !track_grow())
+    {
+        return;
+    }
+
+    unsigned long site = track_key(&sites, function, (unsigned long long)line);
+    unsigned long running = running_file ? track_key(&lines, running_file, running_ln) : TRACK_NONE;
+
+    bucket = track_bucket(pointer);
+
+    while (blocks[bucket].pointer)
+    {
+        bucket = (bucket + 1) & (blocks_size - 1);
+    }
+
+    blocks[bucket] = (track_block_t){pointer, size, site, running, now};
+    blocks_count++;
+
+    track_key_t *keys[] = {&sites.keys[site], &lines.keys[running]};
+
+    for (int i = 0; i < 2; i++)
+    {
+        keys[i]->usage.count++;
+        keys[i]->usage.bytes += size;
+        keys[i]->usage.live++;
+        keys[i]->usage.live_bytes += size;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static inline void track_lock(void)
+{
+    while (__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE))
+        ;
+}
+
+////////////////////////////////////////////////////////////
+static inline void track_unlock(void)
+{
+    __atomic_clear(&lock, __ATOMIC_RELEASE);
+}
+
+////////////////////////////////////////////////////////////
+static const char *track_file(const char *name)
+{
+    for (track_file_t *file = files; file; file = file->next)
+    {
+        if (!strcmp(file->name, name))
+        {
+            return file->name;
+        }
+    }
+
+    track_file_t *file = (track_file_t *)malloc(sizeof(track_file_t) + strlen(name) + 1);
+
+    if (!file)
+    {
+        return NULL;
+    }
+
+    strcpy(file->name, name);
+    file->next = files;
+    files = file;
+
+    return file->name;
+}
+
+////////////////////////////////////////////////////////////
+void soare_track_line(const document_t *line)
+{
+    // Copied: the tree of an eval() may be gone before the next line
+    const char *name = line->filename ? line->filename : "<code>";
+
+    if (name != running_name || !running_file || strcmp(name, running_file))
+    {
+        track_lock();
+        running_file = track_file(name);
+        track_unlock();
+
+        running_name = name;
+    }
+
+    running_ln = line->ln;
+}
+
+////////////////////////////////////////////////////////////
+void *soare_track_block(void *pointer, size_t size, const char *function, int line)
+{
+    if (pointer)
+    {
+        track_lock();
+        track_record(pointer, size, function, line);
+        track_unlock();
+    }
+
+    return pointer;
+}
+
+////////////////////////////////////////////////////////////
+char *soare_track_string(char *string, const char *function, int line)
+{
+    return (char *)soare_track_block(string, string ? strlen(string) + 1 : 0, function, line);
+}
+
+////////////////////////////////////////////////////////////
+void *soare_track_resize(void *previous, void *pointer, size_t size, const char *function, int line)
+{
+    if (!pointer)
+    {
+        // The previous block is still there
+        return NULL;
+    }
+
+    soare_track_forget(previous);
+    return soare_track_block(pointer, size, function, line);
+}
+
+////////////////////////////////////////////////////////////
+void soare_track_forget(void *pointer)
+{
+    if (!pointer)
+    {
+        return;
+    }
+
+    track_lock();
+
+    unsigned long bucket = track_find(pointer);
+
+    if (bucket < blocks_size)
+    {
+        track_release(bucket, track_now());
+    }
+
+    track_unlock();
+}
+
+////////////////////////////////////////////////////////////
+void soare_track_free(void *pointer)
+{
+    soare_track_forget(pointer);
+    free(pointer);
+}
+
+#ifdef __SOARE_TRACK_ALLOCATIONS
+
+/* Keys being sorted */
+static const track_keys_t *sorting = NULL;
+static boolean_t sorting_live = bFalse;
+
+////////////////////////////////////////////////////////////
+static int track_compare(const void *x, const void *y)
+{
+    const track_usage_t *a = &sorting->keys[*(const unsigned long *)x].usage;
+    const track_usage_t *b = &sorting->keys[*(const unsigned long *)y].usage;
+
+    unsigned long long bytes_a = sorting_live ? a->live_bytes : a->bytes;
+    unsigned long long bytes_b = sorting_live ? b->live_bytes : b->bytes;
+
+    return (bytes_a < bytes_b) - (bytes_a > bytes_b);
+}
+
+////////////////////////////////////////////////////////////
+static void track_table(FILE *file, const track_keys_t *keys, boolean_t live, const char *title)
+{
+    unsigned long *order = (unsigned long *)malloc((keys->count + 1) * sizeof(unsigned long));
+
+    if (!order)
+    {
+        return;
+    }
+
+    for (unsigned long i = 0; i < keys->count; i++)
+    {
+        order[i] = i;
+    }
+
+    sorting = keys;
+    sorting_live = live;
+    qsort(order, keys->count, sizeof(unsigned long), track_compare);
+
+    fprintf(file, "\n%12s %14s %10s %14s %14s  %s\n", "allocations", "bytes", "live", "live bytes", "lifetime (us)", title);
+
+    for (unsigned long i = 0; i < keys->count; i++)
+    {
+        const track_key_t *key = &keys->keys[order[i]];
+        const track_usage_t *usage = &key->usage;
+
+        if (live ? !usage->live : !usage->count)
+        {
+            continue;
+        }
+
+        fprintf(
+            //
+            file, "%12llu %14llu %10llu %14llu %14.3f  %s:%llu\n",
+            usage->count, usage->bytes, usage->live, usage->live_bytes,
+            usage->released ? (double)usage->lifetime / (double)usage->released / 1e3 : 0.0,
+            key->name, key->ln
+            //
+        );
+    }
+
+    free(order);
+}
+
+#endif /* __SOARE_TRACK_ALLOCATIONS */
+
+////////////////////////////////////////////////////////////
+static boolean_t track_write(FILE *file, boolean_t live)
+{
+#ifdef __SOARE_TRACK_ALLOCATIONS
+
+    track_lock();
+
+    unsigned long long count = 0;
+    unsigned long long bytes = 0;
+
+    for (unsigned long i = 0; i < sites.count; i++)
+    {
+        count += live ? sites.keys[i].usage.live : sites.keys[i].usage.count;
+        bytes += live ? sites.keys[i].usage.live_bytes : sites.keys[i].usage.bytes;
+    }
+
+    fprintf(file, "SOARE %s: %llu blocks, %llu bytes\n", live ? "heap snapshot" : "allocations", count, bytes);
+
+    track_table(file, &sites, live, "site (C function:line)");
+    track_table(file, &lines, live, "line (SOARE file:line)");
+
+    track_unlock();
+    return bTrue;
+
+#else
+
+    (void)file;
+    (void)live;
+    return bFalse;
+
+#endif /* __SOARE_TRACK_ALLOCATIONS */
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_track_enabled(void)
+{
+#ifdef __SOARE_TRACK_ALLOCATIONS
+    return bTrue;
+#else
+    return bFalse;
+#endif /* __SOARE_TRACK_ALLOCATIONS */
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_track_write(FILE *file)
+{
+    return track_write(file, bFalse);
+}
+
+////////////////////////////////////////////////////////////
+boolean_t soare_track_snapshot(FILE *file)
+{
+    return track_write(file, bTrue);
+}
@@ -25,12 +25,12 @@
  */
 #define SOARE_VERSION "Rv1.4.0"
 
-/* Standard input */
-#define __soare_stdin stdin
-/* Standard output */
-#define __soare_stdout stdout
-/* Standard output (error) */
-#define __soare_stderr stderr
+/* Standard input (of the selected state) */
+#define __soare_stdin soare_stdin()
+/* Standard output (of the selected state) */
+#define __soare_stdout soare_stdout()
+/* Standard output (error, of the selected state) */
+#define __soare_stderr soare_stderr()
 
 /** @brief Print helper */
 #define soare_write fprintf
@@ -76,11 +76,21 @@ namespace SOARE
 #include "utils/platform.h"
 
 #include "core/error.h"
+#include "core/allocator.h"
 #include "core/tokenizer.h"
 #include "core/parser.h"
 #include "core/memory.h"
 #include "core/math.h"
 #include "core/runtime.h"
+#include "core/module.h"
+#include "core/generator.h"
+#include "core/jit.h"
+#include "core/state.h"
+#include "core/profile.h"
+#include "core/sampler.h"
+#include "core/lines.h"
+#include "core/trace.h"
+#include "core/track.h"
 
 #ifdef __cplusplus
     }
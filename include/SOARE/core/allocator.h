@@ -0,0 +1,117 @@
+#ifndef __SOARE_CORE_ALLOCATOR_H__
+#define __SOARE_CORE_ALLOCATOR_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <allocator.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @brief Memory counted by a state
+ */
+typedef enum soare_memory
+{
+
+    SOARE_MEMORY_TOKENS,    /**< Tokens and their values              */
+    SOARE_MEMORY_AST,       /**< Tree nodes and their values          */
+    SOARE_MEMORY_STRINGS,   /**< Values of the variables              */
+    SOARE_MEMORY_VARIABLES, /**< Variable nodes and names             */
+    SOARE_MEMORY_TOTAL      /**< All the categories                   */
+
+} soare_memory_t;
+
+/**
+ * @brief Memory usage of a category
+ */
+typedef struct soare_memory_usage
+{
+
+    size_t live;              /**< Bytes in use                        */
+    size_t peak;              /**< Highest number of bytes in use      */
+    unsigned long long count; /**< Number of allocations               */
+    size_t quota;             /**< Maximum bytes in use, or 0          */
+
+} soare_memory_usage_t;
+
+/**
+ * @brief Allocator of a state
+ *
+ * `free` receives the size given to `alloc`. Blocks must be aligned
+ * as `malloc()` aligns them
+ */
+typedef struct soare_allocator
+{
+
+    void *(*alloc)(void *data, size_t size);               /**< Allocate, or NULL */
+    void (*free)(void *data, void *pointer, size_t size);  /**< Release           */
+    void *data;                                            /**< User data         */
+
+} soare_allocator_t;
+
+/**
+ * @brief Allocate memory counted by the current state
+ *
+ * The allocation crossing a quota raises a `MemoryError`, so that the
+ * tokenizer, the parser and the runtime stop at their next check: it
+ * only fails (NULL) when the allocator has no memory left
+ *
+ * @param category Category of the block (not SOARE_MEMORY_TOTAL)
+ * @param size Size in bytes
+ * @return void* Block, or NULL (MemoryError raised)
+ */
+void *soare_alloc(soare_memory_t category, size_t size);
+
+/**
+ * @brief Duplicate a string with `soare_alloc()`
+ *
+ * @param category Category of the copy
+ * @param string Null-terminated string
+ * @return char* Copy, or NULL (MemoryError raised)
+ */
+char *soare_strdup(soare_memory_t category, const char *string);
+
+/**
+ * @brief Release a block of `soare_alloc()`
+ *
+ * The block goes back to the state which allocated it, whichever
+ * state is selected
+ *
+ * @param pointer Block, or NULL
+ */
+void soare_free(void *pointer);
+
+/**
+ * @brief Count memory allocated elsewhere by the current state
+ *
+ * Replaces `counted` bytes by `size` bytes. Unlike `soare_alloc()`,
+ * nothing changes when the quota would be crossed
+ *
+ * @param category Category of the memory
+ * @param counted Bytes counted until now (0 for new memory)
+ * @param size Bytes to count (0 for released memory)
+ * @return boolean_t Non-zero if counted, zero if over the quota (MemoryError raised)
+ */
+boolean_t soare_memory_account(soare_memory_t category, size_t counted, size_t size);
+
+/**
+ * @brief Allocate outside of any state on the calling thread
+ *
+ * Used for trees shared by several states (modules), which may be
+ * released by any of them: their blocks come from `malloc()` and are
+ * not counted
+ *
+ * @param shared Non-zero to start, zero to stop (nested)
+ */
+void soare_memory_shared(boolean_t shared);
+
+#endif /* __SOARE_CORE_ALLOCATOR_H__ */
\ No newline at end of file
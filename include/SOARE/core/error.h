@@ -39,7 +39,8 @@ typedef enum soare_exceptions
     InvalidEscapeSequence,     /**< Bad string escape                       */
     IndexOutOfRange,           /**< Indexing outside container bounds       */
     DivideByZero,              /**< Division by zero                        */
-    RaiseException             /**< Explicitly raised exception             */
+    RaiseException,            /**< Explicitly raised exception             */
+    TimeoutError               /**< Step limit of the state reached         */
 
 } soare_exceptions_t;
 
@@ -51,6 +52,14 @@ typedef enum soare_exceptions
  */
 char *soare_get_exception(void);
 
+/**
+ * @brief Retrieve the type of the last exception
+ *
+ * @return soare_exceptions_t Exception type, InterpreterError if no
+ *         error is stored
+ */
+soare_exceptions_t soare_get_exception_type(void);
+
 /**
  * @brief Clear errorlevel
  *
@@ -0,0 +1,115 @@
+#ifndef __SOARE_CORE_GENERATOR_H__
+#define __SOARE_CORE_GENERATOR_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <generator.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @def SOARE_GENERATOR_STACK
+ * @brief Size of the stack of a generator, in bytes (as a main thread)
+ */
+#define SOARE_GENERATOR_STACK (8 * 1024 * 1024)
+
+/**
+ * @def SOARE_GENERATOR_RESERVE
+ * @brief Bottom of the stack of a generator left to native code, in bytes
+ */
+#define SOARE_GENERATOR_RESERVE (512 * 1024)
+
+/**
+ * @brief Create a generator from a called function
+ *
+ * Called instead of running a body containing `yield`: the arguments,
+ * registered after `mark`, become the frame of the generator. Nothing
+ * runs until the first `soare_generator_next()`
+ *
+ * Not available on Windows
+ *
+ * @param body NODE_GENERATOR node
+ * @param mark Last variable before the arguments
+ * @param file Location of the call, for errors
+ * @return char* Allocated handle ("generator:<n>"), or NULL on error
+ */
+char *soare_generator_new(ast_t body, soare_variables_t *mark, document_t file);
+
+/**
+ * @brief Call a function as a generator
+ *
+ * Same as `soare_run_function()`, but the body runs on its own stack
+ * when the generator is resumed, even without `yield`. It is
+ * suspended by `soare_generator_yield()`, from the body or from a
+ * native function it calls
+ *
+ * @param tree Call node (arguments are evaluated now)
+ * @return char* Allocated handle, or NULL on error
+ */
+char *soare_generator_call(ast_t tree);
+
+/**
+ * @brief Resume a generator until its next `yield`
+ *
+ * The body runs on its own stack, on top of the variables of the
+ * caller. When it yields, its variables are unlinked and kept with the
+ * generator until it is resumed again
+ *
+ * @param handle Generator handle
+ * @param value Allocated yielded value, or value returned by the body once finished (or NULL)
+ * @param file Location of the caller, for errors
+ * @return boolean_t Non-zero if a value was yielded, zero once the generator is finished or on error
+ */
+boolean_t soare_generator_next(char *handle, char **value, document_t file);
+
+/**
+ * @brief Get the generator running on the calling thread
+ *
+ * @return unsigned long Identifier of the innermost running generator, or 0
+ */
+unsigned long soare_generator_running(void);
+
+/**
+ * @brief Check the stack of the running generator
+ *
+ * Called before each function call: a recursion too deep for the
+ * stack of the generator raises an exception instead of overflowing
+ *
+ * @return boolean_t Non-zero if less than `SOARE_GENERATOR_RESERVE` bytes are left
+ */
+boolean_t soare_generator_overflow(void);
+
+/**
+ * @brief Suspend the running generator
+ *
+ * @param value Allocated yielded value (taken)
+ * @return boolean_t Non-zero once resumed, zero if the generator is closed (the body must return)
+ */
+boolean_t soare_generator_yield(char *value);
+
+/**
+ * @brief Finish a generator early
+ *
+ * A suspended body returns from its current `yield`
+ *
+ * @param handle Generator handle
+ */
+void soare_generator_close(char *handle);
+
+/**
+ * @brief Close the generators created after a given one
+ *
+ * @param last Identifier of the last generator to keep (0 to close all)
+ */
+void soare_generator_clear(unsigned long last);
+
+#endif /* __SOARE_CORE_GENERATOR_H__ */
\ No newline at end of file
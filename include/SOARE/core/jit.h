@@ -0,0 +1,78 @@
+#ifndef __SOARE_JIT_H__
+#define __SOARE_JIT_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <jit.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @def SOARE_JIT_HOT_LOOP
+ * @brief Iterations after which an interpreted loop is compiled
+ */
+#define SOARE_JIT_HOT_LOOP 8
+
+/**
+ * @def SOARE_JIT_HOT_CALLS
+ * @brief Calls after which a function is compiled
+ */
+#define SOARE_JIT_HOT_CALLS 2
+
+/**
+ * @brief Enable or disable the JIT compiler
+ *
+ * Only available on x86-64 (except Windows): elsewhere, or for any
+ * unsupported construct, the interpreter is used
+ *
+ * @param enabled Non-zero to compile hot functions and loops
+ */
+void soare_jit_mode(boolean_t enabled);
+
+/**
+ * @brief Check if the JIT compiler is enabled
+ *
+ * @return boolean_t Non-zero if enabled
+ */
+boolean_t soare_jit_enabled(void);
+
+/**
+ * @brief Run the body of a SOARE function with the JIT compiler
+ *
+ * Parameters must already be registered as variables. The function
+ * is compiled once it is hot: until then, or if it cannot be
+ * compiled, nothing is done and the interpreter must run the body
+ *
+ * @param function NODE_FUNCTION node
+ * @param returned Allocated returned value (or NULL) on success
+ * @return boolean_t Non-zero if the body was run
+ */
+boolean_t soare_jit_function(ast_t function, char **returned);
+
+/**
+ * @brief Run the remaining iterations of a loop with the JIT compiler
+ *
+ * Called between two iterations of a hot loop. If the compiled loop
+ * has to give up, the variables are restored to the start of the
+ * current iteration and the interpreter continues from there
+ *
+ * @param loop NODE_REPETITION node
+ * @return boolean_t Non-zero if the loop is finished
+ */
+boolean_t soare_jit_loop(ast_t loop);
+
+/**
+ * @brief Free all compiled code
+ */
+void soare_jit_clear(void);
+
+#endif /* __SOARE_JIT_H__ */
\ No newline at end of file
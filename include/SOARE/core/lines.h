@@ -0,0 +1,89 @@
+#ifndef __SOARE_LINES_H__
+#define __SOARE_LINES_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <lines.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @brief Line statistics of a state (opaque)
+ */
+typedef struct soare_lines soare_lines_t;
+
+/**
+ * @brief Start counting the lines run by a state
+ *
+ * Each statement and each evaluated expression is counted on its
+ * source line. Time runs on the line of the last statement or
+ * expression started, and goes back to the calling line when a
+ * function returns: the time of a line does not include the
+ * functions it calls
+ *
+ * @param state State, or NULL for the default state
+ * @return boolean_t Non-zero if started
+ */
+boolean_t soare_lines_start(soare_state_t *state);
+
+/**
+ * @brief Stop counting and forget the statistics
+ *
+ * @param state State, or NULL for the default state
+ */
+void soare_lines_stop(soare_state_t *state);
+
+/**
+ * @brief Write the statistics as annotated listings
+ *
+ * The hottest lines come first, then each file is listed with the
+ * statements, the expressions and the time of each of its lines
+ *
+ * @param state State, or NULL for the default state
+ * @param report Output file
+ * @return boolean_t Non-zero if the lines of the state are counted
+ */
+boolean_t soare_lines_write(soare_state_t *state, FILE *report);
+
+/**
+ * @brief Start a statement (interpreter)
+ *
+ * @param lines Line statistics of the selected state
+ * @param line Location of the statement
+ */
+void soare_lines_statement(soare_lines_t *lines, const document_t *line);
+
+/**
+ * @brief Start an expression (interpreter)
+ *
+ * @param lines Line statistics of the selected state
+ * @param line Location of the expression
+ */
+void soare_lines_expression(soare_lines_t *lines, const document_t *line);
+
+/**
+ * @brief Enter a function (interpreter)
+ *
+ * @param lines Line statistics of the selected state
+ * @return unsigned long Depth to give back to `soare_lines_leave()`
+ */
+unsigned long soare_lines_enter(soare_lines_t *lines);
+
+/**
+ * @brief Leave a function, back to the calling line (interpreter)
+ *
+ * @param lines Line statistics of the selected state
+ * @param depth Value returned by `soare_lines_enter()`
+ */
+void soare_lines_leave(soare_lines_t *lines, unsigned long depth);
+
+#endif /* __SOARE_LINES_H__ */
\ No newline at end of file
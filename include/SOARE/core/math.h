@@ -16,6 +16,29 @@
  *
  */
 
+/**
+ * @struct soare_closure
+ * @brief Pre-linked evaluator of an AST node (closure compilation mode)
+ *
+ * Closures are owned by their node and freed with the tree; `x`, `y`
+ * and `next` only reference closures owned by other nodes
+ */
+typedef struct soare_closure
+{
+
+    char *(*exec)(struct soare_closure *);                      /**< Run as a statement, returns the returned value */
+    char *(*eval)(struct soare_closure *);                      /**< Evaluate to an allocated string                */
+    boolean_t (*number)(struct soare_closure *, long double *); /**< Evaluate to a number                           */
+    int (*truth)(struct soare_closure *);                       /**< Truth value, or -1 if there is no value        */
+    ast_t node;                                                 /**< Compiled node, kept for diagnostics            */
+    long double constant;                                       /**< Pre-converted literal                          */
+    boolean_t scope;                                            /**< Body declares variables in its scope           */
+    struct soare_closure *x;                                    /**< First operand, condition or statement          */
+    struct soare_closure *y;                                    /**< Second operand, guard or body                  */
+    struct soare_closure *next;                                 /**< Next statement or branch                       */
+
+} soare_closure_t;
+
 /**
  * @brief Parse an expression with the given operator precedence priority
  *
@@ -33,4 +56,35 @@ ast_t soare_parse_expression(tokens_t **tokens, short priority);
  */
 char *soare_math(ast_t tree);
 
+/**
+ * @brief Compile an expression into a closure
+ *
+ * The closure is cached on the node: compiling it again is free
+ *
+ * @param tree Expression to compile
+ * @return soare_closure_t* Compiled closure, or NULL if out of memory
+ */
+soare_closure_t *soare_math_compile(ast_t tree);
+
+/**
+ * @brief Mark a tree as shared by several states
+ *
+ * Numeric operators are quickened, then the nodes are never rewritten
+ * nor used as inline caches at runtime
+ *
+ * @param tree Tree to freeze (with its siblings)
+ */
+void soare_math_freeze(ast_t tree);
+
+/**
+ * @brief Evaluate the truth value of the given AST
+ *
+ * Literals, variables and comparisons are tested in place, without
+ * allocating the "0"/"1" result string
+ *
+ * @param tree AST to evaluate
+ * @return boolean_t Non-zero if the expression is true
+ */
+boolean_t soare_math_truth(ast_t tree);
+
 #endif /* __SOARE_MATH_H__ */
\ No newline at end of file
@@ -28,12 +28,25 @@ typedef ast_t soare_arguments_list_t;
 typedef struct soare_functions
 {
 
-    char *name;                            /**< Function name            */
-    char *(*exec)(soare_arguments_list_t); /**< Function implementation  */
-    struct soare_functions *next;          /**< Next registered function */
+    char *name;                            /**< Function name                          */
+    char *(*exec)(soare_arguments_list_t); /**< Function implementation                */
+    boolean_t owned;                       /**< Name and node are individually owned   */
+    struct soare_functions *next;          /**< Next registered function               */
+    struct soare_functions *bucket;        /**< Next function in the same hash bucket  */
 
 } soare_functions_t;
 
+/**
+ * @brief Static `{name, function}` pair used for bulk registration
+ */
+typedef struct soare_function_entry
+{
+
+    char *name;                            /**< Function name           */
+    char *(*exec)(soare_arguments_list_t); /**< Function implementation */
+
+} soare_function_entry_t;
+
 /**
  * @brief Register a new function
  *
@@ -43,6 +56,18 @@ typedef struct soare_functions
  */
 soare_functions_t *soare_add_function(char *name, char *(*function)(soare_arguments_list_t));
 
+/**
+ * @brief Register a static table of functions
+ *
+ * Names are referenced, not copied, and all entries share a single
+ * allocation: `table` names must outlive the interpreter
+ *
+ * @param table Array of `{name, function}` pairs
+ * @param count Number of entries in `table`
+ * @return unsigned int Number of registered functions
+ */
+unsigned int soare_add_functions(const soare_function_entry_t *table, unsigned int count);
+
 /**
  * @brief Find a registered function by name
  *
@@ -51,6 +76,16 @@ soare_functions_t *soare_add_function(char *name, char *(*function)(soare_argume
  */
 soare_functions_t *soare_get_function(char *name);
 
+/**
+ * @brief Get the functions generation counter
+ *
+ * The counter changes whenever functions are registered, cleared, or
+ * shadowed by a variable of the same name
+ *
+ * @return unsigned long long Current generation
+ */
+unsigned long long soare_functions_epoch(void);
+
 /**
  * @brief Remove and free all registered functions
  */
@@ -71,12 +106,25 @@ char *soare_get_argument(soare_arguments_list_t args, unsigned int position);
 typedef struct soare_keywords
 {
 
-    char *name;                  /**< Keyword name                      */
-    void (*exec)(void);          /**< Callback executed for the keyword */
-    struct soare_keywords *next; /**< Next registered keyword           */
+    char *name;                    /**< Keyword name                          */
+    void (*exec)(void);            /**< Callback executed for the keyword     */
+    boolean_t owned;               /**< Name and node are individually owned  */
+    struct soare_keywords *next;   /**< Next registered keyword               */
+    struct soare_keywords *bucket; /**< Next keyword in the same hash bucket  */
 
 } soare_keywords_t;
 
+/**
+ * @brief Static `{name, keyword}` pair used for bulk registration
+ */
+typedef struct soare_keyword_entry
+{
+
+    char *name;         /**< Keyword name                      */
+    void (*exec)(void); /**< Callback executed for the keyword */
+
+} soare_keyword_entry_t;
+
 /**
  * @brief Register a new keyword
  *
@@ -86,6 +134,18 @@ typedef struct soare_keywords
  */
 soare_keywords_t *soare_add_keyword(char *name, void (*keyword)(void));
 
+/**
+ * @brief Register a static table of keywords
+ *
+ * Names are referenced, not copied, and all entries share a single
+ * allocation: `table` names must outlive the interpreter
+ *
+ * @param table Array of `{name, keyword}` pairs
+ * @param count Number of entries in `table`
+ * @return unsigned int Number of registered keywords
+ */
+unsigned int soare_add_keywords(const soare_keyword_entry_t *table, unsigned int count);
+
 /**
  * @brief Find a registered keyword by name
  *
@@ -107,6 +167,7 @@ typedef struct soare_variables
 
     char *name;                   /**< Identifier name                  */
     char *value;                  /**< Variable value string            */
+    size_t size;                  /**< Bytes counted for the value      */
     ast_t body;                   /**< Function body AST                */
     boolean_t mutable;            /**< Variable is mutable              */
     unsigned long long scope;     /**< Scope index                      */
@@ -133,6 +194,61 @@ soare_variables_t *soare_add_variable(char *name, char *value, boolean_t mutable
  */
 soare_variables_t *soare_get_variable(char *name);
 
+/**
+ * @brief Replace the value of a variable
+ *
+ * The value is counted as a string of the current state. Over the
+ * quota, it is released instead and the variable keeps its value
+ *
+ * @param variable Variable to change
+ * @param value Allocated value (taken), or NULL
+ * @return boolean_t Non-zero if replaced, zero if over the quota (MemoryError raised)
+ */
+boolean_t soare_set_value(soare_variables_t *variable, char *value);
+
+/**
+ * @brief Find the variable named by an AST node, through its inline cache
+ *
+ * The resolved variable is kept in the node until a variable is
+ * registered or removed
+ *
+ * @param tree Node holding the variable name
+ * @return soare_variables_t* Pointer to the variable, or NULL if not found
+ */
+soare_variables_t *soare_get_variable_cached(ast_t tree);
+
+/**
+ * @brief Get the most recently registered variable
+ *
+ * @return soare_variables_t* Last variable, or NULL if there is none
+ */
+soare_variables_t *soare_last_variable(void);
+
+/**
+ * @brief Remove all variables registered after `mark`
+ *
+ * Used to reset a scope frame without leaving and re-entering it
+ *
+ * @param mark Variable returned by `soare_last_variable()`
+ */
+void soare_reset_scope(soare_variables_t *mark);
+
+/**
+ * @brief Unlink all variables registered after `mark`, without freeing them
+ *
+ * @param mark Variable returned by `soare_last_variable()`
+ * @return soare_variables_t* Oldest unlinked variable (a list linked by `next`), or NULL
+ */
+soare_variables_t *soare_detach_variables(soare_variables_t *mark);
+
+/**
+ * @brief Register again variables unlinked by `soare_detach_variables()`
+ *
+ * @param variables Oldest variable of the list
+ * @param shift Number of levels added to their scope
+ */
+void soare_attach_variables(soare_variables_t *variables, long long shift);
+
 /**
  * @brief Increment the current scope level
  */
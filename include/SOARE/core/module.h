@@ -0,0 +1,94 @@
+#ifndef __SOARE_CORE_MODULE_H__
+#define __SOARE_CORE_MODULE_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <module.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @brief Compiled module
+ *
+ * A parsed and compiled SOARE file which is never modified once
+ * loaded, so several states, on different threads, can run it without
+ * copying it. Attaching a module to a state runs it in that state:
+ * variables and functions it declares belong to the state, function
+ * bodies stay in the module
+ *
+ * Members are managed by the interpreter and must not be changed
+ * directly
+ */
+typedef struct soare_module
+{
+
+    char *filename;            /**< Module filename                    */
+    ast_t tree;                /**< Parsed tree, shared by all states  */
+    unsigned long references;  /**< Number of owners                   */
+    long long modified;        /**< File modification time             */
+    long long size;            /**< File size                          */
+    boolean_t registered;      /**< Listed in the module cache         */
+    struct soare_module *next; /**< Next module in the module cache    */
+
+} soare_module_t;
+
+/**
+ * @brief Load a SOARE file as a module
+ *
+ * Files are parsed once per process: while a module is referenced
+ * and its file is unchanged, loading it again returns the same module
+ * with a new reference. Thread-safe
+ *
+ * @param filename File to load
+ * @return soare_module_t* Module (release it when done), or NULL on error
+ */
+soare_module_t *soare_module_load(char *filename);
+
+/**
+ * @brief Compile SOARE source code as a module
+ *
+ * The module is not listed in the module cache
+ *
+ * @param filename Logical filename associated
+ * @param rawcode Source code buffer to compile
+ * @return soare_module_t* Module (release it when done), or NULL on error
+ */
+soare_module_t *soare_module_compile(char *__restrict__ filename, char *__restrict__ rawcode);
+
+/**
+ * @brief Add a reference to a module. Thread-safe
+ *
+ * @param module Module to keep
+ * @return soare_module_t* The same module
+ */
+soare_module_t *soare_module_retain(soare_module_t *module);
+
+/**
+ * @brief Release a reference to a module, freed with its last reference.
+ * Thread-safe
+ *
+ * @param module Module to release
+ */
+void soare_module_release(soare_module_t *module);
+
+/**
+ * @brief Run a module in the selected state
+ *
+ * The state keeps a reference to the module until it is freed (or, in
+ * `soare_state_execute_isolated()`, until the code ends)
+ *
+ * @param module Module to run
+ * @return char* Result string
+ */
+char *soare_module_attach(soare_module_t *module);
+
+#endif /* __SOARE_CORE_MODULE_H__ */
\ No newline at end of file
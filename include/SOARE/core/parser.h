@@ -41,8 +41,16 @@ typedef enum node_type
     NODE_REPETITION,    /**< Loop/repetition construct */
     NODE_BREAK,         /**< Break statement */
     NODE_RETURN,        /**< Return statement */
-    NODE_STRERROR,      /**< String error node */
-    NODE_CUSTOM_KEYWORD /**< Custom keyword handled by the runtime */
+    NODE_STRERROR,       /**< String error node */
+    NODE_CUSTOM_KEYWORD, /**< Custom keyword handled by the runtime */
+    NODE_YIELD,          /**< Yield statement */
+    NODE_GENERATOR,      /**< Body of a function containing yield */
+
+    /* Quickened nodes, rewritten at runtime */
+
+    NODE_OPERATOR_NUM, /**< Numeric operator, evaluated without intermediate strings */
+    NODE_MEMGET_SLOT,  /**< Memory read resolved to a cached variable */
+    NODE_CALL_NATIVE   /**< Call resolved to a native function */
 
 } node_type_t;
 
@@ -53,12 +61,17 @@ typedef enum node_type
 typedef struct node
 {
 
-    char *value;          /**< Node textual value         */
-    node_type_t type;     /**< Node classification        */
-    document_t file;      /**< Source document / location */
-    struct node *parent;  /**< Parent node                */
-    struct node *child;   /**< First child node           */
-    struct node *sibling; /**< Next sibling node          */
+    char *value;                   /**< Node textual value         */
+    node_type_t type;              /**< Node classification        */
+    document_t file;               /**< Source document / location */
+    void *cache;                   /**< Quickening inline cache    */
+    unsigned long long epoch;      /**< Inline cache generation    */
+    struct soare_closure *closure; /**< Compiled closure, or NULL  */
+    boolean_t shared;              /**< Part of a shared module    */
+    struct node *parent;           /**< Parent node                */
+    struct node *child;            /**< First child node           */
+    struct node *last;             /**< Last joined child, or NULL */
+    struct node *sibling;          /**< Next sibling node          */
 
 } node_t, *ast_t;
 
@@ -0,0 +1,88 @@
+#ifndef __SOARE_PROFILE_H__
+#define __SOARE_PROFILE_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <profile.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @brief Function profile of a state (opaque)
+ */
+typedef struct soare_profile soare_profile_t;
+
+/**
+ * @brief Start profiling the calls of a state
+ *
+ * Each call of a SOARE function or of a native function is timed.
+ * Functions are identified by their name and their definition, so
+ * that two functions with the same name stay apart. Time spent by a
+ * suspended async task is counted in the code which resumed it
+ *
+ * @param state State, or NULL for the default state
+ * @return boolean_t Non-zero if started
+ */
+boolean_t soare_profile_start(soare_state_t *state);
+
+/**
+ * @brief Stop profiling and forget the results
+ *
+ * @param state State, or NULL for the default state
+ */
+void soare_profile_stop(soare_state_t *state);
+
+/**
+ * @brief Write the results of a profile
+ *
+ * The report lists the functions by self time, with their number of
+ * calls and their inclusive time. The collapsed stacks (one call
+ * path and its self time in microseconds per line) are read by
+ * `flamegraph.pl`
+ *
+ * @param state State, or NULL for the default state
+ * @param report Text report, or NULL
+ * @param collapsed Collapsed stacks, or NULL
+ * @return boolean_t Non-zero if the state is profiled
+ */
+boolean_t soare_profile_write(soare_state_t *state, FILE *report, FILE *collapsed);
+
+/**
+ * @brief Enter a function (interpreter)
+ *
+ * @param profile Profile of the selected state
+ * @param key Definition of the function (node, native function, ...)
+ * @param name Name of the function
+ * @param file Definition of the function, or NULL (native)
+ * @return unsigned long Depth to give back to `soare_profile_leave()`
+ */
+unsigned long soare_profile_enter(soare_profile_t *profile, const void *key, const char *name, const document_t *file);
+
+/**
+ * @brief Leave a function (interpreter)
+ *
+ * @param profile Profile of the selected state
+ * @param depth Value returned by `soare_profile_enter()`
+ */
+void soare_profile_leave(soare_profile_t *profile, unsigned long depth);
+
+/**
+ * @brief Call a native function with the profile, the sampler, the
+ * line statistics and the trace of the selected state
+ *
+ * @param function Native function
+ * @param args Arguments of the call
+ * @return char* Returned value
+ */
+char *soare_profile_native(soare_functions_t *function, soare_arguments_list_t args);
+
+#endif /* __SOARE_PROFILE_H__ */
\ No newline at end of file
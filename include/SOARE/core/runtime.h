@@ -24,6 +24,46 @@
  */
 char *soare_run_function(ast_t tree);
 
+/**
+ * @brief Run the body of a called function
+ *
+ * Its parameters must already be registered, one scope level above
+ * the current one
+ *
+ * @param body NODE_BODY or NODE_GENERATOR node
+ * @return char* Allocated returned value, or NULL
+ */
+char *soare_run_body(ast_t body);
+
+/**
+ * @brief Enable or disable the closure compilation mode
+ *
+ * In this mode, bodies are compiled into closures on their first
+ * execution and run as a chain of indirect calls instead of being
+ * dispatched on the node type at each visit
+ *
+ * @param enabled Non-zero to run compiled closures
+ */
+void soare_closure_mode(boolean_t enabled);
+
+/**
+ * @brief Compile all the closures of a tree ahead of time
+ *
+ * Includes function bodies and call arguments, which are otherwise
+ * compiled on their first execution
+ *
+ * @param tree Root, or function node, to compile
+ */
+void soare_closure_compile(ast_t tree);
+
+/**
+ * @brief Share the SOARE functions of the selected state
+ *
+ * Their trees are compiled and frozen (see `soare_math_freeze()`), so
+ * that states inheriting from this one can call them from other threads
+ */
+void soare_share_functions(void);
+
 /**
  * @brief Execute SOARE source code
  *
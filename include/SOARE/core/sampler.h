@@ -0,0 +1,90 @@
+#ifndef __SOARE_SAMPLER_H__
+#define __SOARE_SAMPLER_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <sampler.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @def SOARE_SAMPLER_HZ
+ * @brief Default number of samples per second of CPU time
+ */
+#define SOARE_SAMPLER_HZ 997
+
+/**
+ * @brief Sampling profiler of a state (opaque)
+ */
+typedef struct soare_sampler soare_sampler_t;
+
+/**
+ * @brief Start sampling the calls of a state
+ *
+ * A `SIGPROF` timer interrupts the program `hz` times per second of
+ * CPU time and records the running calls and source line, read from
+ * a shadow stack kept by the interpreter. Unlike `soare_profile_start()`,
+ * calls are not timed: tiny functions are not slowed down. One state
+ * of the process can be sampled at a time
+ *
+ * @param state State, or NULL for the default state
+ * @param hz Samples per second, or 0 for SOARE_SAMPLER_HZ
+ * @return boolean_t Non-zero if started (not available on Windows)
+ */
+boolean_t soare_sampler_start(soare_state_t *state, unsigned int hz);
+
+/**
+ * @brief Stop sampling and forget the samples
+ *
+ * @param state State, or NULL for the default state
+ */
+void soare_sampler_stop(soare_state_t *state);
+
+/**
+ * @brief Write the samples as collapsed stacks
+ *
+ * One line per call path and source line, with its number of samples,
+ * as read by `flamegraph.pl`
+ *
+ * @param state State, or NULL for the default state
+ * @param collapsed Output file
+ * @return unsigned long long Number of samples
+ */
+unsigned long long soare_sampler_write(soare_state_t *state, FILE *collapsed);
+
+/**
+ * @brief Enter a function (interpreter)
+ *
+ * @param sampler Sampler of the selected state
+ * @param name Name of the function
+ * @param file Definition of the function, or NULL (native)
+ * @return unsigned long Depth to give back to `soare_sampler_leave()`
+ */
+unsigned long soare_sampler_enter(soare_sampler_t *sampler, const char *name, const document_t *file);
+
+/**
+ * @brief Leave a function (interpreter)
+ *
+ * @param sampler Sampler of the selected state
+ * @param depth Value returned by `soare_sampler_enter()`
+ */
+void soare_sampler_leave(soare_sampler_t *sampler, unsigned long depth);
+
+/**
+ * @brief Set the running statement (interpreter)
+ *
+ * @param sampler Sampler of the selected state
+ * @param line Location of the statement
+ */
+void soare_sampler_line(soare_sampler_t *sampler, const document_t *line);
+
+#endif /* __SOARE_SAMPLER_H__ */
\ No newline at end of file
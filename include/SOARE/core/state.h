@@ -0,0 +1,360 @@
+#ifndef __SOARE_STATE_H__
+#define __SOARE_STATE_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <state.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @brief Runtime counters of a state
+ *
+ * Counted by the thread running the state with relaxed atomics, so
+ * that they may be read from any thread while the state runs
+ */
+typedef struct soare_stats
+{
+
+    unsigned long long statements;   /**< Statements executed                         */
+    unsigned long long nodes;        /**< Expression nodes evaluated (tree mode)      */
+    unsigned long long operations;   /**< Operators evaluated (tree mode)             */
+    unsigned long long calls;        /**< Calls of SOARE functions                    */
+    unsigned long long native_calls; /**< Calls of native functions                   */
+    unsigned long long lookups;      /**< Variables searched by name                  */
+    unsigned long long lookup_steps; /**< Variables compared by these searches        */
+    double lookup_chain;             /**< Average comparisons per search (read only)  */
+    unsigned long long allocations;  /**< Blocks allocated by the state (read only)   */
+    unsigned long long raised;       /**< Exceptions raised                           */
+    unsigned long long caught;       /**< Exceptions caught by `try`                  */
+    unsigned long long imports;      /**< Files imported                              */
+    unsigned long long scope;        /**< Current scope depth (read only)             */
+
+} soare_stats_t;
+
+/**
+ * @def SOARE_STATS_ADD
+ * @brief Add to a counter of a state (relaxed atomic add)
+ */
+#define SOARE_STATS_ADD(__state, __counter, __count) \
+    ((void)__atomic_fetch_add(&(__state)->stats.__counter, (__count), __ATOMIC_RELAXED))
+
+/**
+ * @brief Interpreter instance
+ *
+ * Holds everything a script can change: trees, variables, registered
+ * functions and keywords, errors and compiled code. Attached modules
+ * are only referenced. Each thread works on its selected state (the
+ * default state until another is selected), so independent states can
+ * run at the same time on different threads. A state must not be used
+ * by two threads at once
+ *
+ * Members are managed by the interpreter and must not be changed
+ * directly
+ */
+typedef struct soare_state
+{
+
+    /* Instance */
+    const struct soare_state *parent;        /**< Read-only inherited state, or NULL    */
+    FILE *input;                             /**< Standard input, or NULL for stdin     */
+    FILE *output;                            /**< Standard output, or NULL for stdout   */
+    FILE *error;                             /**< Error output, or NULL for stderr      */
+
+    /* Runtime */
+    ast_t root;                              /**< Executed trees                        */
+    boolean_t broken;                        /**< Break requested                       */
+    boolean_t returned;                      /**< Return requested                      */
+    boolean_t closure_mode;                  /**< Run compiled closures                 */
+    boolean_t jit_mode;                      /**< Compile hot functions and loops       */
+    struct jit_unit **jit_units;             /**< Compiled code hash table, or NULL     */
+    struct soare_profile *profile;           /**< Function profile, or NULL             */
+    struct soare_sampler *sampler;           /**< Sampling profiler, or NULL            */
+    struct soare_lines *lines;               /**< Line statistics, or NULL              */
+    struct soare_trace *trace;               /**< Trace of the process, or NULL         */
+    struct soare_module **modules;           /**< Attached modules                      */
+    unsigned long modules_count;             /**< Number of attached modules            */
+    unsigned long modules_size;              /**< Capacity of the attached modules      */
+    struct soare_generator *generators;      /**< Unfinished generators, newest first   */
+    struct soare_generator **generators_ids; /**< Generators hash table, by identifier  */
+    unsigned long generators_ids_size;       /**< Number of buckets                     */
+    unsigned long generators_count;          /**< Number of unfinished generators       */
+    unsigned long generators_id;             /**< Last generator identifier             */
+    void *generators_regions;                /**< Regions the stacks are carved from    */
+    void **generators_stacks;                /**< Free stacks of finished generators    */
+    unsigned long generators_stacks_count;   /**< Number of free stacks                 */
+    unsigned long generators_stacks_size;    /**< Capacity of the free stacks           */
+    unsigned long long steps;                /**< Loop iterations and calls run         */
+    unsigned long long steps_next;           /**< Step checking the budget              */
+    unsigned long long steps_slice;          /**< Steps per slice, or 0                 */
+    unsigned long long steps_limit;          /**< Steps before TimeoutError, or 0       */
+
+    /* Memory */
+    soare_allocator_t allocator;             /**< Allocator, or zeroed for malloc       */
+    soare_memory_usage_t memory[SOARE_MEMORY_TOTAL + 1]; /**< Usage per category    */
+    soare_stats_t stats;                     /**< Runtime counters                      */
+
+    /* Errors */
+    boolean_t error_display;                 /**< Display exceptions                    */
+    int error_level;                         /**< Current error level                   */
+    char *last_error;                        /**< Latest exception name                 */
+
+    /* Parser */
+    boolean_t all_statement_closed;          /**< Last parsed code is complete          */
+
+    /* Functions */
+    soare_functions_t *functions_list;       /**< Functions in registration order       */
+    soare_functions_t *functions_last;       /**< Last registered function              */
+    soare_functions_t **functions_table;     /**< Functions hash table                  */
+    unsigned long functions_table_size;      /**< Number of buckets                     */
+    unsigned long functions_count;           /**< Number of functions                   */
+    struct registry_block *functions_blocks; /**< Functions bulk allocations           */
+    unsigned long long functions_epoch;      /**< Functions generation (inline caches)  */
+
+    /* Keywords */
+    soare_keywords_t *keywords_list;         /**< Keywords in registration order        */
+    soare_keywords_t *keywords_last;         /**< Last registered keyword               */
+    soare_keywords_t **keywords_table;       /**< Keywords hash table                   */
+    unsigned long keywords_table_size;       /**< Number of buckets                     */
+    unsigned long keywords_count;            /**< Number of keywords                    */
+    struct registry_block *keywords_blocks;  /**< Keywords bulk allocations            */
+
+    /* Variables */
+    unsigned long long scope;                /**< Current scope level                   */
+    soare_variables_t *variables_list;       /**< Oldest variable                       */
+    soare_variables_t *variables_last;       /**< Newest variable                       */
+    unsigned long long variables_epoch;      /**< Variables generation (inline caches)  */
+
+} soare_state_t;
+
+/**
+ * @brief Create a new interpreter state
+ *
+ * The state starts empty: no variable, function nor keyword is
+ * registered. Select it to register them
+ *
+ * @return soare_state_t* New state, or NULL if out of memory
+ */
+soare_state_t *soare_state_new(void);
+
+/**
+ * @brief Create a new interpreter state inheriting from another one
+ *
+ * The new state sees the functions, keywords and constant variables
+ * (SOARE functions only once their tree is shared) of `parent` and of
+ * its own parents, without copying them, and starts with the same interpreter modes (closure,
+ * JIT). `parent` must not change nor be freed while the new state
+ * exists, but several states, on different threads, can inherit from it
+ *
+ * @param parent State to inherit from
+ * @return soare_state_t* New state, or NULL if out of memory
+ */
+soare_state_t *soare_state_inherit(const soare_state_t *parent);
+
+/**
+ * @brief Free an interpreter state and everything it holds
+ *
+ * If the state is selected by the calling thread, the default state
+ * is selected instead. The default state is cleared but not freed
+ *
+ * @param state State to free
+ */
+void soare_state_free(soare_state_t *state);
+
+/**
+ * @brief Select the state used by the calling thread
+ *
+ * All other functions of the interpreter work on the selected state
+ *
+ * @param state State to select, or NULL for the default state
+ * @return soare_state_t* Previously selected state
+ */
+soare_state_t *soare_state_select(soare_state_t *state);
+
+/**
+ * @brief Get the state selected by the calling thread
+ *
+ * @return soare_state_t* Selected state
+ */
+soare_state_t *soare_state_current(void);
+
+/**
+ * @brief Execute SOARE source code in a given state
+ *
+ * The state is selected during the execution, then the previous
+ * state is selected again
+ *
+ * @param state State to run the code in
+ * @param filename Logical filename associated
+ * @param rawcode Source code buffer to execute
+ * @return char* Result string
+ */
+char *soare_state_execute(soare_state_t *state, char *__restrict__ filename, char *__restrict__ rawcode);
+
+/**
+ * @brief Execute SOARE source code in a given state, then forget it
+ *
+ * Same as `soare_state_execute()`, but the trees, variables, modules
+ * and compiled code created by the code are released afterwards, so
+ * the state can run many scripts without growing. Changes made to existing
+ * mutable variables are kept
+ *
+ * @param state State to run the code in
+ * @param filename Logical filename associated
+ * @param rawcode Source code buffer to execute
+ * @return char* Result string
+ */
+char *soare_state_execute_isolated(soare_state_t *state, char *__restrict__ filename, char *__restrict__ rawcode);
+
+/**
+ * @brief Set the standard streams of a given state
+ *
+ * @param state State to change
+ * @param input Standard input, or NULL for stdin
+ * @param output Standard output, or NULL for stdout
+ * @param error Error output, or NULL for stderr
+ */
+void soare_state_streams(soare_state_t *state, FILE *input, FILE *output, FILE *error);
+
+/**
+ * @brief Get the standard input of the selected state
+ *
+ * @return FILE* Input stream
+ */
+FILE *soare_stdin(void);
+
+/**
+ * @brief Get the standard output of the selected state
+ *
+ * @return FILE* Output stream
+ */
+FILE *soare_stdout(void);
+
+/**
+ * @brief Get the error output of the selected state
+ *
+ * @return FILE* Error stream
+ */
+FILE *soare_stderr(void);
+
+/**
+ * @brief Get the error level of a given state
+ *
+ * @param state State to query
+ * @return int An integer error level
+ */
+int soare_state_errorlevel(soare_state_t *state);
+
+/**
+ * @brief Register a function called before a state releases its trees
+ *
+ * Hooks run at the start of `soare_kill()` and at the end of each
+ * `soare_state_execute_isolated()`, on the thread of the state, so that
+ * work started by the state (threads, ...) can end first. Hooks must be
+ * registered before any other thread uses the interpreter
+ *
+ * @param hook Function to call with the released state
+ * @return boolean_t Non-zero if registered
+ */
+boolean_t soare_state_on_release(void (*hook)(soare_state_t *state));
+
+/**
+ * @brief Run the release hooks of a state
+ *
+ * @param state Released state
+ */
+void soare_state_release(soare_state_t *state);
+
+/**
+ * @brief Set the step budget of a state
+ *
+ * A step is a loop iteration or a call of a defined function. Every
+ * `slice` steps, the slice hooks run (an async task gives the turn to
+ * the other tasks); after `limit` steps, a `TimeoutError` is raised by
+ * each following step. The count restarts at each execution of
+ * `soare_state_execute_isolated()`, and inherited states get the same
+ * budget
+ *
+ * @param state State to configure (NULL for the default state)
+ * @param slice Steps per slice (0 for none)
+ * @param limit Maximum number of steps (0 for none)
+ */
+void soare_state_budget(soare_state_t *state, unsigned long long slice, unsigned long long limit);
+
+/**
+ * @brief Register a function called at the end of each slice of steps
+ *
+ * Same rules as `soare_state_on_release()`
+ *
+ * @param hook Function to call with the running state
+ * @return boolean_t Non-zero if registered
+ */
+boolean_t soare_state_on_slice(void (*hook)(soare_state_t *state));
+
+/**
+ * @brief Check the budget of a state once `steps` reached `steps_next`
+ *
+ * @param state Running state
+ * @param file Location of the step, for errors
+ * @return boolean_t Non-zero if the code can go on
+ */
+boolean_t soare_state_slice(soare_state_t *state, document_t file);
+
+/**
+ * @brief Set the allocator of a state
+ *
+ * Must be called before the state allocates anything. Inherited
+ * states use the same allocator (which must then be thread-safe)
+ *
+ * @param state State to configure (NULL for the default state)
+ * @param allocator Allocator (copied), or NULL for malloc
+ */
+void soare_state_allocator(soare_state_t *state, const soare_allocator_t *allocator);
+
+/**
+ * @brief Limit the memory of a state
+ *
+ * Inherited states get the same quotas, each with its own usage
+ *
+ * @param state State to configure (NULL for the default state)
+ * @param category Category to limit, or SOARE_MEMORY_TOTAL for all of them
+ * @param bytes Maximum bytes in use (0 for no limit)
+ */
+void soare_state_quota(soare_state_t *state, soare_memory_t category, size_t bytes);
+
+/**
+ * @brief Get the memory usage of a state
+ *
+ * @param state State to query (NULL for the default state)
+ * @param category Category to query, or SOARE_MEMORY_TOTAL
+ * @return soare_memory_usage_t Usage
+ */
+soare_memory_usage_t soare_state_memory(const soare_state_t *state, soare_memory_t category);
+
+/**
+ * @brief Get the runtime counters of a state
+ *
+ * May be called from any thread, even while the state runs
+ *
+ * @param state State to query (NULL for the default state)
+ * @return soare_stats_t Counters since the creation of the state
+ */
+soare_stats_t soare_state_stats(const soare_state_t *state);
+
+/**
+ * @brief Get the runtime counters of the selected state
+ *
+ * @return soare_stats_t Counters since the creation of the state
+ */
+soare_stats_t soare_get_stats(void);
+
+#endif /* __SOARE_STATE_H__ */
\ No newline at end of file
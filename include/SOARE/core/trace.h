@@ -0,0 +1,81 @@
+#ifndef __SOARE_TRACE_H__
+#define __SOARE_TRACE_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <trace.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @brief Trace of the process (opaque)
+ */
+typedef struct soare_trace soare_trace_t;
+
+/**
+ * @brief Start tracing a state and the states it creates
+ *
+ * Tokenizing, parsing, imports, executions and calls are recorded as
+ * nested duration events, with the memory and the variables of the
+ * state as counters. Each thread records into its own buffer, kept
+ * until the trace is written
+ *
+ * @param state State, or NULL for the default state
+ * @return boolean_t Non-zero if started
+ */
+boolean_t soare_trace_start(soare_state_t *state);
+
+/**
+ * @brief Stop tracing a state
+ *
+ * The events stay buffered until `soare_trace_write()` or
+ * `soare_trace_clear()`
+ *
+ * @param state State, or NULL for the default state
+ */
+void soare_trace_stop(soare_state_t *state);
+
+/**
+ * @brief Write the events of all the threads as trace-event JSON
+ *
+ * Events still open are closed at the time of the call. The file is
+ * read by `chrome://tracing` and <https://ui.perfetto.dev/>
+ *
+ * @param file Output file
+ * @return unsigned long long Number of events written
+ */
+unsigned long long soare_trace_write(FILE *file);
+
+/**
+ * @brief Forget the buffered events
+ *
+ * No state must be traced anymore
+ */
+void soare_trace_clear(void);
+
+/**
+ * @brief Begin a duration event on the calling thread (interpreter)
+ *
+ * @param trace Trace of the selected state
+ * @param category Category of the event (static string)
+ * @param name Name of the event, or NULL
+ */
+void soare_trace_begin(soare_trace_t *trace, const char *category, const char *name);
+
+/**
+ * @brief End the last duration event of the calling thread (interpreter)
+ *
+ * @param trace Trace of the selected state
+ */
+void soare_trace_end(soare_trace_t *trace);
+
+#endif /* __SOARE_TRACE_H__ */
\ No newline at end of file
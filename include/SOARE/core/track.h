@@ -0,0 +1,133 @@
+#ifndef __SOARE_TRACK_H__
+#define __SOARE_TRACK_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <track.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Allocation tracking build (-D __SOARE_TRACK_ALLOCATIONS)
+ *
+ * The macros below replace the allocations of every file including
+ * SOARE.h (core, modules and interpreter), so that each block is
+ * recorded with its site (function and line of C code) and with the
+ * SOARE line running. Without the flag, nothing is recorded and the
+ * functions only report that tracking is disabled
+ *
+ */
+
+/**
+ * @brief Check if allocations are tracked
+ *
+ * @return boolean_t Non-zero in the tracking build
+ */
+boolean_t soare_track_enabled(void);
+
+/**
+ * @brief Write the allocations recorded since the start
+ *
+ * Lists the sites and the SOARE lines by allocated bytes, with their
+ * number of allocations, the blocks still alive and the average
+ * lifetime of the released blocks
+ *
+ * @param file Output file
+ * @return boolean_t Non-zero if allocations are tracked
+ */
+boolean_t soare_track_write(FILE *file);
+
+/**
+ * @brief Write the blocks alive now (heap snapshot)
+ *
+ * @param file Output file
+ * @return boolean_t Non-zero if allocations are tracked
+ */
+boolean_t soare_track_snapshot(FILE *file);
+
+/**
+ * @brief Set the SOARE line running on the calling thread (interpreter)
+ *
+ * @param line Location of the statement
+ */
+void soare_track_line(const document_t *line);
+
+/**
+ * @brief Record a block (tracking build)
+ *
+ * @param pointer Block, or NULL (not recorded)
+ * @param size Size in bytes
+ * @param function Allocating function
+ * @param line Allocating line of C code
+ * @return void* `pointer`
+ */
+void *soare_track_block(void *pointer, size_t size, const char *function, int line);
+
+/**
+ * @brief Record a string (tracking build)
+ *
+ * @param string String, or NULL (not recorded)
+ * @param function Allocating function
+ * @param line Allocating line of C code
+ * @return char* `string`
+ */
+char *soare_track_string(char *string, const char *function, int line);
+
+/**
+ * @brief Record a resized block (tracking build)
+ *
+ * @param previous Block before `realloc()`
+ * @param pointer Block after `realloc()`, or NULL (failed)
+ * @param size New size in bytes
+ * @param function Allocating function
+ * @param line Allocating line of C code
+ * @return void* `pointer`
+ */
+void *soare_track_resize(void *previous, void *pointer, size_t size, const char *function, int line);
+
+/**
+ * @brief Forget a block about to be released (tracking build)
+ *
+ * @param pointer Block, or NULL
+ */
+void soare_track_forget(void *pointer);
+
+/**
+ * @brief Forget and release a block of `malloc()` (tracking build)
+ *
+ * @param pointer Block, or NULL
+ */
+void soare_track_free(void *pointer);
+
+#if defined(__SOARE_TRACK_ALLOCATIONS) && !defined(__SOARE_TRACK_INTERNAL)
+
+/* The C library may define some of them as macros */
+#undef malloc
+#undef calloc
+#undef realloc
+#undef strdup
+#undef free
+
+#define malloc(__size) soare_track_block(malloc(__size), (__size), __func__, __LINE__)
+#define calloc(__count, __size) soare_track_block(calloc((__count), (__size)), (__count) * (__size), __func__, __LINE__)
+#define realloc(__pointer, __size) soare_track_resize((__pointer), realloc((__pointer), (__size)), (__size), __func__, __LINE__)
+#define strdup(__string) soare_track_string(strdup(__string), __func__, __LINE__)
+#define free(__pointer) soare_track_free(__pointer)
+
+#define soare_alloc(__category, __size) soare_track_block(soare_alloc((__category), (__size)), (__size), __func__, __LINE__)
+#define soare_strdup(__category, __string) soare_track_string(soare_strdup((__category), (__string)), __func__, __LINE__)
+#define soare_free(__pointer) (soare_track_forget(__pointer), soare_free(__pointer))
+
+#endif /* __SOARE_TRACK_ALLOCATIONS */
+
+#endif /* __SOARE_TRACK_H__ */
\ No newline at end of file
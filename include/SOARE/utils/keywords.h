@@ -27,6 +27,7 @@
 #define KEYWORD_FN          "fn"
 #define KEYWORD_IF          "if"
 #define KEYWORD_IFERROR     "iferror"
+#define KEYWORD_IN          "in"
 #define KEYWORD_LET         "let"
 #define KEYWORD_LOADIMPORT  "loadimport"
 #define KEYWORD_OR          "or"
@@ -34,5 +35,6 @@
 #define KEYWORD_RETURN      "return"
 #define KEYWORD_TRY         "try"
 #define KEYWORD_WHILE       "while"
+#define KEYWORD_YIELD       "yield"
 
 #endif /* __SOARE_KEYWORDS_H__ */
\ No newline at end of file
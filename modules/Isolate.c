@@ -0,0 +1,708 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif /* _WIN32 */
+
+#include <SOARE/SOARE.h>
+
+#include "isolate.h"
+#include "parallel.h"
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Isolate.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#ifndef _WIN32
+
+/* Default channel capacity */
+#define CHANNEL_CAPACITY 64
+/* Maximum channel capacity */
+#define CHANNEL_MAX_CAPACITY (1UL << 20)
+
+/**
+ * @brief Channel slot, owned by the operation whose turn it is
+ */
+typedef struct channel_cell
+{
+
+    unsigned long sequence; /**< Turn of the slot (atomic) */
+    char *value;            /**< Copied value              */
+
+} channel_cell_t;
+
+/**
+ * @brief Bounded multi-producer multi-consumer queue
+ *
+ * Values are exchanged without lock (Vyukov's bounded queue), the
+ * mutex only puts the waiting operations to sleep. The slots are a
+ * power of two, the requested capacity is enforced by `room`
+ */
+typedef struct channel
+{
+
+    unsigned long id;             /**< Handle number                     */
+    const soare_state_t *creator; /**< State closing it when released    */
+    channel_cell_t *cells;        /**< Slots                             */
+    unsigned long mask;           /**< Number of slots - 1               */
+    unsigned long enqueue;        /**< Next slot to fill (atomic)        */
+    unsigned long dequeue;        /**< Next slot to empty (atomic)       */
+    unsigned long room;           /**< Values that can be sent (atomic)  */
+    int closed;                   /**< No more operation (atomic)        */
+    int waiters;                  /**< Sleeping operations (atomic)      */
+    unsigned long references;     /**< Registry and operations (lock)    */
+    pthread_mutex_t lock;         /**< Protects the sleeping operations  */
+    pthread_cond_t changed;       /**< A value was sent or received      */
+    struct channel *next;         /**< Next open channel (lock)          */
+
+} channel_t;
+
+/**
+ * @brief Spawned task
+ */
+typedef struct isolate_task
+{
+
+    const soare_state_t *caller; /**< Spawning state, waits for the task */
+    char *function;              /**< Function name                      */
+    char **args;                 /**< Copied arguments                   */
+    unsigned int count;          /**< Number of arguments                */
+    boolean_t display;           /**< Display the exceptions of the task */
+    struct isolate_task *next;   /**< Next queued task (tasks lock)      */
+    struct isolate_task *live;   /**< Next unfinished task (tasks lock)  */
+
+} isolate_task_t;
+
+/* Protects the open channels and their references */
+static pthread_mutex_t channels_lock = PTHREAD_MUTEX_INITIALIZER;
+static channel_t *channels = NULL;
+static unsigned long channels_id = 0;
+
+/* Protects the tasks and the pool */
+static pthread_mutex_t tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tasks_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t tasks_done = PTHREAD_COND_INITIALIZER;
+
+/* Tasks waiting for a thread, oldest first */
+static isolate_task_t *tasks_first = NULL;
+static isolate_task_t *tasks_last = NULL;
+static unsigned long tasks_queued = 0;
+
+/* Unfinished tasks */
+static isolate_task_t *tasks_live = NULL;
+
+/* Threads waiting for a task */
+static unsigned long tasks_idle = 0;
+
+////////////////////////////////////////////////////////////
+static boolean_t channel_reserve(channel_t *channel)
+{
+    unsigned long room = __atomic_load_n(&channel->room, __ATOMIC_RELAXED);
+
+    do
+    {
+        if (!room)
+        {
+            // Requested capacity reached
+            return bFalse;
+        }
+
+    } while (!__atomic_compare_exchange_n(&channel->room, &room, room - 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t channel_push(channel_t *channel, char *value)
+{
+    if (!channel_reserve(channel))
+    {
+        return bFalse;
+    }
+
+    unsigned long position = __atomic_load_n(&channel->enqueue, __ATOMIC_RELAXED);
+
+    while (1)
+    {
+        channel_cell_t *cell = &channel->cells[position & channel->mask];
+        unsigned long sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        long difference = (long)(sequence - position);
+
+        if (difference < 0)
+        {
+            // Full: a receiver has not released its slot yet
+            __atomic_add_fetch(&channel->room, 1, __ATOMIC_RELAXED);
+            return bFalse;
+        }
+
+        if (!difference && __atomic_compare_exchange_n(&channel->enqueue, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            cell->value = value;
+            __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+            return bTrue;
+        }
+
+        if (difference)
+        {
+            position = __atomic_load_n(&channel->enqueue, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t channel_pop(channel_t *channel, char **value)
+{
+    unsigned long position = __atomic_load_n(&channel->dequeue, __ATOMIC_RELAXED);
+
+    while (1)
+    {
+        channel_cell_t *cell = &channel->cells[position & channel->mask];
+        unsigned long sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        long difference = (long)(sequence - (position + 1));
+
+        if (difference < 0)
+        {
+            // Empty
+            return bFalse;
+        }
+
+        if (!difference && __atomic_compare_exchange_n(&channel->dequeue, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            *value = cell->value;
+            __atomic_store_n(&cell->sequence, position + channel->mask + 1, __ATOMIC_RELEASE);
+            __atomic_add_fetch(&channel->room, 1, __ATOMIC_RELAXED);
+            return bTrue;
+        }
+
+        if (difference)
+        {
+            position = __atomic_load_n(&channel->dequeue, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void channel_wake(channel_t *channel)
+{
+    // Pairs with the check of the sleeping operations
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&channel->waiters, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&channel->lock);
+        pthread_cond_broadcast(&channel->changed);
+        pthread_mutex_unlock(&channel->lock);
+    }
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t channel_wait(channel_t *channel, boolean_t (*operation)(channel_t *, char **), char **value)
+{
+    /**
+     *
+     * Sleep until the operation succeeds or the channel is closed:
+     * the operation is tried again after announcing the wait, so a
+     * concurrent channel_wake() cannot be missed
+     *
+     */
+
+    boolean_t done = bFalse;
+
+    pthread_mutex_lock(&channel->lock);
+    __atomic_add_fetch(&channel->waiters, 1, __ATOMIC_SEQ_CST);
+
+    while (!(done = operation(channel, value)) && !__atomic_load_n(&channel->closed, __ATOMIC_SEQ_CST))
+    {
+        pthread_cond_wait(&channel->changed, &channel->lock);
+    }
+
+    __atomic_sub_fetch(&channel->waiters, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&channel->lock);
+
+    return done;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t channel_send(channel_t *channel, char **value)
+{
+    return channel_push(channel, *value);
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t channel_receive(channel_t *channel, char **value)
+{
+    return channel_pop(channel, value);
+}
+
+////////////////////////////////////////////////////////////
+static void channel_release(channel_t *channel)
+{
+    pthread_mutex_lock(&channels_lock);
+    unsigned long references = --channel->references;
+    pthread_mutex_unlock(&channels_lock);
+
+    if (references)
+    {
+        return;
+    }
+
+    char *value = NULL;
+
+    while (channel_pop(channel, &value))
+    {
+        free(value);
+    }
+
+    pthread_mutex_destroy(&channel->lock);
+    pthread_cond_destroy(&channel->changed);
+    free(channel->cells);
+    free(channel);
+}
+
+////////////////////////////////////////////////////////////
+static channel_t *channel_get(soare_arguments_list_t args)
+{
+    char *handle = soare_get_argument(args, 0);
+    unsigned long id = 0;
+
+    if (!handle)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, "ch", args ? args->file : soare_empty_document());
+        }
+
+        return NULL;
+    }
+
+    channel_t *channel = NULL;
+
+    if (sscanf(handle, "channel:%lu", &id) == 1)
+    {
+        pthread_mutex_lock(&channels_lock);
+
+        for (channel = channels; channel && channel->id != id; channel = channel->next)
+            ;
+
+        if (channel)
+        {
+            channel->references++;
+        }
+
+        pthread_mutex_unlock(&channels_lock);
+    }
+
+    if (!channel)
+    {
+        // Unknown or closed
+        soare_leave_exception(ValueError, handle, args->file);
+    }
+
+    free(handle);
+    return channel;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_channel(soare_arguments_list_t args)
+{
+    char *capacity = soare_get_argument(args, 0);
+    unsigned long size = capacity ? strtoul(capacity, NULL, 10) : CHANNEL_CAPACITY;
+    free(capacity);
+
+    if (!size || size > CHANNEL_MAX_CAPACITY)
+    {
+        soare_leave_exception(ValueError, "capacity", args ? args->file : soare_empty_document());
+        return NULL;
+    }
+
+    // Slots are a power of two (at least 2) to be indexed by a mask, room keeps the requested bound
+    unsigned long slots = 2;
+
+    while (slots < size)
+    {
+        slots *= 2;
+    }
+
+    channel_t *channel = (channel_t *)calloc(1, sizeof(channel_t));
+    channel_cell_t *cells = (channel_cell_t *)calloc(slots, sizeof(channel_cell_t));
+
+    if (!channel || !cells)
+    {
+        free(channel);
+        free(cells);
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    for (unsigned long i = 0; i < slots; i++)
+    {
+        cells[i].sequence = i;
+    }
+
+    channel->cells = cells;
+    channel->mask = slots - 1;
+    channel->room = size;
+    channel->creator = soare_state_current();
+    channel->references = 1;
+    pthread_mutex_init(&channel->lock, NULL);
+    pthread_cond_init(&channel->changed, NULL);
+
+    pthread_mutex_lock(&channels_lock);
+    channel->id = ++channels_id;
+    channel->next = channels;
+    channels = channel;
+    pthread_mutex_unlock(&channels_lock);
+
+    char handle[32];
+    snprintf(handle, sizeof(handle), "channel:%lu", channel->id);
+
+    return strdup(handle);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_send(soare_arguments_list_t args)
+{
+    channel_t *channel = channel_get(args);
+
+    if (!channel)
+    {
+        return NULL;
+    }
+
+    char *value = soare_get_argument(args, 1);
+
+    if (!value)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, "value", args->file);
+        }
+
+        channel_release(channel);
+        return NULL;
+    }
+
+    if (__atomic_load_n(&channel->closed, __ATOMIC_SEQ_CST) || (!channel_push(channel, value) && !channel_wait(channel, channel_send, &value)))
+    {
+        free(value);
+        soare_leave_exception(ValueError, "closed", args->file);
+    }
+    else
+    {
+        channel_wake(channel);
+    }
+
+    channel_release(channel);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_recv(soare_arguments_list_t args)
+{
+    channel_t *channel = channel_get(args);
+
+    if (!channel)
+    {
+        return NULL;
+    }
+
+    char *value = NULL;
+
+    // Values sent before the channel was closed are still received
+    if (!channel_pop(channel, &value) && !channel_wait(channel, channel_receive, &value))
+    {
+        soare_leave_exception(ValueError, "closed", args->file);
+    }
+    else
+    {
+        channel_wake(channel);
+    }
+
+    channel_release(channel);
+    return value;
+}
+
+////////////////////////////////////////////////////////////
+static void task_free(isolate_task_t *task)
+{
+    for (unsigned int i = 0; i < task->count; i++)
+    {
+        free(task->args[i]);
+    }
+
+    free(task->args);
+    free(task->function);
+    free(task);
+}
+
+////////////////////////////////////////////////////////////
+static void task_run(isolate_task_t *task)
+{
+    soare_state_t *state = soare_state_inherit(task->caller);
+
+    if (!state)
+    {
+        return;
+    }
+
+    // Nodes are counted by the state of the task
+    soare_state_select(state);
+    ast_t call = soare_new_node(task->function, NODE_CALL, soare_empty_document());
+
+    for (unsigned int i = task->count; call && i > 0; i--)
+    {
+        // Arguments are joined in front of each other
+        ast_t argument = soare_new_node(task->args[i - 1], NODE_VALUE, soare_empty_document());
+
+        if (!argument)
+        {
+            break;
+        }
+
+        argument->sibling = call->child;
+        argument->parent = call;
+        call->child = argument;
+    }
+
+    if (call)
+    {
+        soare_state_streams(state, task->caller->input, task->caller->output, task->caller->error);
+        soare_ignore_exception(!task->display);
+
+        free(soare_run_function(call));
+    }
+
+    soare_tree_free(call);
+    soare_state_free(state);
+}
+
+////////////////////////////////////////////////////////////
+static void *task_thread(void *unused)
+{
+    (void)unused;
+
+    pthread_mutex_lock(&tasks_lock);
+
+    while (1)
+    {
+        tasks_idle++;
+
+        while (!tasks_first)
+        {
+            pthread_cond_wait(&tasks_work, &tasks_lock);
+        }
+
+        tasks_idle--;
+
+        isolate_task_t *task = tasks_first;
+        tasks_first = task->next;
+        tasks_queued--;
+
+        if (!tasks_first)
+        {
+            tasks_last = NULL;
+        }
+
+        pthread_mutex_unlock(&tasks_lock);
+        task_run(task);
+        pthread_mutex_lock(&tasks_lock);
+
+        for (isolate_task_t **link = &tasks_live; *link; link = &(*link)->live)
+        {
+            if (*link == task)
+            {
+                *link = task->live;
+                break;
+            }
+        }
+
+        pthread_cond_broadcast(&tasks_done);
+        task_free(task);
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_spawn(soare_arguments_list_t args)
+{
+    char *function = parallel_function(args, 0);
+
+    if (!function)
+    {
+        return NULL;
+    }
+
+    isolate_task_t *task = (isolate_task_t *)calloc(1, sizeof(isolate_task_t));
+
+    if (!task)
+    {
+        free(function);
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    task->function = function;
+
+    for (ast_t arg = args->sibling; arg; arg = arg->sibling)
+    {
+        task->count++;
+    }
+
+    task->args = (char **)calloc(task->count + 1, sizeof(char *));
+
+    for (unsigned int i = 0; task->args && i < task->count; i++)
+    {
+        // Tasks only get copies
+        if (!(task->args[i] = soare_get_argument(args, i + 1)) && soare_errorlevel())
+        {
+            task_free(task);
+            return NULL;
+        }
+    }
+
+    if (!task->args)
+    {
+        task_free(task);
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    soare_share_functions();
+
+    task->caller = soare_state_current();
+    task->display = !soare_as_ignored_exception();
+
+    pthread_mutex_lock(&tasks_lock);
+
+    if (tasks_last)
+    {
+        tasks_last->next = task;
+    }
+    else
+    {
+        tasks_first = task;
+    }
+
+    tasks_last = task;
+    tasks_queued++;
+
+    task->live = tasks_live;
+    tasks_live = task;
+
+    // A task may wait for another one forever: never let it queue
+    // behind a busy thread
+    pthread_t thread;
+
+    if (tasks_queued > tasks_idle && !pthread_create(&thread, NULL, task_thread, NULL))
+    {
+        pthread_detach(thread);
+    }
+
+    pthread_cond_signal(&tasks_work);
+    pthread_mutex_unlock(&tasks_lock);
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+void isolate_release(soare_state_t *state)
+{
+    // Wake the tasks waiting on the channels of the state
+    pthread_mutex_lock(&channels_lock);
+
+    for (channel_t **link = &channels; *link;)
+    {
+        channel_t *channel = *link;
+
+        if (channel->creator != state)
+        {
+            link = &channel->next;
+            continue;
+        }
+
+        *link = channel->next;
+        __atomic_store_n(&channel->closed, 1, __ATOMIC_SEQ_CST);
+
+        pthread_mutex_lock(&channel->lock);
+        pthread_cond_broadcast(&channel->changed);
+        pthread_mutex_unlock(&channel->lock);
+
+        pthread_mutex_unlock(&channels_lock);
+        channel_release(channel);
+        pthread_mutex_lock(&channels_lock);
+
+        link = &channels;
+    }
+
+    pthread_mutex_unlock(&channels_lock);
+
+    // Then wait for its tasks
+    pthread_mutex_lock(&tasks_lock);
+
+    for (isolate_task_t *task = tasks_live; task;)
+    {
+        if (task->caller == state)
+        {
+            pthread_cond_wait(&tasks_done, &tasks_lock);
+            task = tasks_live;
+            continue;
+        }
+
+        task = task->live;
+    }
+
+    pthread_mutex_unlock(&tasks_lock);
+}
+
+#else
+
+////////////////////////////////////////////////////////////
+static char *isolate_unavailable(soare_arguments_list_t args)
+{
+    soare_leave_exception(InterpreterError, "not available on this platform", args ? args->file : soare_empty_document());
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_channel(soare_arguments_list_t args)
+{
+    return isolate_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_spawn(soare_arguments_list_t args)
+{
+    return isolate_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_send(soare_arguments_list_t args)
+{
+    return isolate_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_recv(soare_arguments_list_t args)
+{
+    return isolate_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+void isolate_release(soare_state_t *state)
+{
+    (void)state;
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,1520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif /* __linux__ */
+#else
+#include <windows.h>
+#endif /* _WIN32 */
+
+#include <SOARE/SOARE.h>
+
+#include "loop.h"
+#include "parallel.h"
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Loop.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+#ifndef _WIN32
+
+/* Task handle prefix */
+#define TASK_PREFIX "task:"
+/* Slots of a timing wheel level (2^WHEEL_BITS) */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+/* Levels of the timing wheel: 2^30 ms (about 12 days) */
+#define WHEEL_LEVELS 5
+/* Default size of fd_read() */
+#define LOOP_READ_SIZE 4096
+/* Events handled per wait */
+#define LOOP_EVENTS 64
+/* No deadline */
+#define LOOP_NEVER (~0ULL)
+
+/**
+ * @brief Life cycle of a task
+ */
+typedef enum loop_status
+{
+
+    TASK_READY,   /**< Queued to run      */
+    TASK_RUNNING, /**< Running            */
+    TASK_PARKED,  /**< Waiting for a wake */
+    TASK_DONE     /**< Body returned      */
+
+} loop_status_t;
+
+/**
+ * @brief Async task, or a wait outside of the tasks (no generator)
+ */
+typedef struct loop_task
+{
+
+    unsigned long id;               /**< Handle number                        */
+    char *generator;                /**< Generator handle, NULL for a waiter  */
+    unsigned long generator_id;     /**< Generator identifier                 */
+    loop_status_t status;           /**< Life cycle                           */
+    boolean_t display;              /**< Display the exceptions of the task   */
+    boolean_t closing;              /**< Closed: every wait fails             */
+
+    char *result;                   /**< Returned value, once done            */
+    boolean_t failed;               /**< Finished on an exception             */
+    soare_exceptions_t error;       /**< Its type                             */
+    unsigned long awaiters;         /**< Pending await() of the task          */
+    struct loop_task *waiters;      /**< Waiting for the task to finish       */
+    struct loop_task *awaited;      /**< Task this one is waiting for         */
+    struct loop_task *waiting;      /**< Next waiter of the same task         */
+
+    unsigned long long expires;     /**< Wake-up time of a sleep (ms)         */
+    struct loop_task **slot;        /**< Wheel slot of a sleep, or NULL       */
+    unsigned int level;             /**< Wheel level of the slot              */
+    struct loop_task *timer_prev;   /**< Previous timer of the slot           */
+    struct loop_task *timer_next;   /**< Next timer of the slot               */
+
+    int fd;                         /**< Descriptor waited for, or -1         */
+    boolean_t output;               /**< Waiting to write                     */
+    struct loop_task *watch_prev;   /**< Previous descriptor wait             */
+    struct loop_task *watch_next;   /**< Next descriptor wait                 */
+
+    struct loop_task *ready;        /**< Next task of the ready queue         */
+
+} loop_task_t;
+
+/**
+ * @brief Event loop of a state
+ */
+typedef struct loop
+{
+
+    const soare_state_t *state;                     /**< Owner                              */
+    loop_task_t **tasks;                            /**< Tasks by handle number, or NULL    */
+    unsigned long tasks_size;                       /**< Capacity of the tasks              */
+    unsigned long tasks_id;                         /**< Last handle number                 */
+    unsigned long live;                             /**< Unfinished tasks                   */
+    loop_task_t *current;                           /**< Task resumed by the loop           */
+    loop_task_t *ready_first;                       /**< Ready queue, oldest first          */
+    loop_task_t *ready_last;                        /**< Newest ready task                  */
+
+    loop_task_t *wheel[WHEEL_LEVELS][WHEEL_SLOTS];  /**< Sleeping tasks                     */
+    unsigned long timers[WHEEL_LEVELS];             /**< Sleeping tasks per level           */
+    unsigned long long now;                         /**< Next tick of the wheel (ms)        */
+
+    loop_task_t *watched;                           /**< Descriptor waits                   */
+    unsigned long watching;                         /**< Number of descriptor waits         */
+    int epoll;                                      /**< epoll instance, or -1              */
+
+    struct loop *next;                              /**< Next loop                          */
+
+} loop_t;
+
+/* Protects the loops */
+static pthread_mutex_t loops_lock = PTHREAD_MUTEX_INITIALIZER;
+static loop_t *loops = NULL;
+
+////////////////////////////////////////////////////////////
+static unsigned long long loop_clock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (unsigned long long)now.tv_sec * 1000ULL + (unsigned long long)now.tv_nsec / 1000000ULL;
+}
+
+////////////////////////////////////////////////////////////
+static loop_t *loop_get(boolean_t create)
+{
+    const soare_state_t *state = soare_state_current();
+
+    pthread_mutex_lock(&loops_lock);
+
+    loop_t *loop = loops;
+
+    while (loop && loop->state != state)
+    {
+        loop = loop->next;
+    }
+
+    if (!loop && create && (loop = (loop_t *)calloc(1, sizeof(loop_t))))
+    {
+        loop->state = state;
+        loop->now = loop_clock();
+        loop->epoll = -1;
+        loop->next = loops;
+        loops = loop;
+    }
+
+    pthread_mutex_unlock(&loops_lock);
+
+    if (!loop && create)
+    {
+        SOARE_OUT_OF_MEMORY();
+    }
+
+    return loop;
+}
+
+////////////////////////////////////////////////////////////
+static loop_task_t *loop_self(loop_t *loop)
+{
+    // Only the body of the task itself (not a generator it runs) parks
+    loop_task_t *task = loop->current;
+    return task && task->generator_id == soare_generator_running() ? task : NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void loop_wake(loop_t *loop, loop_task_t *task)
+{
+    if (task->status != TASK_PARKED)
+    {
+        return;
+    }
+
+    task->status = TASK_READY;
+
+    if (!task->generator)
+    {
+        // A wait outside of the tasks checks its status
+        return;
+    }
+
+    task->ready = NULL;
+
+    if (loop->ready_last)
+    {
+        loop->ready_last->ready = task;
+    }
+    else
+    {
+        loop->ready_first = task;
+    }
+
+    loop->ready_last = task;
+}
+
+/**
+ *
+ * Timing wheel
+ *
+ * Sleeping tasks are kept in a hierarchical timing wheel: level L has
+ * 64 slots of 64^L ticks (milliseconds). A timer goes to the lowest
+ * level where its expiration and the current tick only differ by the
+ * bits of that level, so that its slot is always ahead of the current
+ * one. When the current tick reaches the start of a slot of an upper
+ * level, the slot is emptied into the lower levels (cascade)
+ *
+ * Adding or removing a timer is constant time, whatever the number of
+ * sleeping tasks, and a timer is only moved once per level
+ *
+ */
+
+////////////////////////////////////////////////////////////
+static void wheel_insert(loop_t *loop, loop_task_t *task)
+{
+    unsigned long long expires = task->expires > loop->now ? task->expires : loop->now;
+    unsigned long long difference = expires ^ loop->now;
+    unsigned int level = 0;
+
+    while (level < WHEEL_LEVELS - 1 && (difference >> (WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+
+    unsigned long long index = expires >> (WHEEL_BITS * level);
+
+    if (difference >> (WHEEL_BITS * WHEEL_LEVELS))
+    {
+        // Beyond the wheel: wait in its last slot, placed again when cascaded
+        index = (loop->now >> (WHEEL_BITS * level)) + WHEEL_MASK;
+    }
+
+    task->level = level;
+    task->slot = &loop->wheel[level][index & WHEEL_MASK];
+    task->timer_prev = NULL;
+    task->timer_next = *task->slot;
+
+    if (task->timer_next)
+    {
+        task->timer_next->timer_prev = task;
+    }
+
+    *task->slot = task;
+    loop->timers[level]++;
+}
+
+////////////////////////////////////////////////////////////
+static void wheel_remove(loop_t *loop, loop_task_t *task)
+{
+    if (!task->slot)
+    {
+        return;
+    }
+
+    if (task->timer_prev)
+    {
+        task->timer_prev->timer_next = task->timer_next;
+    }
+    else
+    {
+        *task->slot = task->timer_next;
+    }
+
+    if (task->timer_next)
+    {
+        task->timer_next->timer_prev = task->timer_prev;
+    }
+
+    loop->timers[task->level]--;
+    task->slot = NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void wheel_advance(loop_t *loop, unsigned long long now)
+{
+    while (loop->now <= now)
+    {
+        unsigned long timers = 0;
+
+        for (unsigned int level = 0; level < WHEEL_LEVELS; level++)
+        {
+            timers += loop->timers[level];
+        }
+
+        if (!timers)
+        {
+            // Nothing to move: jump
+            loop->now = now + 1;
+            return;
+        }
+
+        // Slots starting at this tick move down
+        for (unsigned int level = 1; level < WHEEL_LEVELS && !(loop->now & ((1ULL << (WHEEL_BITS * level)) - 1)); level++)
+        {
+            loop_task_t **slot = &loop->wheel[level][(loop->now >> (WHEEL_BITS * level)) & WHEEL_MASK];
+
+            while (*slot)
+            {
+                loop_task_t *task = *slot;
+                wheel_remove(loop, task);
+                wheel_insert(loop, task);
+            }
+        }
+
+        loop_task_t **slot = &loop->wheel[0][loop->now & WHEEL_MASK];
+
+        while (*slot)
+        {
+            loop_task_t *task = *slot;
+            wheel_remove(loop, task);
+            loop_wake(loop, task);
+        }
+
+        loop->now++;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static unsigned long long wheel_next(loop_t *loop)
+{
+    // Next expiration, or next cascade of an upper level
+    unsigned long long next = LOOP_NEVER;
+
+    for (unsigned int level = 0; level < WHEEL_LEVELS; level++)
+    {
+        if (!loop->timers[level])
+        {
+            continue;
+        }
+
+        unsigned int shift = WHEEL_BITS * level;
+        unsigned long long base = loop->now >> shift;
+
+        // The current slot of an upper level is only filled until its
+        // cascade, due at the current tick
+        for (unsigned long long i = 0; i < WHEEL_SLOTS; i++)
+        {
+            if (loop->wheel[level][(base + i) & WHEEL_MASK])
+            {
+                unsigned long long tick = (base + i) << shift;
+                next = tick < next ? tick : next;
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+////////////////////////////////////////////////////////////
+static int loop_watch(loop_t *loop, loop_task_t *task, int fd, boolean_t output)
+{
+#ifdef __linux__
+
+    if (loop->epoll < 0 && (loop->epoll = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        return -1;
+    }
+
+    struct epoll_event event = {0};
+    event.events = output ? EPOLLOUT : EPOLLIN;
+    event.data.ptr = task;
+
+    if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, fd, &event))
+    {
+        // Regular files are always ready
+        return errno == EPERM ? 0 : -1;
+    }
+
+#else
+
+    struct stat info;
+
+    if (fstat(fd, &info))
+    {
+        return -1;
+    }
+
+    if (S_ISREG(info.st_mode))
+    {
+        // Regular files are always ready
+        return 0;
+    }
+
+    for (loop_task_t *other = loop->watched; other; other = other->watch_next)
+    {
+        if (other->fd == fd)
+        {
+            // Like epoll: one wait per descriptor
+            errno = EEXIST;
+            return -1;
+        }
+    }
+
+#endif /* __linux__ */
+
+    task->fd = fd;
+    task->output = output;
+    task->watch_prev = NULL;
+    task->watch_next = loop->watched;
+
+    if (loop->watched)
+    {
+        loop->watched->watch_prev = task;
+    }
+
+    loop->watched = task;
+    loop->watching++;
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////
+static void loop_unwatch(loop_t *loop, loop_task_t *task)
+{
+    if (task->fd < 0)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    // Fails if the descriptor was closed meanwhile (already removed)
+    epoll_ctl(loop->epoll, EPOLL_CTL_DEL, task->fd, NULL);
+#endif /* __linux__ */
+
+    if (task->watch_prev)
+    {
+        task->watch_prev->watch_next = task->watch_next;
+    }
+    else
+    {
+        loop->watched = task->watch_next;
+    }
+
+    if (task->watch_next)
+    {
+        task->watch_next->watch_prev = task->watch_prev;
+    }
+
+    task->fd = -1;
+    loop->watching--;
+}
+
+////////////////////////////////////////////////////////////
+static void loop_poll(loop_t *loop, long long timeout)
+{
+    int milliseconds = timeout < 0 || timeout > INT_MAX ? (timeout < 0 ? -1 : INT_MAX) : (int)timeout;
+
+    if (!loop->watching)
+    {
+        // Only sleeping
+        if (milliseconds > 0)
+        {
+            poll(NULL, 0, milliseconds);
+        }
+
+        return;
+    }
+
+#ifdef __linux__
+
+    struct epoll_event events[LOOP_EVENTS];
+    int count = epoll_wait(loop->epoll, events, LOOP_EVENTS, milliseconds);
+
+    for (int i = 0; i < count; i++)
+    {
+        loop_task_t *task = (loop_task_t *)events[i].data.ptr;
+        loop_unwatch(loop, task);
+        loop_wake(loop, task);
+    }
+
+#else
+
+    struct pollfd *fds = (struct pollfd *)calloc(loop->watching, sizeof(struct pollfd));
+    loop_task_t **tasks = (loop_task_t **)calloc(loop->watching, sizeof(loop_task_t *));
+    unsigned long count = 0;
+
+    if (!fds || !tasks)
+    {
+        free(fds);
+        free(tasks);
+        return;
+    }
+
+    for (loop_task_t *task = loop->watched; task; task = task->watch_next)
+    {
+        fds[count].fd = task->fd;
+        fds[count].events = task->output ? POLLOUT : POLLIN;
+        tasks[count++] = task;
+    }
+
+    if (poll(fds, (nfds_t)count, milliseconds) > 0)
+    {
+        for (unsigned long i = 0; i < count; i++)
+        {
+            if (fds[i].revents)
+            {
+                loop_unwatch(loop, tasks[i]);
+                loop_wake(loop, tasks[i]);
+            }
+        }
+    }
+
+    free(fds);
+    free(tasks);
+
+#endif /* __linux__ */
+}
+
+////////////////////////////////////////////////////////////
+static void loop_finish(loop_t *loop, loop_task_t *task)
+{
+    task->status = TASK_DONE;
+    loop->live--;
+
+    free(task->generator);
+    task->generator = NULL;
+
+    while (task->waiters)
+    {
+        loop_task_t *waiter = task->waiters;
+        task->waiters = waiter->waiting;
+        waiter->awaited = NULL;
+        loop_wake(loop, waiter);
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void loop_run(loop_t *loop, loop_task_t *task)
+{
+    soare_state_t *state = soare_state_current();
+
+    loop_task_t *current = loop->current;
+    boolean_t display = state->error_display;
+    char *value = NULL;
+
+    task->status = TASK_RUNNING;
+    loop->current = task;
+
+    state->error_display = task->display;
+    boolean_t suspended = soare_generator_next(task->generator, &value, soare_empty_document());
+    state->error_display = display;
+
+    loop->current = current;
+
+    if (suspended)
+    {
+        free(value);
+
+        if (task->status == TASK_RUNNING)
+        {
+            // `yield` from the body of the task: run the others first
+            task->status = TASK_PARKED;
+            loop_wake(loop, task);
+        }
+
+        return;
+    }
+
+    task->result = value;
+
+    if (soare_errorlevel())
+    {
+        // Kept for await()
+        task->failed = bTrue;
+        task->error = soare_get_exception_type();
+        soare_clear_exception();
+    }
+
+    loop_finish(loop, task);
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t loop_step(loop_t *loop, unsigned long long deadline)
+{
+    // Tasks made ready while these run wait for the next step
+    loop_task_t *last = loop->ready_last;
+
+    while (last && loop->ready_first)
+    {
+        loop_task_t *task = loop->ready_first;
+        loop->ready_first = task->ready;
+
+        if (!loop->ready_first)
+        {
+            loop->ready_last = NULL;
+        }
+
+        loop_run(loop, task);
+
+        if (task == last)
+        {
+            break;
+        }
+    }
+
+    long long timeout = 0;
+
+    if (!loop->ready_first)
+    {
+        unsigned long long now = loop_clock();
+        unsigned long long next = wheel_next(loop);
+
+        next = deadline < next ? deadline : next;
+
+        if (next == LOOP_NEVER && !loop->watching)
+        {
+            // Nothing can happen anymore
+            return last != NULL;
+        }
+
+        timeout = next == LOOP_NEVER ? -1 : (next > now ? (long long)(next - now) : 0);
+    }
+
+    loop_poll(loop, timeout);
+    wheel_advance(loop, loop_clock());
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t loop_wait(loop_t *loop, loop_task_t *waiter)
+{
+    /**
+     *
+     * The waiter is parked and registered (timer, descriptor or
+     * awaited task). A task gives its turn back to the loop, anything
+     * else runs the loop until the waiter is woken
+     *
+     */
+
+    if (waiter->generator)
+    {
+        return !waiter->closing && soare_generator_yield(NULL);
+    }
+
+    while (waiter->status == TASK_PARKED && loop_step(loop, LOOP_NEVER))
+        ;
+
+    return waiter->status != TASK_PARKED;
+}
+
+////////////////////////////////////////////////////////////
+static boolean_t loop_io(loop_t *loop, int fd, boolean_t output, document_t file)
+{
+    loop_task_t local = {0};
+    loop_task_t *waiter = loop_self(loop);
+
+    if (!waiter)
+    {
+        waiter = &local;
+        waiter->fd = -1;
+    }
+
+    int watched = loop_watch(loop, waiter, fd, output);
+
+    if (watched <= 0)
+    {
+        if (watched < 0)
+        {
+            // Invalid, or already waited for
+            char descriptor[24];
+            snprintf(descriptor, sizeof(descriptor), "%d", fd);
+            soare_leave_exception(ValueError, descriptor, file);
+        }
+
+        return !watched;
+    }
+
+    waiter->status = TASK_PARKED;
+
+    if (!loop_wait(loop, waiter))
+    {
+        loop_unwatch(loop, waiter);
+        return bFalse;
+    }
+
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+static loop_task_t *loop_find(loop_t *loop, char *handle)
+{
+    size_t length = strlen(TASK_PREFIX);
+    char *end = NULL;
+    unsigned long id = 0;
+
+    if (loop && handle && !strncmp(handle, TASK_PREFIX, length))
+    {
+        id = strtoul(handle + length, &end, 10);
+    }
+
+    if (!id || *end || id > loop->tasks_id)
+    {
+        return NULL;
+    }
+
+    return loop->tasks[id - 1];
+}
+
+////////////////////////////////////////////////////////////
+static void loop_forget(loop_t *loop, loop_task_t *task)
+{
+    loop->tasks[task->id - 1] = NULL;
+
+    free(task->generator);
+    free(task->result);
+    free(task);
+}
+
+////////////////////////////////////////////////////////////
+static void loop_close(loop_t *loop, loop_task_t *task)
+{
+    if (task->status == TASK_READY)
+    {
+        for (loop_task_t **link = &loop->ready_first; *link; link = &(*link)->ready)
+        {
+            if (*link == task)
+            {
+                *link = task->ready;
+                break;
+            }
+        }
+
+        for (loop->ready_last = loop->ready_first; loop->ready_last && loop->ready_last->ready;)
+        {
+            loop->ready_last = loop->ready_last->ready;
+        }
+    }
+
+    wheel_remove(loop, task);
+    loop_unwatch(loop, task);
+
+    if (task->awaited)
+    {
+        for (loop_task_t **link = &task->awaited->waiters; *link; link = &(*link)->waiting)
+        {
+            if (*link == task)
+            {
+                *link = task->waiting;
+                break;
+            }
+        }
+
+        task->awaited = NULL;
+    }
+
+    // Its waits fail until the body returned
+    loop_task_t *current = loop->current;
+
+    task->closing = bTrue;
+    task->status = TASK_RUNNING;
+    loop->current = task;
+
+    soare_generator_close(task->generator);
+
+    loop->current = current;
+    loop_finish(loop, task);
+}
+
+////////////////////////////////////////////////////////////
+void loop_release(soare_state_t *state)
+{
+    loop_t *loop = loop_get(bFalse);
+
+    if (!loop || loop->state != state)
+    {
+        return;
+    }
+
+    // Finish the tasks, unless the program failed
+    while (loop->live && !soare_errorlevel() && loop_step(loop, LOOP_NEVER))
+        ;
+
+    for (unsigned long i = 0; i < loop->tasks_id; i++)
+    {
+        if (loop->tasks[i] && loop->tasks[i]->status != TASK_DONE)
+        {
+            loop_close(loop, loop->tasks[i]);
+        }
+    }
+
+    for (unsigned long i = 0; i < loop->tasks_id; i++)
+    {
+        if (loop->tasks[i])
+        {
+            loop_forget(loop, loop->tasks[i]);
+        }
+    }
+
+    pthread_mutex_lock(&loops_lock);
+
+    for (loop_t **link = &loops; *link; link = &(*link)->next)
+    {
+        if (*link == loop)
+        {
+            *link = loop->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&loops_lock);
+
+    if (loop->epoll >= 0)
+    {
+        close(loop->epoll);
+    }
+
+    free(loop->tasks);
+    free(loop);
+}
+
+////////////////////////////////////////////////////////////
+void loop_slice(soare_state_t *state)
+{
+    loop_t *loop = loop_get(bFalse);
+    loop_task_t *task = loop ? loop_self(loop) : NULL;
+
+    if (!task)
+    {
+        return;
+    }
+
+    // Preempted as by `yield`, possibly while returning
+    boolean_t returned = state->returned;
+
+    if (soare_generator_yield(NULL))
+    {
+        state->returned = returned;
+    }
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_sleep(soare_arguments_list_t args)
+{
+    char *seconds = soare_get_argument(args, 0);
+
+    if (!seconds)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, "seconds", args ? args->file : soare_empty_document());
+        }
+
+        return NULL;
+    }
+
+    double value = strtod(seconds, NULL);
+    free(seconds);
+
+    // About 3 centuries at most
+    unsigned long long milliseconds = value > 0 ? (unsigned long long)((value < 1e13 ? value : 1e13) * 1000.0 + 0.5) : 0;
+
+    loop_t *loop = loop_get(bTrue);
+
+    if (!loop)
+    {
+        return NULL;
+    }
+
+    loop_task_t *self = loop_self(loop);
+
+    if (!self)
+    {
+        unsigned long long deadline = loop_clock() + milliseconds;
+
+        // At least one step: sleep(0) lets the ready tasks run
+        do
+        {
+            loop_step(loop, deadline);
+        } while (loop_clock() < deadline && !soare_errorlevel());
+
+        return NULL;
+    }
+
+    self->status = TASK_PARKED;
+
+    if (milliseconds)
+    {
+        self->expires = loop_clock() + milliseconds;
+        wheel_insert(loop, self);
+    }
+    else
+    {
+        // Behind the ready tasks
+        loop_wake(loop, self);
+    }
+
+    if (!loop_wait(loop, self))
+    {
+        wheel_remove(loop, self);
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_async(soare_arguments_list_t args)
+{
+    loop_t *loop = loop_get(bTrue);
+    char *function = loop ? parallel_function(args, 0) : NULL;
+
+    if (!function)
+    {
+        return NULL;
+    }
+
+    ast_t call = soare_new_node(function, NODE_CALL, args->file);
+    ast_t last = NULL;
+    free(function);
+
+    for (ast_t arg = args->sibling; call && arg; arg = arg->sibling)
+    {
+        // Evaluated by the caller
+        char *value = soare_get_argument(arg, 0);
+
+        if (!value && soare_errorlevel())
+        {
+            soare_tree_free(call);
+            return NULL;
+        }
+
+        ast_t argument = soare_new_node(value, NODE_VALUE, arg->file);
+        free(value);
+
+        if (!argument)
+        {
+            soare_tree_free(call);
+            return NULL;
+        }
+
+        argument->parent = call;
+
+        if (last)
+        {
+            last->sibling = argument;
+        }
+        else
+        {
+            call->child = argument;
+        }
+
+        last = argument;
+    }
+
+    if (!call)
+    {
+        return NULL;
+    }
+
+    if (loop->tasks_id >= loop->tasks_size)
+    {
+        unsigned long size = loop->tasks_size ? loop->tasks_size * 2 : 64;
+        loop_task_t **tasks = (loop_task_t **)realloc(loop->tasks, size * sizeof(loop_task_t *));
+
+        if (!tasks)
+        {
+            soare_tree_free(call);
+            SOARE_OUT_OF_MEMORY();
+            return NULL;
+        }
+
+        loop->tasks = tasks;
+        loop->tasks_size = size;
+    }
+
+    loop_task_t *task = (loop_task_t *)calloc(1, sizeof(loop_task_t));
+    char *handle = (char *)malloc(sizeof(TASK_PREFIX) + 20);
+
+    if (!task || !handle)
+    {
+        free(task);
+        free(handle);
+        soare_tree_free(call);
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    // Nothing runs until the caller waits
+    task->generator = soare_generator_call(call);
+    soare_tree_free(call);
+
+    if (!task->generator)
+    {
+        free(task);
+        free(handle);
+        return NULL;
+    }
+
+    sscanf(task->generator, "generator:%lu", &task->generator_id);
+
+    task->id = ++loop->tasks_id;
+    task->fd = -1;
+    task->display = !soare_as_ignored_exception();
+    task->status = TASK_PARKED;
+
+    loop->tasks[task->id - 1] = task;
+    loop->live++;
+    loop_wake(loop, task);
+
+    sprintf(handle, TASK_PREFIX "%lu", task->id);
+    return handle;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_await(soare_arguments_list_t args)
+{
+    char *handle = soare_get_argument(args, 0);
+
+    if (!handle)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, "task", args ? args->file : soare_empty_document());
+        }
+
+        return NULL;
+    }
+
+    loop_t *loop = loop_get(bFalse);
+    loop_task_t *task = loop_find(loop, handle);
+    loop_task_t *self = task ? loop_self(loop) : NULL;
+
+    if (!task || task == self)
+    {
+        // Unknown, already awaited, or itself
+        soare_leave_exception(ValueError, handle, args->file);
+        free(handle);
+        return NULL;
+    }
+
+    task->awaiters++;
+
+    if (task->status != TASK_DONE)
+    {
+        loop_task_t local = {0};
+        loop_task_t *waiter = self ? self : &local;
+
+        waiter->status = TASK_PARKED;
+        waiter->awaited = task;
+        waiter->waiting = task->waiters;
+        task->waiters = waiter;
+
+        if (!loop_wait(loop, waiter))
+        {
+            for (loop_task_t **link = &task->waiters; *link; link = &(*link)->waiting)
+            {
+                if (*link == waiter)
+                {
+                    *link = waiter->waiting;
+                    break;
+                }
+            }
+
+            waiter->awaited = NULL;
+            task->awaiters--;
+
+            if (!self)
+            {
+                // Waiting for each other
+                soare_leave_exception(ValueError, handle, args->file);
+            }
+
+            free(handle);
+            return NULL;
+        }
+    }
+
+    boolean_t failed = task->failed;
+    soare_exceptions_t error = task->error;
+    char *result = task->result;
+
+    if (--task->awaiters)
+    {
+        result = result ? strdup(result) : NULL;
+    }
+    else
+    {
+        task->result = NULL;
+        loop_forget(loop, task);
+    }
+
+    if (failed)
+    {
+        // Already displayed by the task
+        boolean_t ignored = soare_as_ignored_exception();
+        soare_ignore_exception(bTrue);
+        soare_leave_exception(error, handle, args->file);
+        soare_ignore_exception(ignored);
+
+        free(result);
+        result = NULL;
+    }
+
+    free(handle);
+    return result;
+}
+
+////////////////////////////////////////////////////////////
+static int loop_descriptor(soare_arguments_list_t args)
+{
+    char *value = soare_get_argument(args, 0);
+
+    if (!value)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, "fd", args ? args->file : soare_empty_document());
+        }
+
+        return -1;
+    }
+
+    char *end = NULL;
+    long fd = strtol(value, &end, 10);
+
+    if (end == value || *end || fd < 0 || fd > INT_MAX)
+    {
+        soare_leave_exception(ValueError, value, args->file);
+        fd = -1;
+    }
+
+    free(value);
+    return (int)fd;
+}
+
+////////////////////////////////////////////////////////////
+static char *loop_number(long value)
+{
+    char number[24];
+    snprintf(number, sizeof(number), "%ld", value);
+    return strdup(number);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_open(soare_arguments_list_t args)
+{
+    char *path = soare_get_argument(args, 0);
+
+    if (!path)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, "path", args ? args->file : soare_empty_document());
+        }
+
+        return NULL;
+    }
+
+    char *mode = soare_get_argument(args, 1);
+    int flags = -1;
+
+    if (!mode || !strcmp(mode, "r"))
+    {
+        flags = O_RDONLY;
+    }
+    else if (!strcmp(mode, "w"))
+    {
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+    }
+    else if (!strcmp(mode, "a"))
+    {
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+    }
+
+    char *result = NULL;
+
+    if (flags < 0)
+    {
+        soare_leave_exception(ValueError, mode, args->file);
+    }
+    else if (!soare_errorlevel())
+    {
+        // Pipes and FIFOs never block the thread
+        int fd = open(path, flags | O_NONBLOCK | O_CLOEXEC, 0644);
+
+        if (fd < 0)
+        {
+            soare_leave_exception(FileError, path, args->file);
+        }
+        else
+        {
+            result = loop_number(fd);
+        }
+    }
+
+    free(path);
+    free(mode);
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_pipe(soare_arguments_list_t args)
+{
+    // Variables are passed by name, like an assignment
+    soare_arguments_list_t names[2] = {args, args ? args->sibling : NULL};
+    soare_variables_t *variables[2] = {NULL, NULL};
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (!names[i])
+        {
+            soare_leave_exception(MissingArgument, i ? "writer" : "reader", args ? args->file : soare_empty_document());
+            return NULL;
+        }
+
+        if (names[i]->type != NODE_MEMGET && names[i]->type != NODE_MEMGET_SLOT)
+        {
+            soare_leave_exception(ValueError, names[i]->value ? names[i]->value : "", names[i]->file);
+            return NULL;
+        }
+
+        if (!(variables[i] = soare_get_variable(names[i]->value)))
+        {
+            soare_leave_exception(UndefinedReference, names[i]->value, names[i]->file);
+            return NULL;
+        }
+
+        if (variables[i]->body || !variables[i]->mutable)
+        {
+            soare_leave_exception(variables[i]->body ? VariableDefinedAsFunction : AssignConstantVariable, names[i]->value, names[i]->file);
+            return NULL;
+        }
+    }
+
+    int fds[2];
+
+    if (pipe(fds))
+    {
+        soare_leave_exception(FileError, "pipe", args->file);
+        return NULL;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+
+        soare_set_value(variables[i], loop_number(fds[i]));
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_read(soare_arguments_list_t args)
+{
+    int fd = loop_descriptor(args);
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    char *size = soare_get_argument(args, 1);
+    long bytes = size ? strtol(size, NULL, 10) : LOOP_READ_SIZE;
+    free(size);
+
+    if (bytes <= 0)
+    {
+        soare_leave_exception(ValueError, "size", args->file);
+        return NULL;
+    }
+
+    loop_t *loop = loop_get(bTrue);
+    char *buffer = loop ? (char *)malloc((size_t)bytes + 1) : NULL;
+
+    if (!buffer)
+    {
+        if (loop)
+        {
+            SOARE_OUT_OF_MEMORY();
+        }
+
+        return NULL;
+    }
+
+    // Inherited descriptors may block: wait before reading them
+    int flags = fcntl(fd, F_GETFL);
+    boolean_t ready = flags >= 0 && (flags & O_NONBLOCK);
+
+    while (1)
+    {
+        if (!ready && !loop_io(loop, fd, bFalse, args->file))
+        {
+            break;
+        }
+
+        ssize_t count = read(fd, buffer, (size_t)bytes);
+
+        if (count >= 0)
+        {
+            buffer[count] = 0;
+            return buffer;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            char descriptor[24];
+            snprintf(descriptor, sizeof(descriptor), "%d", fd);
+            soare_leave_exception(FileError, descriptor, args->file);
+            break;
+        }
+
+        ready = errno == EINTR;
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_write(soare_arguments_list_t args)
+{
+    int fd = loop_descriptor(args);
+    loop_t *loop = fd >= 0 ? loop_get(bTrue) : NULL;
+
+    if (!loop)
+    {
+        return NULL;
+    }
+
+    if (fd == STDOUT_FILENO)
+    {
+        // Keep the order with write()
+        fflush(stdout);
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    boolean_t blocking = flags >= 0 && !(flags & O_NONBLOCK);
+
+    for (ast_t arg = args->sibling; arg && !soare_errorlevel(); arg = arg->sibling)
+    {
+        char *value = soare_get_argument(arg, 0);
+        size_t length = value ? strlen(value) : 0;
+        size_t written = 0;
+
+        while (written < length)
+        {
+            // A ready pipe takes at least PIPE_BUF bytes without blocking
+            size_t chunk = blocking && length - written > PIPE_BUF ? PIPE_BUF : length - written;
+
+            if (blocking && !loop_io(loop, fd, bTrue, args->file))
+            {
+                break;
+            }
+
+            ssize_t count = write(fd, value + written, chunk);
+
+            if (count >= 0)
+            {
+                written += (size_t)count;
+                continue;
+            }
+
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) || !loop_io(loop, fd, bTrue, args->file))
+            {
+                if (!soare_errorlevel())
+                {
+                    char descriptor[24];
+                    snprintf(descriptor, sizeof(descriptor), "%d", fd);
+                    soare_leave_exception(FileError, descriptor, args->file);
+                }
+
+                break;
+            }
+        }
+
+        free(value);
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_close(soare_arguments_list_t args)
+{
+    int fd = loop_descriptor(args);
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    loop_t *loop = loop_get(bFalse);
+
+    for (loop_task_t *task = loop ? loop->watched : NULL; task;)
+    {
+        loop_task_t *next = task->watch_next;
+
+        if (task->fd == fd)
+        {
+            // Its read or write fails
+            loop_unwatch(loop, task);
+            loop_wake(loop, task);
+        }
+
+        task = next;
+    }
+
+    if (close(fd))
+    {
+        soare_leave_exception(ValueError, "fd", args->file);
+    }
+
+    return NULL;
+}
+
+#else
+
+////////////////////////////////////////////////////////////
+static char *loop_unavailable(soare_arguments_list_t args)
+{
+    soare_leave_exception(InterpreterError, "not available on this platform", args ? args->file : soare_empty_document());
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_sleep(soare_arguments_list_t args)
+{
+    char *seconds = soare_get_argument(args, 0);
+
+    if (!seconds)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, "seconds", args ? args->file : soare_empty_document());
+        }
+
+        return NULL;
+    }
+
+    double value = strtod(seconds, NULL);
+    free(seconds);
+
+    // No tasks to run meanwhile
+    Sleep(value > 0 ? (DWORD)(value * 1000.0 + 0.5) : 0);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_async(soare_arguments_list_t args)
+{
+    return loop_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_await(soare_arguments_list_t args)
+{
+    return loop_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_open(soare_arguments_list_t args)
+{
+    return loop_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_pipe(soare_arguments_list_t args)
+{
+    return loop_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_read(soare_arguments_list_t args)
+{
+    return loop_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_write(soare_arguments_list_t args)
+{
+    return loop_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_fd_close(soare_arguments_list_t args)
+{
+    return loop_unavailable(args);
+}
+
+////////////////////////////////////////////////////////////
+void loop_release(soare_state_t *state)
+{
+    (void)state;
+}
+
+////////////////////////////////////////////////////////////
+void loop_slice(soare_state_t *state)
+{
+    (void)state;
+}
+
+#endif /* _WIN32 */
@@ -3,9 +3,16 @@
 #include <string.h>
 #include <time.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif /* _WIN32 */
+
 #include <SOARE/SOARE.h>
 
 #include "module.h"
+#include "isolate.h"
+#include "loop.h"
+#include "parallel.h"
 
 /**
  *  _____  _____  ___  ______ _____
@@ -75,6 +82,155 @@ char *__soare_timestamp(soare_arguments_list_t args)
     return strdup(timestamp);
 }
 
+////////////////////////////////////////////////////////////
+static unsigned long long __clock_ns(boolean_t cpu)
+{
+#ifdef _WIN32
+    if (cpu)
+    {
+        return (unsigned long long)clock() * (1000000000ULL / CLOCKS_PER_SEC);
+    }
+
+    // Monotonic: never moved when the system clock is set
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    // Seconds, then the rest: ticks * 10^9 would overflow
+    unsigned long long ticks = (unsigned long long)counter.QuadPart;
+    unsigned long long hertz = (unsigned long long)frequency.QuadPart;
+
+    return ticks / hertz * 1000000000ULL + ticks % hertz * 1000000000ULL / hertz;
+#else
+    struct timespec now;
+    clock_gettime(cpu ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_MONOTONIC, &now);
+
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+#endif /* _WIN32 */
+}
+
+////////////////////////////////////////////////////////////
+static char *__ns_to_string(unsigned long long ns)
+{
+    char res[24];
+    snprintf(res, sizeof(res), "%llu", ns);
+
+    char *returns = strdup(res);
+
+    if (!returns)
+    {
+        SOARE_OUT_OF_MEMORY();
+    }
+
+    return returns;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_clock_ns(soare_arguments_list_t args)
+{
+    (void)args;
+    return __ns_to_string(__clock_ns(bFalse));
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_cpu_ns(soare_arguments_list_t args)
+{
+    (void)args;
+    return __ns_to_string(__clock_ns(bTrue));
+}
+
+////////////////////////////////////////////////////////////
+static int __by_duration(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_bench(soare_arguments_list_t args)
+{
+    char *function = parallel_function(args, 0);
+    char *count = function ? soare_get_argument(args, 1) : NULL;
+
+    if (!count)
+    {
+        if (function && !soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, "iterations", args->file);
+        }
+
+        free(function);
+        return NULL;
+    }
+
+    long long iterations = strtoll(count, NULL, 10);
+    free(count);
+
+    ast_t call = iterations > 0 ? soare_new_node(function, NODE_CALL, args->file) : NULL;
+    unsigned long long *durations = call ? (unsigned long long *)malloc((size_t)iterations * sizeof(unsigned long long)) : NULL;
+
+    free(function);
+
+    if (!durations)
+    {
+        if (iterations > 0)
+        {
+            SOARE_OUT_OF_MEMORY();
+        }
+        else
+        {
+            soare_leave_exception(ValueError, "iterations", args->file);
+        }
+
+        soare_tree_free(call);
+        return NULL;
+    }
+
+    // Warmup: caches, quickened nodes and JIT units are ready before timing
+    long long warmup = iterations / 10 ? iterations / 10 : 1;
+
+    for (long long i = 0; i < warmup && !soare_errorlevel(); i++)
+    {
+        free(soare_run_function(call));
+    }
+
+    for (long long i = 0; i < iterations && !soare_errorlevel(); i++)
+    {
+        unsigned long long start = __clock_ns(bFalse);
+        free(soare_run_function(call));
+        durations[i] = __clock_ns(bFalse) - start;
+    }
+
+    soare_tree_free(call);
+
+    // The exception of the function is raised again by the call
+    if (soare_errorlevel())
+    {
+        free(durations);
+        return NULL;
+    }
+
+    qsort(durations, (size_t)iterations, sizeof(unsigned long long), __by_duration);
+
+    unsigned long long median = iterations % 2 ? durations[iterations / 2] : (durations[iterations / 2 - 1] + durations[iterations / 2]) / 2;
+    unsigned long long p99 = durations[(iterations * 99 + 99) / 100 - 1];
+
+    char result[72];
+    snprintf(result, sizeof(result), "%llu,%llu,%llu", durations[0], median, p99);
+    free(durations);
+
+    char *returns = strdup(result);
+
+    if (!returns)
+    {
+        SOARE_OUT_OF_MEMORY();
+    }
+
+    return returns;
+}
+
 ////////////////////////////////////////////////////////////
 char *__soare_system(soare_arguments_list_t args)
 {
@@ -230,20 +386,86 @@ char *__soare_ord(soare_arguments_list_t args)
     return __int_to_string(ch);
 }
 
+////////////////////////////////////////////////////////////
+char *__soare_heapsnapshot(soare_arguments_list_t args)
+{
+    // Live blocks of the tracking build (make track), on stdout or in a file
+    document_t location = args ? args->file : soare_empty_document();
+
+    // Checked first: the file is not truncated for nothing
+    if (!soare_track_enabled())
+    {
+        soare_leave_exception(InterpreterError, "not tracked", location);
+        return NULL;
+    }
+
+    char *filename = soare_get_argument(args, 0);
+    FILE *file = filename ? fopen(filename, "w") : __soare_stdout;
+
+    if (!file)
+    {
+        soare_leave_exception(FileError, filename, location);
+        free(filename);
+        return NULL;
+    }
+
+    soare_track_snapshot(file);
+
+    if (filename)
+    {
+        fclose(file);
+        free(filename);
+    }
+
+    return NULL;
+}
+
+/* Predefined functions */
+static const soare_function_entry_t functions[] = {
+
+    {"eval" /*         */, __soare_eval},
+    {"exit" /*         */, __soare_exit},
+    {"system" /*       */, __soare_system},
+    {"time" /*         */, __soare_timestamp},
+    {"clock_ns" /*     */, __soare_clock_ns},
+    {"cpu_ns" /*       */, __soare_cpu_ns},
+    {"bench" /*        */, __soare_bench},
+    {"random" /*       */, __soare_random},
+    {"def" /*          */, __soare_define},
+    {"chr" /*          */, __soare_chr},
+    {"ord" /*          */, __soare_ord},
+    {"heapsnapshot" /* */, __soare_heapsnapshot},
+    {"input" /*        */, __soare_input},
+    {"write" /*        */, __soare_write},
+    {"werr" /*         */, __soare_werr},
+
+    {"parallel_for" /* */, __soare_parallel_for},
+    {"pmap" /*         */, __soare_pmap},
+
+    {"channel" /*      */, __soare_channel},
+    {"spawn" /*        */, __soare_spawn},
+    {"send" /*         */, __soare_send},
+    {"recv" /*         */, __soare_recv},
+
+    {"sleep" /*        */, __soare_sleep},
+    {"async" /*        */, __soare_async},
+    {"await" /*        */, __soare_await},
+    {"fd_open" /*      */, __soare_fd_open},
+    {"fd_pipe" /*      */, __soare_fd_pipe},
+    {"fd_read" /*      */, __soare_fd_read},
+    {"fd_write" /*     */, __soare_fd_write},
+    {"fd_close" /*     */, __soare_fd_close},
+
+};
+
 ////////////////////////////////////////////////////////////
 void load_module(void)
 {
-    soare_add_function("eval" /*    */, __soare_eval);
-    soare_add_function("exit" /*    */, __soare_exit);
-    soare_add_function("system" /*  */, __soare_system);
-    soare_add_function("time" /*    */, __soare_timestamp);
-    soare_add_function("random" /*  */, __soare_random);
-    soare_add_function("def" /*     */, __soare_define);
-    soare_add_function("chr" /*     */, __soare_chr);
-    soare_add_function("ord" /*     */, __soare_ord);
-    soare_add_function("input" /*   */, __soare_input);
-    soare_add_function("write" /*   */, __soare_write);
-    soare_add_function("werr" /*    */, __soare_werr);
+    soare_add_functions(functions, sizeof(functions) / sizeof(*functions));
+    // Tasks may still send to channels
+    soare_state_on_release(loop_release);
+    soare_state_on_release(isolate_release);
+    soare_state_on_slice(loop_slice);
     soare_add_variable("OS" /*      */, __PLATFORM__ /*   */, bFalse);
     soare_add_variable("false" /*   */, "0" /*            */, bFalse);
     soare_add_variable("true" /*    */, "1" /*            */, bFalse);
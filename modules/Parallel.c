@@ -0,0 +1,596 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include <SOARE/SOARE.h>
+
+#include "parallel.h"
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <Parallel.c>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ * @brief Items of a participant, stolen from the back by the others
+ */
+typedef struct parallel_deque
+{
+
+#ifndef _WIN32
+    pthread_mutex_t lock; /**< Protects the range */
+#endif /* _WIN32 */
+    unsigned long begin;  /**< Next item          */
+    unsigned long end;    /**< Past the last item */
+
+} parallel_deque_t;
+
+/**
+ * @brief One call of a parallel builtin
+ */
+typedef struct parallel_job
+{
+
+    const soare_state_t *caller; /**< Calling state, unchanged until the end    */
+    char *function;              /**< Function name                             */
+    boolean_t display;           /**< Display the exceptions of the items       */
+    char **items;                /**< Arguments, or NULL for indexes            */
+    long long first;             /**< First index                               */
+    char **results;              /**< Returned values, in item order            */
+    unsigned long count;         /**< Number of items                           */
+    parallel_deque_t *deques;    /**< Items of each participant                 */
+    unsigned int size;           /**< Number of participants                    */
+    unsigned int joined;         /**< Participants started (pool lock)          */
+    unsigned int running;        /**< Workers still running (pool lock)         */
+    int failed;                  /**< An item raised an exception (atomic)      */
+    soare_exceptions_t error;    /**< Exception of the first failing item       */
+#ifndef _WIN32
+    pthread_cond_t done;         /**< Signaled when the last worker leaves      */
+#endif /* _WIN32 */
+    struct parallel_job *next;   /**< Next job waiting for workers (pool lock)  */
+
+} parallel_job_t;
+
+#ifndef _WIN32
+
+/* Protects the pool and the participants of the jobs */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Signaled when a job waits for workers */
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+
+/* Jobs waiting for workers, oldest first */
+static parallel_job_t *pool_jobs = NULL;
+
+/* Number of started workers (the callers take part as well) */
+static unsigned int pool_size = 0;
+
+/* Workers are started on the first call */
+static boolean_t pool_started = bFalse;
+
+#endif /* _WIN32 */
+
+////////////////////////////////////////////////////////////
+static boolean_t parallel_take(parallel_job_t *job, unsigned int self, unsigned long *item)
+{
+    parallel_deque_t *deque = &job->deques[self];
+
+    if (__atomic_load_n(&job->failed, __ATOMIC_RELAXED))
+    {
+        return bFalse;
+    }
+
+#ifndef _WIN32
+    pthread_mutex_lock(&deque->lock);
+#endif /* _WIN32 */
+
+    boolean_t taken = deque->begin < deque->end;
+
+    if (taken)
+    {
+        *item = deque->begin++;
+    }
+
+#ifndef _WIN32
+    pthread_mutex_unlock(&deque->lock);
+
+    // Steal half of the items left to another participant
+    for (unsigned int i = 1; i < job->size && !taken; i++)
+    {
+        parallel_deque_t *victim = &job->deques[(self + i) % job->size];
+
+        pthread_mutex_lock(&victim->lock);
+
+        unsigned long left = victim->end - victim->begin;
+        unsigned long begin = victim->end - (left + 1) / 2;
+        unsigned long end = victim->end;
+
+        victim->end = begin;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (!left)
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&deque->lock);
+        deque->begin = begin + 1;
+        deque->end = end;
+        pthread_mutex_unlock(&deque->lock);
+
+        *item = begin;
+        taken = bTrue;
+    }
+#endif /* _WIN32 */
+
+    return taken;
+}
+
+////////////////////////////////////////////////////////////
+static void parallel_fail(parallel_job_t *job, soare_exceptions_t error)
+{
+    // Only the first exception is kept
+    if (!__atomic_exchange_n(&job->failed, 1, __ATOMIC_ACQ_REL))
+    {
+        job->error = error;
+    }
+}
+
+////////////////////////////////////////////////////////////
+static void parallel_run(parallel_job_t *job, unsigned int self)
+{
+    soare_state_t *state = NULL;
+    ast_t call = NULL;
+    unsigned long item = 0;
+
+    while (parallel_take(job, self, &item))
+    {
+        if (!state)
+        {
+            // Created on the first item: a late worker may find nothing
+            state = soare_state_inherit(job->caller);
+
+            if (!state)
+            {
+                parallel_fail(job, MemoryError);
+                break;
+            }
+
+            // Nodes are counted by the state of the worker
+            soare_state_t *previous = soare_state_select(state);
+            call = soare_new_node(job->function, NODE_CALL, soare_empty_document());
+            ast_t argument = soare_new_node(NULL, NODE_VALUE, soare_empty_document());
+            soare_state_select(previous);
+
+            if (!call || !argument)
+            {
+                soare_tree_free(argument);
+                parallel_fail(job, MemoryError);
+                break;
+            }
+
+            soare_tree_join(call, argument);
+
+            soare_state_streams(state, job->caller->input, job->caller->output, job->caller->error);
+        }
+
+        char index[32];
+        snprintf(index, sizeof(index), "%lld", job->first + (long long)item);
+
+        soare_state_t *previous = soare_state_select(state);
+        soare_ignore_exception(!job->display);
+        soare_clear_exception();
+
+        soare_free(call->child->value);
+        call->child->value = soare_strdup(SOARE_MEMORY_AST, job->items ? job->items[item] : index);
+
+        char *result = call->child->value ? soare_run_function(call) : NULL;
+
+        if (!call->child->value)
+        {
+            parallel_fail(job, MemoryError);
+        }
+        else if (soare_errorlevel())
+        {
+            parallel_fail(job, soare_get_exception_type());
+            free(result);
+        }
+        else
+        {
+            job->results[item] = result;
+        }
+
+        soare_state_select(previous);
+    }
+
+    soare_tree_free(call);
+    soare_state_free(state);
+}
+
+#ifndef _WIN32
+
+////////////////////////////////////////////////////////////
+static void *parallel_worker(void *unused)
+{
+    (void)unused;
+
+    pthread_mutex_lock(&pool_lock);
+
+    while (1)
+    {
+        while (!pool_jobs)
+        {
+            pthread_cond_wait(&pool_work, &pool_lock);
+        }
+
+        parallel_job_t *job = pool_jobs;
+        unsigned int self = job->joined++;
+        job->running++;
+
+        if (job->joined == job->size)
+        {
+            // Every participant has started
+            pool_jobs = job->next;
+        }
+
+        pthread_mutex_unlock(&pool_lock);
+        parallel_run(job, self);
+        pthread_mutex_lock(&pool_lock);
+
+        if (!--job->running)
+        {
+            pthread_cond_signal(&job->done);
+        }
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static void parallel_start(void)
+{
+    // Pool lock held
+    if (pool_started)
+    {
+        return;
+    }
+
+    pool_started = bTrue;
+
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int workers = processors > 1 ? (unsigned int)processors - 1 : 1;
+
+    for (; pool_size < workers; pool_size++)
+    {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, parallel_worker, NULL))
+        {
+            break;
+        }
+
+        pthread_detach(thread);
+    }
+}
+
+#endif /* _WIN32 */
+
+////////////////////////////////////////////////////////////
+static boolean_t parallel(parallel_job_t *job)
+{
+#ifndef _WIN32
+    pthread_mutex_lock(&pool_lock);
+    parallel_start();
+    job->size = pool_size + 1;
+    pthread_mutex_unlock(&pool_lock);
+#else
+    job->size = 1;
+#endif /* _WIN32 */
+
+    if (job->size > job->count)
+    {
+        job->size = job->count ? (unsigned int)job->count : 1;
+    }
+
+    job->deques = (parallel_deque_t *)calloc(job->size, sizeof(parallel_deque_t));
+
+    if (!job->deques)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return bFalse;
+    }
+
+    for (unsigned int i = 0; i < job->size; i++)
+    {
+#ifndef _WIN32
+        pthread_mutex_init(&job->deques[i].lock, NULL);
+#endif /* _WIN32 */
+        job->deques[i].begin = job->count * i / job->size;
+        job->deques[i].end = job->count * (i + 1) / job->size;
+    }
+
+    // The caller takes the first deque
+    job->joined = 1;
+
+#ifndef _WIN32
+    pthread_cond_init(&job->done, NULL);
+    pthread_mutex_lock(&pool_lock);
+
+    if (job->size > 1)
+    {
+        parallel_job_t **last = &pool_jobs;
+
+        while (*last)
+        {
+            last = &(*last)->next;
+        }
+
+        *last = job;
+        pthread_cond_broadcast(&pool_work);
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+#endif /* _WIN32 */
+
+    parallel_run(job, 0);
+
+#ifndef _WIN32
+    pthread_mutex_lock(&pool_lock);
+
+    // No worker may join once the caller is done: every item is taken
+    for (parallel_job_t **link = &pool_jobs; *link; link = &(*link)->next)
+    {
+        if (*link == job)
+        {
+            *link = job->next;
+            break;
+        }
+    }
+
+    while (job->running)
+    {
+        pthread_cond_wait(&job->done, &pool_lock);
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+    pthread_cond_destroy(&job->done);
+
+    for (unsigned int i = 0; i < job->size; i++)
+    {
+        pthread_mutex_destroy(&job->deques[i].lock);
+    }
+#endif /* _WIN32 */
+
+    free(job->deques);
+    return bTrue;
+}
+
+////////////////////////////////////////////////////////////
+char *parallel_function(soare_arguments_list_t args, unsigned int position)
+{
+    soare_arguments_list_t arg = args;
+
+    for (unsigned int i = 0; i < position && arg; i++)
+    {
+        arg = arg->sibling;
+    }
+
+    if (!arg)
+    {
+        soare_leave_exception(MissingArgument, "fn", args ? args->file : soare_empty_document());
+        return NULL;
+    }
+
+    // A function is passed by name: `fn` or "fn"
+    char *function = arg->type == NODE_MEMGET || arg->type == NODE_MEMGET_SLOT ? strdup(arg->value) : soare_math(arg);
+
+    if (!function)
+    {
+        return NULL;
+    }
+
+    soare_variables_t *get = soare_get_variable(function);
+
+    if ((get && get->body) || (!get && soare_get_function(function)))
+    {
+        return function;
+    }
+
+    soare_leave_exception(get ? ObjectIsNotCallable : UndefinedReference, function, arg->file);
+    free(function);
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////
+static char *parallel_gather(parallel_job_t *job, document_t file, const char *separator)
+{
+    if (job->failed)
+    {
+        soare_leave_exception(job->error, job->function, file);
+        return NULL;
+    }
+
+    size_t length = 0;
+    size_t step = strlen(separator);
+
+    for (unsigned long i = 0; i < job->count; i++)
+    {
+        length += (job->results[i] ? strlen(job->results[i]) : 0) + step;
+    }
+
+    char *result = (char *)malloc(length + 1);
+
+    if (!result)
+    {
+        SOARE_OUT_OF_MEMORY();
+        return NULL;
+    }
+
+    char *end = result;
+
+    for (unsigned long i = 0; i < job->count; i++)
+    {
+        if (i)
+        {
+            memcpy(end, separator, step);
+            end += step;
+        }
+
+        size_t size = job->results[i] ? strlen(job->results[i]) : 0;
+        memcpy(end, job->results[i], size);
+        end += size;
+    }
+
+    *end = 0;
+    return result;
+}
+
+////////////////////////////////////////////////////////////
+static char *parallel_call(parallel_job_t *job, document_t file, const char *separator)
+{
+    soare_share_functions();
+
+    job->caller = soare_state_current();
+    job->display = !soare_as_ignored_exception();
+    job->results = (char **)calloc(job->count + 1, sizeof(char *));
+
+    char *result = NULL;
+
+    if (!job->results)
+    {
+        SOARE_OUT_OF_MEMORY();
+    }
+    else if (parallel(job))
+    {
+        result = parallel_gather(job, file, separator);
+    }
+
+    for (unsigned long i = 0; job->results && i < job->count; i++)
+    {
+        free(job->results[i]);
+    }
+
+    free(job->results);
+    return result;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_parallel_for(soare_arguments_list_t args)
+{
+    char *start = soare_get_argument(args, 0);
+    char *end = soare_get_argument(args, 1);
+    char *function = start && end ? parallel_function(args, 2) : NULL;
+
+    if (!function)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, !start ? "start" : "end", args ? args->file : soare_empty_document());
+        }
+
+        free(start);
+        free(end);
+        return NULL;
+    }
+
+    parallel_job_t job = {0};
+    job.function = function;
+    job.first = strtoll(start, NULL, 10);
+
+    long long last = strtoll(end, NULL, 10);
+    job.count = last > job.first ? (unsigned long)(last - job.first) : 0;
+
+    char *result = parallel_call(&job, args->file, "");
+
+    free(start);
+    free(end);
+    free(function);
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////
+char *__soare_pmap(soare_arguments_list_t args)
+{
+    char *string = soare_get_argument(args, 0);
+    char *delimiter = soare_get_argument(args, 1);
+    char *function = string && delimiter ? parallel_function(args, 2) : NULL;
+
+    if (!function)
+    {
+        if (!soare_errorlevel())
+        {
+            soare_leave_exception(MissingArgument, !string ? "string" : "delimiter", args ? args->file : soare_empty_document());
+        }
+
+        free(string);
+        free(delimiter);
+        return NULL;
+    }
+
+    parallel_job_t job = {0};
+    job.function = function;
+
+    size_t step = strlen(delimiter);
+    size_t length = strlen(string);
+
+    // Items point into `string`, cut at each delimiter
+    job.items = (char **)malloc((length + 1) * sizeof(char *));
+
+    if (!step && job.items)
+    {
+        // One item per character, each followed by its own terminator
+        char *characters = (char *)malloc(length * 2 + 1);
+
+        for (size_t i = 0; characters && i < length; i++)
+        {
+            characters[i * 2] = string[i];
+            characters[i * 2 + 1] = 0;
+            job.items[job.count++] = &characters[i * 2];
+        }
+
+        free(string);
+        string = characters;
+    }
+    else if (length && job.items)
+    {
+        job.items[job.count++] = string;
+
+        for (char *next = strstr(string, delimiter); next; next = strstr(next + step, delimiter))
+        {
+            *next = 0;
+            job.items[job.count++] = next + step;
+        }
+    }
+
+    char *result = NULL;
+
+    if (!job.items || !string)
+    {
+        SOARE_OUT_OF_MEMORY();
+    }
+    else
+    {
+        result = parallel_call(&job, args->file, delimiter);
+    }
+
+    free(job.items);
+    free(string);
+    free(delimiter);
+    free(function);
+
+    return result;
+}
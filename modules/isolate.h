@@ -0,0 +1,82 @@
+#ifndef __SOARE_ISOLATE_H__
+#define __SOARE_ISOLATE_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <isolate.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Isolates and channels
+ *
+ * A spawned task runs a function in its own state (inheriting the
+ * functions and constants of the caller) on its own pool thread. Tasks
+ * share nothing but channels: bounded lock-free queues of copied
+ * values, named by a handle such as "channel:1"
+ *
+ * When a state is released (end of the program, end of a --serve
+ * job), the channels it created are closed and the tasks it spawned
+ * are waited for
+ *
+ */
+
+/**
+ * @brief channel(capacity)
+ *
+ * Sending waits once `capacity` values are in the channel
+ *
+ * @param args Arguments
+ * @return char* Handle of a new channel (capacity 64 by default)
+ */
+char *__soare_channel(soare_arguments_list_t args);
+
+/**
+ * @brief spawn(fn; args...)
+ *
+ * Call `fn(args...)` in a new task, arguments are evaluated by the
+ * caller
+ *
+ * @param args Arguments
+ * @return char* NULL
+ */
+char *__soare_spawn(soare_arguments_list_t args);
+
+/**
+ * @brief send(ch; value)
+ *
+ * Copy a value into a channel, waiting while it is full
+ *
+ * @param args Arguments
+ * @return char* NULL
+ */
+char *__soare_send(soare_arguments_list_t args);
+
+/**
+ * @brief recv(ch)
+ *
+ * Take the oldest value of a channel, waiting while it is empty
+ *
+ * @param args Arguments
+ * @return char* Received value
+ */
+char *__soare_recv(soare_arguments_list_t args);
+
+/**
+ * @brief Close the channels and wait for the tasks of a released state
+ *
+ * @param state Released state
+ */
+void isolate_release(soare_state_t *state);
+
+#endif /* __SOARE_ISOLATE_H__ */
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef __SOARE_LOOP_H__
+#define __SOARE_LOOP_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <loop.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Event loop
+ *
+ * An async task runs a function on its own stack, in the state and on
+ * the thread of its caller. When it sleeps, awaits another task or
+ * waits for a descriptor, it is parked and the loop runs the other
+ * tasks. The loop runs while the code outside of the tasks waits (for
+ * the same reasons), and when the state is released, until every task
+ * is finished
+ *
+ */
+
+/**
+ * @brief sleep(seconds)
+ *
+ * @param args Arguments
+ * @return char* NULL
+ */
+char *__soare_sleep(soare_arguments_list_t args);
+
+/**
+ * @brief async(fn; args...)
+ *
+ * Call `fn(args...)` in a new task, arguments are evaluated by the
+ * caller
+ *
+ * @param args Arguments
+ * @return char* Handle of the task ("task:<n>")
+ */
+char *__soare_async(soare_arguments_list_t args);
+
+/**
+ * @brief await(task)
+ *
+ * Wait for a task, its exception is raised again
+ *
+ * @param args Arguments
+ * @return char* Value returned by the task
+ */
+char *__soare_await(soare_arguments_list_t args);
+
+/**
+ * @brief fd_open(path; mode)
+ *
+ * Mode "r" (read), "w" (write, truncated) or "a" (append)
+ *
+ * @param args Arguments
+ * @return char* Descriptor
+ */
+char *__soare_fd_open(soare_arguments_list_t args);
+
+/**
+ * @brief fd_pipe(reader; writer)
+ *
+ * Store the descriptors of a new pipe into two variables
+ *
+ * @param args Arguments
+ * @return char* NULL
+ */
+char *__soare_fd_pipe(soare_arguments_list_t args);
+
+/**
+ * @brief fd_read(fd; size)
+ *
+ * Read at most `size` bytes (4096 by default), waiting while nothing
+ * can be read
+ *
+ * @param args Arguments
+ * @return char* Read bytes, empty at the end of the file
+ */
+char *__soare_fd_read(soare_arguments_list_t args);
+
+/**
+ * @brief fd_write(fd; values...)
+ *
+ * Write values, waiting while the descriptor is full
+ *
+ * @param args Arguments
+ * @return char* NULL
+ */
+char *__soare_fd_write(soare_arguments_list_t args);
+
+/**
+ * @brief fd_close(fd)
+ *
+ * @param args Arguments
+ * @return char* NULL
+ */
+char *__soare_fd_close(soare_arguments_list_t args);
+
+/**
+ * @brief Run the tasks of a released state until they are finished
+ *
+ * Tasks are closed instead if the state ended on an exception
+ *
+ * @param state Released state
+ */
+void loop_release(soare_state_t *state);
+
+/**
+ * @brief Give the turn of the running task to the other tasks
+ *
+ * Called at the end of each slice of steps, so that a task which never
+ * waits cannot hold the loop
+ *
+ * @param state Running state
+ */
+void loop_slice(soare_state_t *state);
+
+#endif /* __SOARE_LOOP_H__ */
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef __SOARE_PARALLEL_H__
+#define __SOARE_PARALLEL_H__
+
+/* #pragma once */
+
+/**
+ *  _____  _____  ___  ______ _____
+ * /  ___||  _  |/ _ \ | ___ \  ___|
+ * \ `--. | | | / /_\ \| |_/ / |__
+ *  `--. \| | | |  _  ||    /|  __|
+ * /\__/ /\ \_/ / | | || |\ \| |___
+ * \____/  \___/\_| |_/\_| \_\____/
+ *
+ * Antoine LANDRIEUX (MIT License) <parallel.h>
+ * <https://github.com/AntoineLandrieux/SOARE/>
+ *
+ */
+
+/**
+ *
+ * Parallel builtins
+ *
+ * Items are run by a pool of worker threads (and by the calling
+ * thread), each item in a state inheriting from the caller: the
+ * function sees the constants and the functions of the caller, whose
+ * trees are shared, but not its mutable variables. Idle workers steal
+ * items from busy ones. The first exception stops the remaining items
+ * and is raised again in the caller
+ *
+ */
+
+/**
+ * @brief parallel_for(start; end; fn)
+ *
+ * Call `fn(i)` for each `i` from `start` to `end` (excluded)
+ *
+ * @param args Arguments
+ * @return char* Returned values, concatenated in index order
+ */
+char *__soare_parallel_for(soare_arguments_list_t args);
+
+/**
+ * @brief pmap(string; delimiter; fn)
+ *
+ * Call `fn(item)` for each item of a delimited string (each character
+ * if the delimiter is empty)
+ *
+ * @param args Arguments
+ * @return char* Returned values, in item order, joined with the delimiter
+ */
+char *__soare_pmap(soare_arguments_list_t args);
+
+/**
+ * @brief Resolve the function argument of a builtin
+ *
+ * The function is given by name: `fn` (not evaluated) or any
+ * expression giving its name
+ *
+ * @param args Arguments
+ * @param position Position of the function argument
+ * @return char* Allocated name of a callable function, or NULL on error
+ */
+char *parallel_function(soare_arguments_list_t args, unsigned int position);
+
+#endif /* __SOARE_PARALLEL_H__ */
\ No newline at end of file